@@ -68,7 +68,8 @@ enum ConnectionStringSource
 typedef enum ConnectionStringSource ConnectionStringSource;
 static ConnectionStringSource g_connectionStringSource = FromAis;
 
-static int g_stopSignal = 0;
+// Only set by the signal handlers, the main loop logs the signal once it stops
+static volatile sig_atomic_t g_stopSignal = 0;
 static int g_refreshSignal = 0;
 
 static char* g_iotHubConnectionString = NULL;
@@ -147,12 +148,14 @@ static void SignalInterrupt(int signal)
     }
     else
     {
-        OsConfigLogInfo(g_agentLog, "Interrupt signal (%d)", signal);
         g_stopSignal = signal;
     }
 
     if (NULL != errorMessage)
     {
+        // Lines still queued for the log writer thread would be lost with the process
+        FlushLogOnCrash(g_agentLog);
+
         if (0 < (logDescriptor = open(LOG_FILE, O_APPEND | O_WRONLY | O_NONBLOCK)))
         {
             writeResult = write(logDescriptor, (const void*)errorMessage, strlen(errorMessage));
@@ -410,13 +413,7 @@ static void ReportProperties()
         return;
     }
 
-    for (int i = 0; i < g_numReportedProperties; i++)
-    {
-        if ((strlen(g_reportedProperties[i].componentName) > 0) && (strlen(g_reportedProperties[i].propertyName) > 0))
-        {
-            ReportPropertyToIotHub(g_reportedProperties[i].componentName, g_reportedProperties[i].propertyName, &(g_reportedProperties[i].lastPayloadHash));
-        }
-    }
+    ReportPropertiesToIotHub(g_reportedProperties, g_numReportedProperties);
 }
 
 static void AgentDoWork(void)
@@ -505,6 +502,7 @@ int main(int argc, char *argv[])
     {
         SetCommandLogging(IsCommandLoggingEnabledInJsonConfig(jsonConfiguration));
         SetFullLogging(IsFullLoggingEnabledInJsonConfig(jsonConfiguration));
+        SetMillisecondLogging(IsMillisecondLoggingEnabledInJsonConfig(jsonConfiguration));
         FREE_MEMORY(jsonConfiguration);
     }
 
@@ -699,7 +697,12 @@ int main(int argc, char *argv[])
     }
 
 done:
-    OsConfigLogInfo(GetLog(), "OSConfig PnP Agent (PID: %d) exiting with %d", pid, g_stopSignal);
+    if (0 != g_stopSignal)
+    {
+        OsConfigLogInfo(GetLog(), "Interrupt signal (%d)", (int)g_stopSignal);
+    }
+
+    OsConfigLogInfo(GetLog(), "OSConfig PnP Agent (PID: %d) exiting with %d", pid, (int)g_stopSignal);
 
     FREE_MEMORY(g_x509Certificate);
     FREE_MEMORY(g_x509PrivateKeyHandle);
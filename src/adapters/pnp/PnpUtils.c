@@ -519,35 +519,14 @@ static void ReadReportedStateCallback(int statusCode, void* userContextCallback)
     }
 }
 
-IOTHUB_CLIENT_RESULT ReportPropertyToIotHub(const char* componentName, const char* propertyName, size_t* lastPayloadHash)
+static IOTHUB_CLIENT_RESULT ReportPayloadToIotHub(const char* componentName, const char* propertyName, int mpiResult, const char* valuePayload, int valueLength, size_t* lastPayloadHash)
 {
     IOTHUB_CLIENT_RESULT result = IOTHUB_CLIENT_OK;
-    char* valuePayload = NULL;
-    int valueLength = 0;
     char* decoratedPayload = NULL;
     int decoratedLength = 0;
     size_t hashPayload = 0;
     bool reportProperty = true;
-    bool platformAlreadyRunning = true;
-    int mpiResult = MPI_OK;
-
-    LogAssert(GetLog(), NULL != componentName);
-    LogAssert(GetLog(), NULL != propertyName);
-
-    if (NULL == g_moduleHandle)
-    {
-        OsConfigLogError(GetLog(), "%s: the component needs to be initialized before reporting properties", componentName);
-        return IOTHUB_CLIENT_ERROR;
-    }
 
-    mpiResult = CallMpiGet(componentName, propertyName, &valuePayload, &valueLength, GetLog());
-    if ((MPI_OK != mpiResult) && RefreshMpiClientSession(&platformAlreadyRunning) && (false == platformAlreadyRunning))
-    {
-        CallMpiFree(valuePayload);
-
-        mpiResult = CallMpiGet(componentName, propertyName, &valuePayload, &valueLength, GetLog());
-    }
-        
     if ((MPI_OK == mpiResult) && (valueLength > 0) && (NULL != valuePayload))
     {
         decoratedLength = strlen(componentName) + strlen(propertyName) + valueLength + EXTRA_PROP_PAYLOAD_ESTIMATE;
@@ -609,13 +588,120 @@ IOTHUB_CLIENT_RESULT ReportPropertyToIotHub(const char* componentName, const cha
         result = IOTHUB_CLIENT_ERROR;
     }
 
-    CallMpiFree(valuePayload);
-
     FREE_MEMORY(decoratedPayload);
 
     return result;
 }
 
+IOTHUB_CLIENT_RESULT ReportPropertyToIotHub(const char* componentName, const char* propertyName, size_t* lastPayloadHash)
+{
+    IOTHUB_CLIENT_RESULT result = IOTHUB_CLIENT_OK;
+    char* valuePayload = NULL;
+    int valueLength = 0;
+    bool platformAlreadyRunning = true;
+    int mpiResult = MPI_OK;
+
+    LogAssert(GetLog(), NULL != componentName);
+    LogAssert(GetLog(), NULL != propertyName);
+
+    if (NULL == g_moduleHandle)
+    {
+        OsConfigLogError(GetLog(), "%s: the component needs to be initialized before reporting properties", componentName);
+        return IOTHUB_CLIENT_ERROR;
+    }
+
+    mpiResult = CallMpiGet(componentName, propertyName, &valuePayload, &valueLength, GetLog());
+    if ((MPI_OK != mpiResult) && RefreshMpiClientSession(&platformAlreadyRunning) && (false == platformAlreadyRunning))
+    {
+        CallMpiFree(valuePayload);
+
+        mpiResult = CallMpiGet(componentName, propertyName, &valuePayload, &valueLength, GetLog());
+    }
+
+    result = ReportPayloadToIotHub(componentName, propertyName, mpiResult, valuePayload, valueLength, lastPayloadHash);
+
+    CallMpiFree(valuePayload);
+
+    return result;
+}
+
+void ReportPropertiesToIotHub(REPORTED_PROPERTY* reportedProperties, int numReportedProperties)
+{
+    MPI_OBJECT* objects = NULL;
+    int* indexes = NULL;
+    int numObjects = 0;
+    bool platformAlreadyRunning = true;
+    int mpiResult = MPI_OK;
+    int i = 0;
+
+    if ((NULL == reportedProperties) || (numReportedProperties <= 0))
+    {
+        return;
+    }
+
+    if (NULL == g_moduleHandle)
+    {
+        OsConfigLogError(GetLog(), "The component needs to be initialized before reporting properties");
+        return;
+    }
+
+    objects = (MPI_OBJECT*)calloc(numReportedProperties, sizeof(MPI_OBJECT));
+    indexes = (int*)calloc(numReportedProperties, sizeof(int));
+
+    if ((NULL != objects) && (NULL != indexes))
+    {
+        for (i = 0; i < numReportedProperties; i++)
+        {
+            if ((strlen(reportedProperties[i].componentName) > 0) && (strlen(reportedProperties[i].propertyName) > 0))
+            {
+                objects[numObjects].componentName = reportedProperties[i].componentName;
+                objects[numObjects].objectName = reportedProperties[i].propertyName;
+                indexes[numObjects] = i;
+                numObjects += 1;
+            }
+        }
+
+        // All the reported properties in one round trip to the platform
+        mpiResult = (numObjects > 0) ? CallMpiGetMany(objects, numObjects, GetLog()) : MPI_OK;
+        if ((MPI_OK != mpiResult) && RefreshMpiClientSession(&platformAlreadyRunning) && (false == platformAlreadyRunning))
+        {
+            mpiResult = CallMpiGetMany(objects, numObjects, GetLog());
+        }
+    }
+    else
+    {
+        mpiResult = ENOMEM;
+    }
+
+    if (MPI_OK == mpiResult)
+    {
+        for (i = 0; i < numObjects; i++)
+        {
+            ReportPayloadToIotHub(objects[i].componentName, objects[i].objectName, objects[i].status, objects[i].payload, objects[i].payloadSizeBytes, &(reportedProperties[indexes[i]].lastPayloadHash));
+            CallMpiFree(objects[i].payload);
+        }
+    }
+    else
+    {
+        // For example a platform that does not support MpiGetMany, fall back to one MpiGet per property
+        if (IsFullLoggingEnabled())
+        {
+            OsConfigLogError(GetLog(), "MpiGetMany failed with %d, reporting properties one at a time", mpiResult);
+        }
+
+        for (i = 0; i < numReportedProperties; i++)
+        {
+            if ((strlen(reportedProperties[i].componentName) > 0) && (strlen(reportedProperties[i].propertyName) > 0))
+            {
+                ReportPropertyToIotHub(reportedProperties[i].componentName, reportedProperties[i].propertyName, &(reportedProperties[i].lastPayloadHash));
+            }
+        }
+    }
+
+    FREE_MEMORY(objects);
+    FREE_MEMORY(indexes);
+}
+
 IOTHUB_CLIENT_RESULT UpdatePropertyFromIotHub(const char* componentName, const char* propertyName, const JSON_Value* propertyValue, int version)
 {
     IOTHUB_CLIENT_RESULT result = IOTHUB_CLIENT_OK;
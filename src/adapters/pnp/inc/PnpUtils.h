@@ -26,6 +26,7 @@ void IotHubDoWork(void);
 // - IOTHUB_CLIENT_INDEFINITE_TIME
 IOTHUB_CLIENT_RESULT UpdatePropertyFromIotHub(const char* componentName, const char* propertyName, const JSON_Value* propertyValue, int version);
 IOTHUB_CLIENT_RESULT ReportPropertyToIotHub(const char* componentName, const char* propertyName, size_t* lastPayloadHash);
+void ReportPropertiesToIotHub(REPORTED_PROPERTY* reportedProperties, int numReportedProperties);
 IOTHUB_CLIENT_RESULT AckPropertyUpdateToIotHub(const char* componentName, const char* propertyName, char* propertyValue, int valueLength, int version, int propertyUpdateResult);
 
 void ProcessDesiredTwinUpdates();
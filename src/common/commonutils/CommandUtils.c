@@ -15,14 +15,30 @@ bool IsCommandLoggingEnabled(void)
     return g_commandLoggingEnabled;
 }
 
-static void KillProcess(pid_t processId)
+#define COMMAND_CALLBACK_INTERVAL_SECONDS 5
+#define DEFAULT_COMMAND_TIMEOUT_SECONDS 60
+#define COMMAND_READ_BUFFER_SIZE 4096
+#define COMMAND_POLL_INTERVAL_MILLISECONDS 100
+
+extern char** environ;
+
+typedef struct COMMAND_OUTPUT
 {
-    fflush(NULL);
-    if (processId > 0)
-    {
-        kill(processId, SIGKILL);
-    }
-}
+    // When false the output is read and dropped
+    bool keep;
+    // When true stderr is discarded instead of captured with stdout
+    bool stdoutOnly;
+    // Maximum bytes kept
+    size_t limit;
+    // Bytes written by the command, including those dropped
+    size_t total;
+    char* buffer;
+    size_t size;
+    size_t capacity;
+    // When set, receives the output as it is read
+    CommandOutputCallback stream;
+    void* streamContext;
+} COMMAND_OUTPUT;
 
 static int NormalizeStatus(int status)
 {
@@ -41,177 +57,352 @@ static int NormalizeStatus(int status)
     return newStatus;
 }
 
-static int SystemCommand(void* context, const char* command, int timeoutSeconds, CommandCallback callback, void* log)
+static long long GetMonotonicMilliseconds(void)
+{
+    struct timespec now = {0};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((long long)now.tv_sec * 1000) + (now.tv_nsec / 1000000);
+}
+
+// A pidfd becomes readable when the process exits, without it we fall back to polling with waitpid
+static int OpenProcessHandle(pid_t processId)
+{
+#ifdef SYS_pidfd_open
+    return (int)syscall(SYS_pidfd_open, processId, 0);
+#else
+    UNUSED(processId);
+    return -1;
+#endif
+}
+
+static void AppendOutput(COMMAND_OUTPUT* output, const char* data, size_t dataSize)
+{
+    size_t capacity = 0;
+    char* buffer = NULL;
+
+    output->total += dataSize;
+
+    if (NULL != output->stream)
+    {
+        output->stream(output->streamContext, data, dataSize);
+    }
+
+    if ((false == output->keep) || (output->size >= output->limit))
+    {
+        return;
+    }
+
+    if (dataSize > (output->limit - output->size))
+    {
+        dataSize = output->limit - output->size;
+    }
+
+    if ((output->size + dataSize + 1) > output->capacity)
+    {
+        capacity = output->capacity ? output->capacity : COMMAND_READ_BUFFER_SIZE;
+        while (capacity < (output->size + dataSize + 1))
+        {
+            capacity *= 2;
+        }
+
+        if (NULL == (buffer = (char*)realloc(output->buffer, capacity)))
+        {
+            // Keep what was captured so far and drop the rest
+            output->limit = output->size;
+            return;
+        }
+
+        output->buffer = buffer;
+        output->capacity = capacity;
+    }
+
+    memcpy(output->buffer + output->size, data, dataSize);
+    output->size += dataSize;
+    output->buffer[output->size] = 0;
+}
+
+// Reads what is available from the output pipe, returns false once the pipe is closed
+static bool ReadOutput(int pipeHandle, COMMAND_OUTPUT* output)
+{
+    char buffer[COMMAND_READ_BUFFER_SIZE];
+    ssize_t bytesRead = 0;
+
+    while (0 < (bytesRead = read(pipeHandle, buffer, sizeof(buffer))))
+    {
+        AppendOutput(output, buffer, (size_t)bytesRead);
+    }
+
+    return (bytesRead < 0) && ((EAGAIN == errno) || (EWOULDBLOCK == errno) || (EINTR == errno));
+}
+
+// Writes what the input pipe takes, returns false once all the input is written or the command stopped reading it
+static bool WriteInput(int pipeHandle, const char** input, size_t* inputSize)
 {
-    const int callbackIntervalSeconds = 5; //seconds
-    const int defaultCommandTimeout = 60; //seconds
+    struct timespec noWait = {0};
+    sigset_t pipeSignal;
+    sigset_t pendingSignals;
+    sigset_t previousSignals;
+    ssize_t bytesWritten = 0;
+    bool pipeSignalPending = false;
+    int error = 0;
+
+    // A command that exits without reading all of its input must not take the process down with SIGPIPE
+    sigemptyset(&pipeSignal);
+    sigaddset(&pipeSignal, SIGPIPE);
+    sigpending(&pendingSignals);
+    pipeSignalPending = (1 == sigismember(&pendingSignals, SIGPIPE));
+    pthread_sigmask(SIG_BLOCK, &pipeSignal, &previousSignals);
+
+    while ((*inputSize > 0) && (0 < (bytesWritten = write(pipeHandle, *input, *inputSize))))
+    {
+        *input += bytesWritten;
+        *inputSize -= (size_t)bytesWritten;
+    }
+
+    error = errno;
+    if ((bytesWritten < 0) && (EPIPE == error) && !pipeSignalPending)
+    {
+        sigtimedwait(&pipeSignal, NULL, &noWait);
+    }
+
+    pthread_sigmask(SIG_SETMASK, &previousSignals, NULL);
+
+    return (*inputSize > 0) && (bytesWritten < 0) && ((EAGAIN == error) || (EWOULDBLOCK == error) || (EINTR == error));
+}
 
-    pid_t intermediateProcess = -1;
+// Runs the command with /bin/sh, stdout and stderr captured through a pipe, and waits for it with an optional timeout and
+// cancelation, either polled through the callback or delivered immediately when the cancel handle becomes readable.
+// When input is not NULL it is written to the command's stdin through a pipe, closed once all of it is written
+static int SystemCommand(void* context, const char* command, const char* input, size_t inputSize, int timeoutSeconds, CommandCallback callback, int cancelHandle, COMMAND_OUTPUT* output, void* log)
+{
+    char* arguments[] = {"sh", "-c", (char*)command, NULL};
+    int pipeHandles[2] = {-1, -1};
+    int inputHandles[2] = {-1, -1};
+    int processHandle = -1;
     pid_t workerProcess = -1;
-    pid_t timerProcess = -1;
-    pid_t childProcess = -1;
+    posix_spawn_file_actions_t fileActions;
+    posix_spawnattr_t attributes;
+    sigset_t signals;
+    struct pollfd handles[4];
+    bool pipeOpen = true;
+    bool exited = false;
+    bool limited = (timeoutSeconds > 0) || (NULL != callback) || (cancelHandle >= 0);
+    int timeout = (timeoutSeconds > 0) ? timeoutSeconds : DEFAULT_COMMAND_TIMEOUT_SECONDS;
+    long long now = GetMonotonicMilliseconds();
+    long long deadline = now + ((long long)timeout * 1000);
+    long long nextCallback = now;
+    int waitMilliseconds = -1;
     int status = -1;
-    int intermediateStatus = -1;
-    int totalWaitSeconds = 0;
-    int timeout = (timeoutSeconds > 0) ? timeoutSeconds : defaultCommandTimeout;
-    
+    int spawnStatus = 0;
+
     bool mainProcessThread = (bool)(getpid() == gettid());
 
-    fflush(NULL);
+    if (IsCommandLoggingEnabled())
+    {
+        if (limited)
+        {
+            OsConfigLogInfo(log, "SystemCommand: executing command '%s' with timeout of %d seconds and%scancelation on %s thread",
+                command, timeout, ((NULL == callback) && (cancelHandle < 0)) ? " no " : " ", mainProcessThread ? "main process" : "worker");
+        }
+        else
+        {
+            OsConfigLogInfo(log, "SystemCommand: executing command '%s' without timeout or cancelation on %s thread",
+                command, mainProcessThread ? "main process" : "worker");
+        }
+    }
+
+    // Close-on-exec, so that commands spawned at the same time by other threads do not keep this pipe open
+    if (0 != pipe2(pipeHandles, O_CLOEXEC))
+    {
+        if (IsCommandLoggingEnabled())
+        {
+            OsConfigLogError(log, "Failed creating pipe to capture command output (%d)", errno);
+        }
+        return -1;
+    }
 
-    if ((timeoutSeconds > 0) || (NULL != callback))
+    if ((NULL != input) && (0 != pipe2(inputHandles, O_CLOEXEC)))
     {
         if (IsCommandLoggingEnabled())
         {
-            OsConfigLogInfo(log, "SystemCommand: executing command '%s' with timeout of %d seconds and%scancelation on %s thread", 
-                command, timeout, (NULL == callback) ? " no " : " ", mainProcessThread ? "main process" : "worker");
+            OsConfigLogError(log, "Failed creating pipe to pass command input (%d)", errno);
         }
+        close(pipeHandles[0]);
+        close(pipeHandles[1]);
+        return -1;
+    }
+
+    posix_spawn_file_actions_init(&fileActions);
+    if (NULL != input)
+    {
+        posix_spawn_file_actions_adddup2(&fileActions, inputHandles[0], STDIN_FILENO);
+    }
+    posix_spawn_file_actions_adddup2(&fileActions, pipeHandles[1], STDOUT_FILENO);
+    if (output->stdoutOnly)
+    {
+        posix_spawn_file_actions_addopen(&fileActions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+    }
+    else
+    {
+        posix_spawn_file_actions_adddup2(&fileActions, pipeHandles[1], STDERR_FILENO);
+    }
 
-        // Fork an intermediate process to act as the parent for two more forked processes:
-        // one to actually execute the system command and the other to sleep and act as a timer.
-        // Whichever of these two children processes finishes first, that causes the other to be killed.
-        // The intermediate process exists as a parent for these (instead of the current process being
-        // the parent) to avoid collision with any other children processes.
+    // The command runs in its own process group so that a timeout or cancelation kills everything it started
+    posix_spawnattr_init(&attributes);
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK);
+    posix_spawnattr_setpgroup(&attributes, 0);
+    sigemptyset(&signals);
+    posix_spawnattr_setsigmask(&attributes, &signals);
+    sigaddset(&signals, SIGPIPE);
+    posix_spawnattr_setsigdefault(&attributes, &signals);
+
+    spawnStatus = posix_spawn(&workerProcess, "/bin/sh", &fileActions, &attributes, arguments, environ);
+
+    posix_spawnattr_destroy(&attributes);
+    posix_spawn_file_actions_destroy(&fileActions);
+    close(pipeHandles[1]);
+    if (NULL != input)
+    {
+        close(inputHandles[0]);
+    }
 
-        if (0 == (intermediateProcess = fork()))
+    if (0 != spawnStatus)
+    {
+        if (IsCommandLoggingEnabled())
+        {
+            OsConfigLogError(log, "Failed spawning process to execute command (%d)", spawnStatus);
+        }
+        close(pipeHandles[0]);
+        if (NULL != input)
         {
-            // Intermediate process
+            close(inputHandles[1]);
+        }
+        return -1;
+    }
 
-            if (0 == (workerProcess = fork()))
-            {
-                // Worker process
-                status = execl("/bin/sh", "sh", "-c", command, (char*)NULL);
-                _exit(status);
-            }
-            else if (workerProcess < 0)
-            {
-                // Intermediate process
-                if (IsCommandLoggingEnabled())
-                {
-                    OsConfigLogError(log, "Failed forking process to execute command");
-                }
-                status = -1;
+    fcntl(pipeHandles[0], F_SETFL, fcntl(pipeHandles[0], F_GETFL) | O_NONBLOCK);
+    if (NULL != input)
+    {
+        fcntl(inputHandles[1], F_SETFL, fcntl(inputHandles[1], F_GETFL) | O_NONBLOCK);
+    }
+    processHandle = OpenProcessHandle(workerProcess);
 
-                // Kill the timer process if created and wait on it before exiting otherwise timer becomes a zombie process
-                if (timerProcess > 0)
-                {
-                    KillProcess(timerProcess);
-                    waitpid(timerProcess, &intermediateStatus, 0);
-                }
-                _exit(status);
-            }
+    while (false == exited)
+    {
+        now = GetMonotonicMilliseconds();
+        waitMilliseconds = -1;
 
-            if (0 == (timerProcess = fork()))
+        if (limited)
+        {
+            if (now >= deadline)
             {
-                // Timer process
                 status = ETIME;
-                if (NULL == callback)
-                {
-                    sleep(timeout);
-                }
-                else
-                {
-                    while (totalWaitSeconds < timeout)
-                    {
-                        // If the callback returns non zero, cancel the command
-                        if (0 != callback(context))
-                        {
-                            status = ECANCELED;
-                            break;
-                        }
-                        sleep(callbackIntervalSeconds);
-                        totalWaitSeconds += callbackIntervalSeconds;
-                    }
-                }
-                _exit(status);
-            }
-            else if (timerProcess < 0)
-            {
-                // Intermediate process
-                if (IsCommandLoggingEnabled())
-                {
-                    OsConfigLogError(log, "Failed forking timer process");
-                }
-                status = -1;
-
-                // Kill the worker process if created and wait on it before exiting otherwise worker becomes a zombie process
-                if (workerProcess > 0)
-                {
-                    KillProcess(workerProcess);
-                    waitpid(workerProcess, &intermediateStatus, 0);
-                }
-                _exit(status);
+                break;
             }
 
-            // Wait on the child process (worker or timer) that finishes first
-            childProcess = waitpid(0, &status, 0);
-            status = NormalizeStatus(status);
-            if (childProcess == workerProcess)
-            {
-                if (IsCommandLoggingEnabled())
-                {
-                    OsConfigLogInfo(log, "Command execution complete with status %d", status);
-                }
-                KillProcess(timerProcess);
-            }
-            else
+            // If the callback returns non zero, cancel the command
+            if ((NULL != callback) && (now >= nextCallback))
             {
-                // Timer process is done, kill the timed out worker process
-                if (IsCommandLoggingEnabled())
+                if (0 != callback(context))
                 {
-                    OsConfigLogError(log, "Command timed out or it was canceled, command process killed (%d)", status);
+                    status = ECANCELED;
+                    break;
                 }
-                KillProcess(workerProcess);
+                nextCallback = now + (COMMAND_CALLBACK_INTERVAL_SECONDS * 1000);
             }
 
-            // Wait on the remaining child (either worker or timer) and exit (the intermediate process)
-            waitpid(0, &intermediateStatus, 0);
-            _exit(status);
+            waitMilliseconds = (int)(((NULL != callback) && (nextCallback < deadline)) ? (nextCallback - now) : (deadline - now));
         }
-        else if (intermediateProcess > 0)
+
+        if ((processHandle < 0) && ((waitMilliseconds < 0) || (waitMilliseconds > COMMAND_POLL_INTERVAL_MILLISECONDS)))
         {
-            // Wait on the intermediate process to finish
-            waitpid(intermediateProcess, &status, 0);
+            waitMilliseconds = COMMAND_POLL_INTERVAL_MILLISECONDS;
         }
-        else
+
+        // Negative handles are ignored by poll
+        handles[0].fd = pipeOpen ? pipeHandles[0] : -1;
+        handles[0].events = POLLIN;
+        handles[0].revents = 0;
+        handles[1].fd = processHandle;
+        handles[1].events = POLLIN;
+        handles[1].revents = 0;
+        handles[2].fd = cancelHandle;
+        handles[2].events = POLLIN;
+        handles[2].revents = 0;
+        handles[3].fd = inputHandles[1];
+        handles[3].events = POLLOUT;
+        handles[3].revents = 0;
+
+        if ((poll(handles, 4, waitMilliseconds) < 0) && (EINTR != errno))
         {
-            status = -1;
             if (IsCommandLoggingEnabled())
             {
-                OsConfigLogError(log, "Failed forking intermediate process");
+                OsConfigLogError(log, "Failed waiting for command (%d)", errno);
             }
+            status = -1;
+            break;
+        }
+
+        // The cancel handle is left readable, so that cancelation stays signaled for the caller
+        if (0 != handles[2].revents)
+        {
+            status = ECANCELED;
+            break;
+        }
+
+        if (pipeOpen && (0 != handles[0].revents))
+        {
+            pipeOpen = ReadOutput(pipeHandles[0], output);
+        }
+
+        if ((inputHandles[1] >= 0) && (0 != handles[3].revents) && !WriteInput(inputHandles[1], &input, &inputSize))
+        {
+            close(inputHandles[1]);
+            inputHandles[1] = -1;
+        }
+
+        if ((processHandle < 0) || (0 != handles[1].revents))
+        {
+            exited = (workerProcess == waitpid(workerProcess, &status, WNOHANG));
         }
     }
-    else
+
+    if (exited)
     {
-        if (IsCommandLoggingEnabled())
+        // Whatever the command wrote before exiting, without waiting on anything it left running in the background
+        if (pipeOpen)
         {
-            OsConfigLogInfo(log, "SystemCommand: executing command '%s' without timeout or cancelation on %s thread", 
-                command, mainProcessThread ? "main process" : "worker");
+            ReadOutput(pipeHandles[0], output);
         }
-        if (0 == (workerProcess = fork()))
+
+        status = NormalizeStatus(status);
+        if (IsCommandLoggingEnabled())
         {
-            // Worker process
-            status = execl("/bin/sh", "sh", "-c", command, (char*)NULL);
-            _exit(status);
+            OsConfigLogInfo(log, "Command execution complete with status %d", status);
         }
-        else if (workerProcess > 0)
+    }
+    else
+    {
+        if (IsCommandLoggingEnabled())
         {
-            // Wait on the worker process to terminate
-            waitpid(workerProcess, &status, 0);
+            OsConfigLogError(log, "Command timed out or it was canceled, command process killed (%d)", status);
         }
-        else
+        kill(-workerProcess, SIGKILL);
+        while ((waitpid(workerProcess, NULL, 0) < 0) && (EINTR == errno))
         {
-            // If our fork fails, try system(), if that also fails then the call fails
-            if (IsCommandLoggingEnabled())
-            {
-                OsConfigLogError(log, "Failed forking process to execute command, attempting system");
-            }
-            status = system(command);
         }
     }
 
-    status = NormalizeStatus(status);
+    if (processHandle >= 0)
+    {
+        close(processHandle);
+    }
+    if (inputHandles[1] >= 0)
+    {
+        close(inputHandles[1]);
+    }
+    close(pipeHandles[0]);
+
     if (IsCommandLoggingEnabled())
     {
         OsConfigLogInfo(log, "SystemCommand: command '%s' completed with %d", command, status);
@@ -219,26 +410,25 @@ static int SystemCommand(void* context, const char* command, int timeoutSeconds,
     return status;
 }
 
-#define MAX_COMMAND_RESULT_FILE_NAME 100
+// Replaces with spaces, in a single pass, all control characters from 0x00 to 0x1F except 0x0A (LF) when replaceEol is false,
+// 0x7F, plus 0x22 (") and 0x5C (\) characters that break the JSON envelope when forJson is true
+void SanitizeTextResult(char* text, size_t length, bool replaceEol, bool forJson)
+{
+    unsigned char next = 0;
+    size_t i = 0;
 
-int ExecuteCommand(void* context, const char* command, bool replaceEol, bool forJson, unsigned int maxTextResultBytes, unsigned int timeoutSeconds, char** textResult, CommandCallback callback, void* log)
+    for (i = 0; i < length; i++)
+    {
+        next = (unsigned char)text[i];
+        text[i] = ((next < 0x20) && (replaceEol || (EOL != next))) || (0x7F == next) || (forJson && (('"' == next) || ('\\' == next))) ? ' ' : (char)next;
+    }
+}
+
+static int CheckCommand(const char* command, void* log)
 {
-    const char g_commandTextResultFileTemplate[] = "/tmp/~OSConfig.TextResult%u";
-    const char g_commandSeparator[] = " > ";
-    const char g_commandTerminator[] = " 2>&1";
-    
-    int status = -1;
-    FILE* resultsFile = NULL;
-    int fileSize = 0;
-    int next = 0;
-    int i = 0;
-    char* commandLine = NULL;
-    size_t commandLineLength = 0;
     size_t maximumCommandLine = 0;
-    char commandTextResultFile[MAX_COMMAND_RESULT_FILE_NAME] = {0};
-    bool wrappedCommand = false;
 
-    if ((NULL == command) || (0 == system(NULL)))
+    if ((NULL == command) || (0 != access("/bin/sh", X_OK)))
     {
         if (IsCommandLoggingEnabled())
         {
@@ -247,135 +437,246 @@ int ExecuteCommand(void* context, const char* command, bool replaceEol, bool for
         return -1;
     }
 
-    commandLineLength = strlen(command);
-    wrappedCommand = (('(' == command[0]) || (')' == command[commandLineLength]));
-
-    // Append a random number to the results file to prevent parallel commands overwriting each other results
-    snprintf(commandTextResultFile, sizeof(commandTextResultFile), g_commandTextResultFileTemplate, rand());
-
-    commandLineLength += strlen(g_commandSeparator) + strlen(commandTextResultFile) + strlen(g_commandTerminator) + (wrappedCommand ? 0 : 2) + 1;
-
     maximumCommandLine = (size_t)sysconf(_SC_ARG_MAX);
-    if (commandLineLength > maximumCommandLine)
+    if ((strlen(command) + 1) > maximumCommandLine)
     {
         if (IsCommandLoggingEnabled())
         {
-            OsConfigLogError(log, "Cannot run command '%s', command too long (%u), ARG_MAX: %u", command, (unsigned)commandLineLength, (unsigned)maximumCommandLine);
+            OsConfigLogError(log, "Cannot run command '%s', command too long (%u), ARG_MAX: %u", command, (unsigned)(strlen(command) + 1), (unsigned)maximumCommandLine);
         }
         return E2BIG;
     }
 
-    commandLine = (char*)malloc(commandLineLength);
-    if (NULL == commandLine)
+    return 0;
+}
+
+static int ExecuteCommandInternal(void* context, const char* command, const char* input, size_t inputSize, bool replaceEol, bool forJson,
+    unsigned int maxTextResultBytes, unsigned int timeoutSeconds, char** textResult, CommandCallback callback, void* log)
+{
+    COMMAND_OUTPUT output = {0};
+    int status = -1;
+
+    if (0 != (status = CheckCommand(command, log)))
     {
-        if (IsCommandLoggingEnabled())
-        {
-            OsConfigLogError(log, "Cannot run command '%s', cannot allocate %u bytes for command, out of memory", command, (unsigned)commandLineLength);
-        }
-        return ENOMEM;
+        return status;
     }
 
-    snprintf(commandLine, commandLineLength, wrappedCommand ? "%s%s%s%s" : "(%s)%s%s%s", command, g_commandSeparator, commandTextResultFile, g_commandTerminator);
- 
-    // Execute the command with the requested timeout: error ETIME (62) means the command timed out
-    status = SystemCommand(context, commandLine, timeoutSeconds, callback, log);
+    // Truncate to desired maximum, if any, leaving room for the null terminator
+    output.keep = (NULL != textResult);
+    output.limit = (maxTextResultBytes > 0) ? (maxTextResultBytes - 1) : SIZE_MAX;
 
-    free(commandLine);
+    // Execute the command with the requested timeout: error ETIME (62) means the command timed out
+    status = SystemCommand(context, command, input, inputSize, timeoutSeconds, callback, -1, &output, log);
 
-    // Read the text result from the output of the command, if any, whether command succeeded or failed
-    if (NULL != textResult)
+    // The text result is the output of the command, if any, whether command succeeded or failed
+    if ((NULL != textResult) && (output.total > 0))
     {
-        resultsFile = fopen(commandTextResultFile, "r");
-        if (resultsFile)
+        // Nothing is kept when the maximum only leaves room for the null terminator
+        if (NULL == output.buffer)
         {
-            fseek(resultsFile, 0, SEEK_END);
-            fileSize = ftell(resultsFile);
-            fseek(resultsFile, 0, SEEK_SET);
-
-            if (fileSize > 0)
-            {
-                // Truncate to desired maximum, if any
-                if ((maxTextResultBytes > 0) && (((size_t)fileSize + 1) > maxTextResultBytes))
-                {
-                    fileSize = (maxTextResultBytes > 1) ? (maxTextResultBytes - 1) : 0;
-                }
-
-                *textResult = (char*)malloc(fileSize + 1);
-                if (NULL != *textResult)
-                {
-                    memset(*textResult, 0, fileSize + 1);
-                    for (i = 0; i < fileSize; i++)
-                    {
-                        next = fgetc(resultsFile);
-
-                        if (EOF == next)
-                        {
-                            break;
-                        }
-
-                        // Copy the data. Following characters are replaced with spaces:
-                        // all special characters from 0x00 to 0x1F except 0x0A (LF) when replaceEol is false
-                        // plus 0x22 (") and 0x5C (\) characters that break the JSON envelope when forJson is true
-                        if ((replaceEol && (EOL == next)) || ((next < 0x20) && (EOL != next)) || (0x7F == next) || (forJson && (('"' == next) || ('\\' == next))))
-                        {
-                            (*textResult)[i] = ' ';
-                        }
-                        else
-                        {
-                            (*textResult)[i] = (char)next;
-                        }
-                    }
-                }
-            }
+            output.buffer = (char*)calloc(1, 1);
+        }
 
-            fclose(resultsFile);
+        if (NULL != output.buffer)
+        {
+            SanitizeTextResult(output.buffer, output.size, replaceEol, forJson);
+            *textResult = output.buffer;
+            output.buffer = NULL;
         }
     }
 
-    remove(commandTextResultFile);
+    FREE_MEMORY(output.buffer);
 
     if (IsCommandLoggingEnabled())
     {
         OsConfigLogInfo(log, "Context: '%p'", context);
         OsConfigLogInfo(log, "Command: '%s'", command);
         OsConfigLogInfo(log, "Status: %d (errno: %d)", status, errno);
-        OsConfigLogInfo(log, "Text result: '%s'", (NULL != textResult) ? (*textResult) : "");
+        OsConfigLogInfo(log, "Text result: '%s'", ((NULL != textResult) && (NULL != *textResult)) ? (*textResult) : "");
     }
 
     return status;
 }
 
-char* HashCommand(const char* source, void* log)
+int ExecuteCommand(void* context, const char* command, bool replaceEol, bool forJson, unsigned int maxTextResultBytes, unsigned int timeoutSeconds, char** textResult, CommandCallback callback, void* log)
 {
-    static const char hashCommandTemplate[] = "%s | sha256sum | head -c 64";
-    
-    char* command = NULL;
-    char* hash = NULL;
-    int length = 0;
+    return ExecuteCommandInternal(context, command, NULL, 0, replaceEol, forJson, maxTextResultBytes, timeoutSeconds, textResult, callback, log);
+}
+
+int ExecuteCommandWithInput(const char* command, const char* input, size_t inputSize, bool replaceEol, unsigned int timeoutSeconds, char** textResult, void* log)
+{
+    return ExecuteCommandInternal(NULL, command, input ? input : "", input ? inputSize : 0, replaceEol, false, 0, timeoutSeconds, textResult, NULL, log);
+}
+
+int StreamCommand(void* context, const char* command, unsigned int timeoutSeconds, int cancelHandle, CommandOutputCallback outputCallback, void* log)
+{
+    COMMAND_OUTPUT output = {0};
     int status = -1;
 
-    if (NULL == source)
+    if (0 != (status = CheckCommand(command, log)))
+    {
+        return status;
+    }
+
+    // Nothing is buffered here, the output callback keeps what it needs
+    output.stream = outputCallback;
+    output.streamContext = context;
+
+    status = SystemCommand(context, command, NULL, 0, timeoutSeconds, NULL, cancelHandle, &output, log);
+
+    if (IsCommandLoggingEnabled())
+    {
+        OsConfigLogInfo(log, "Context: '%p'", context);
+        OsConfigLogInfo(log, "Command: '%s'", command);
+        OsConfigLogInfo(log, "Status: %d (errno: %d), %u bytes of output", status, errno, (unsigned)output.total);
+    }
+
+    return status;
+}
+
+#define SHA256_BLOCK_SIZE 64
+#define SHA256_DIGEST_SIZE 32
+#define SHA256_ROTATE_RIGHT(value, bits) (((value) >> (bits)) | ((value) << (32 - (bits))))
+
+static const uint32_t g_sha256RoundConstants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static void Sha256Block(uint32_t state[8], const unsigned char* block)
+{
+    uint32_t schedule[64] = {0};
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4], f = state[5], g = state[6], h = state[7];
+    uint32_t first = 0;
+    uint32_t second = 0;
+    int i = 0;
+
+    for (i = 0; i < 16; i++)
+    {
+        schedule[i] = ((uint32_t)block[i * 4] << 24) | ((uint32_t)block[i * 4 + 1] << 16) | ((uint32_t)block[i * 4 + 2] << 8) | (uint32_t)block[i * 4 + 3];
+    }
+
+    for (i = 16; i < 64; i++)
+    {
+        first = SHA256_ROTATE_RIGHT(schedule[i - 15], 7) ^ SHA256_ROTATE_RIGHT(schedule[i - 15], 18) ^ (schedule[i - 15] >> 3);
+        second = SHA256_ROTATE_RIGHT(schedule[i - 2], 17) ^ SHA256_ROTATE_RIGHT(schedule[i - 2], 19) ^ (schedule[i - 2] >> 10);
+        schedule[i] = schedule[i - 16] + first + schedule[i - 7] + second;
+    }
+
+    for (i = 0; i < 64; i++)
+    {
+        first = h + (SHA256_ROTATE_RIGHT(e, 6) ^ SHA256_ROTATE_RIGHT(e, 11) ^ SHA256_ROTATE_RIGHT(e, 25)) + ((e & f) ^ (~e & g)) + g_sha256RoundConstants[i] + schedule[i];
+        second = (SHA256_ROTATE_RIGHT(a, 2) ^ SHA256_ROTATE_RIGHT(a, 13) ^ SHA256_ROTATE_RIGHT(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + first;
+        d = c;
+        c = b;
+        b = a;
+        a = first + second;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+
+char* Sha256Buffer(const char* source, size_t length)
+{
+    uint32_t state[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+    unsigned char block[SHA256_BLOCK_SIZE] = {0};
+    uint64_t bitLength = 0;
+    size_t offset = 0;
+    size_t remaining = 0;
+    char* hash = NULL;
+    int i = 0;
+
+    if ((NULL == source) && (length > 0))
     {
         return NULL;
     }
 
-    length = (int)(strlen(source) + strlen(hashCommandTemplate));
-    command = (char*)malloc(length);
-    if (NULL != command)
+    bitLength = (uint64_t)length * 8;
+
+    for (offset = 0; (length - offset) >= SHA256_BLOCK_SIZE; offset += SHA256_BLOCK_SIZE)
     {
-        memset(command, 0, length);
-        snprintf(command, length, hashCommandTemplate, source);
-        
-        status = ExecuteCommand(NULL, command, false, false, 0, 0, &hash, NULL, log);
-        if (0 != status)
+        Sha256Block(state, (const unsigned char*)source + offset);
+    }
+
+    // Pad the tail with 0x80, zeros and the big endian bit length, spilling into a second block when needed
+    remaining = length - offset;
+    if (remaining > 0)
+    {
+        memcpy(block, source + offset, remaining);
+    }
+    block[remaining] = 0x80;
+
+    if (remaining >= (SHA256_BLOCK_SIZE - 8))
+    {
+        Sha256Block(state, block);
+        memset(block, 0, sizeof(block));
+    }
+
+    for (i = 0; i < 8; i++)
+    {
+        block[SHA256_BLOCK_SIZE - 1 - i] = (unsigned char)(bitLength >> (i * 8));
+    }
+
+    Sha256Block(state, block);
+
+    if (NULL != (hash = (char*)malloc((SHA256_DIGEST_SIZE * 2) + 1)))
+    {
+        for (i = 0; i < 8; i++)
         {
-            FREE_MEMORY(hash);
+            snprintf(hash + (i * 8), 9, "%08x", state[i]);
         }
     }
-    else
+
+    return hash;
+}
+
+char* Sha256String(const char* source)
+{
+    return (NULL != source) ? Sha256Buffer(source, strlen(source)) : NULL;
+}
+
+char* HashCommand(const char* source, void* log)
+{
+    COMMAND_OUTPUT output = {0};
+    char* hash = NULL;
+    int status = -1;
+
+    if ((NULL == source) || (0 != CheckCommand(source, log)))
     {
-        OsConfigLogError(log, "HashCommand: out of memory");
+        return NULL;
     }
 
-    return (0 == status) ? hash : NULL;
+    // Only the raw stdout bytes are hashed, unsanitized, giving the same value as piping the command through sha256sum
+    output.keep = true;
+    output.stdoutOnly = true;
+    output.limit = SIZE_MAX;
+
+    if (0 == (status = SystemCommand(NULL, source, NULL, 0, 0, NULL, -1, &output, log)))
+    {
+        if ((output.size < output.total) || (NULL == (hash = Sha256Buffer(output.buffer, output.size))))
+        {
+            OsConfigLogError(log, "HashCommand: out of memory");
+        }
+    }
+
+    FREE_MEMORY(output.buffer);
+
+    return hash;
 }
\ No newline at end of file
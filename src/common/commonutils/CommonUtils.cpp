@@ -87,15 +87,8 @@ bool IsValidClientName(const char* name)
     return isValid;
 }
 
-bool IsValidMimObjectPayload(const char* payload, const int payloadSizeBytes, void* log)
+static rapidjson::SchemaDocument* CompileMimObjectPayloadSchema()
 {
-    if ((0 == payloadSizeBytes) || (nullptr == payload))
-    {
-      return false;
-    }
-
-    bool isValid = true;
-
     const char schemaJson[] = R"""({
       "$schema": "http://json-schema.org/draft-04/schema#",
       "description": "MIM object JSON payload schema",
@@ -213,7 +206,20 @@ bool IsValidMimObjectPayload(const char* payload, const int payloadSizeBytes, vo
 
     rapidjson::Document sd;
     sd.Parse(schemaJson);
-    rapidjson::SchemaDocument schema(sd);
+    return new rapidjson::SchemaDocument(sd);
+}
+
+bool IsValidMimObjectPayload(const char* payload, const int payloadSizeBytes, void* log)
+{
+    if ((0 == payloadSizeBytes) || (nullptr == payload))
+    {
+      return false;
+    }
+
+    // Compiled once on first use, a SchemaDocument is immutable and safe to share between concurrent validators
+    static const std::unique_ptr<rapidjson::SchemaDocument> schema(CompileMimObjectPayloadSchema());
+
+    bool isValid = true;
     rapidjson::Document document;
 
     if (document.Parse(payload, payloadSizeBytes).HasParseError())
@@ -226,7 +232,7 @@ bool IsValidMimObjectPayload(const char* payload, const int payloadSizeBytes, vo
     }
     else
     {
-        rapidjson::SchemaValidator validator(schema);
+        rapidjson::SchemaValidator validator(*schema);
         if (!document.Accept(validator))
         {
             if (IsFullLoggingEnabled())
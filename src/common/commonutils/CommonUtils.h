@@ -50,10 +50,19 @@ void SetCommandLogging(bool commandLogging);
 bool IsCommandLoggingEnabled(void);
 
 typedef int(*CommandCallback)(void* context);
+typedef void(*CommandOutputCallback)(void* context, const char* output, size_t outputSize);
 
 // If called from the main process thread the timeoutSeconds and callback arguments are ignored
 int ExecuteCommand(void* context, const char* command, bool replaceEol, bool forJson, unsigned int maxTextResultBytes, unsigned int timeoutSeconds, char** textResult, CommandCallback callback, void* log);
 
+// Same as ExecuteCommand, with inputSize bytes of input written to the command's stdin
+int ExecuteCommandWithInput(const char* command, const char* input, size_t inputSize, bool replaceEol, unsigned int timeoutSeconds, char** textResult, void* log);
+
+// Same as ExecuteCommand, with the raw output handed to outputCallback as it is read instead of being returned at the end,
+// and the command killed as soon as cancelHandle (such as an eventfd, -1 for none) becomes readable
+int StreamCommand(void* context, const char* command, unsigned int timeoutSeconds, int cancelHandle, CommandOutputCallback outputCallback, void* log);
+void SanitizeTextResult(char* text, size_t length, bool replaceEol, bool forJson);
+
 int RestrictFileAccessToCurrentAccountOnly(const char* fileName);
 
 bool FileExists(const char* name);
@@ -62,6 +71,9 @@ char* DuplicateString(const char* source);
 
 size_t HashString(const char* source);
 
+char* Sha256Buffer(const char* source, size_t length);
+char* Sha256String(const char* source);
+
 char* HashCommand(const char* source, void* log);
 
 bool IsValidClientName(const char* name);
@@ -97,9 +109,20 @@ char* UrlDecode(char* target);
 bool LockFile(FILE* file, void* log);
 bool UnlockFile(FILE* file, void* log);
 
-char* ReadUriFromSocket(int socketHandle, void* log);
-int ReadHttpStatusFromSocket(int socketHandle, void* log);
-int ReadHttpContentLengthFromSocket(int socketHandle, void* log);
+typedef struct HTTP_MESSAGE
+{
+    // Request URI for 'POST /<uri>/' requests, NULL otherwise
+    char* uri;
+    // Status code for 'HTTP/1.1 <status>' responses, 404 otherwise
+    int httpStatus;
+    int contentLength;
+    bool keepAlive;
+    // Always allocated and null terminated, contentLength bytes long
+    char* body;
+} HTTP_MESSAGE;
+
+int ReadHttpMessageFromSocket(int socketHandle, HTTP_MESSAGE* message, void* log);
+void FreeHttpMessage(HTTP_MESSAGE* message);
 
 int SleepMilliseconds(long milliseconds);
 
@@ -119,10 +142,15 @@ typedef struct REPORTED_PROPERTY
 
 bool IsCommandLoggingEnabledInJsonConfig(const char* jsonString);
 bool IsFullLoggingEnabledInJsonConfig(const char* jsonString);
+bool IsMillisecondLoggingEnabledInJsonConfig(const char* jsonString);
 int GetReportingIntervalFromJsonConfig(const char* jsonString, void* log);
 int GetModelVersionFromJsonConfig(const char* jsonString, void* log);
 int GetLocalManagementFromJsonConfig(const char* jsonString, void* log);
 int GetIotHubProtocolFromJsonConfig(const char* jsonString, void* log);
+int GetMpiServerWorkersFromJsonConfig(const char* jsonString, void* log);
+int GetMaxQueuedConnectionsFromJsonConfig(const char* jsonString, void* log);
+int GetCommandRunnerWorkersFromJsonConfig(const char* jsonString, void* log);
+int GetCommandRunnerMaxConcurrentCommandsFromJsonConfig(const char* jsonString, void* log);
 int LoadReportedFromJsonConfig(const char* jsonString, REPORTED_PROPERTY** reportedProperties, void* log);
 
 int GetGitManagementFromJsonConfig(const char* jsonString, void* log);
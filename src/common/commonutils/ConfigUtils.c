@@ -18,6 +18,7 @@
 
 #define COMMAND_LOGGING "CommandLogging"
 #define FULL_LOGGING "FullLogging"
+#define MILLISECOND_LOGGING "MillisecondLogging"
 
 #define PROTOCOL "IotHubProtocol"
 
@@ -28,6 +29,28 @@
 #define MIN_DEVICE_MODEL_ID 7
 #define MAX_DEVICE_MODEL_ID 999
 
+#define MPI_SERVER_WORKERS "MpiServerWorkers"
+#define MAX_QUEUED_CONNECTIONS "MaxQueuedConnections"
+
+#define DEFAULT_MPI_SERVER_WORKERS 4
+#define MIN_MPI_SERVER_WORKERS 1
+#define MAX_MPI_SERVER_WORKERS 64
+
+#define DEFAULT_MAX_QUEUED_CONNECTIONS 32
+#define MIN_MAX_QUEUED_CONNECTIONS 1
+#define MAX_MAX_QUEUED_CONNECTIONS 4096
+
+#define COMMANDRUNNER_WORKERS "CommandRunnerWorkers"
+#define COMMANDRUNNER_MAX_CONCURRENT_COMMANDS "CommandRunnerMaxConcurrentCommands"
+
+#define DEFAULT_COMMANDRUNNER_WORKERS 4
+#define MIN_COMMANDRUNNER_WORKERS 1
+#define MAX_COMMANDRUNNER_WORKERS 64
+
+#define DEFAULT_COMMANDRUNNER_MAX_CONCURRENT_COMMANDS 1
+#define MIN_COMMANDRUNNER_MAX_CONCURRENT_COMMANDS 1
+#define MAX_COMMANDRUNNER_MAX_CONCURRENT_COMMANDS 64
+
 static bool IsLoggingEnabledInJsonConfig(const char* jsonString, const char* loggingSetting)
 {
     bool result = false;
@@ -59,6 +82,11 @@ bool IsFullLoggingEnabledInJsonConfig(const char* jsonString)
     return IsLoggingEnabledInJsonConfig(jsonString, FULL_LOGGING);
 }
 
+bool IsMillisecondLoggingEnabledInJsonConfig(const char* jsonString)
+{
+    return IsLoggingEnabledInJsonConfig(jsonString, MILLISECOND_LOGGING);
+}
+
 static int GetIntegerFromJsonConfig(const char* valueName, const char* jsonString, int defaultValue, int minValue, int maxValue, void* log)
 {
     JSON_Value* rootValue = NULL;
@@ -158,6 +186,27 @@ int GetIotHubProtocolFromJsonConfig(const char* jsonString, void* log)
     return GetIntegerFromJsonConfig(PROTOCOL, jsonString, PROTOCOL_AUTO, PROTOCOL_AUTO, PROTOCOL_MQTT_WS, log);
 }
 
+int GetMpiServerWorkersFromJsonConfig(const char* jsonString, void* log)
+{
+    return GetIntegerFromJsonConfig(MPI_SERVER_WORKERS, jsonString, DEFAULT_MPI_SERVER_WORKERS, MIN_MPI_SERVER_WORKERS, MAX_MPI_SERVER_WORKERS, log);
+}
+
+int GetMaxQueuedConnectionsFromJsonConfig(const char* jsonString, void* log)
+{
+    return GetIntegerFromJsonConfig(MAX_QUEUED_CONNECTIONS, jsonString, DEFAULT_MAX_QUEUED_CONNECTIONS, MIN_MAX_QUEUED_CONNECTIONS, MAX_MAX_QUEUED_CONNECTIONS, log);
+}
+
+int GetCommandRunnerWorkersFromJsonConfig(const char* jsonString, void* log)
+{
+    return GetIntegerFromJsonConfig(COMMANDRUNNER_WORKERS, jsonString, DEFAULT_COMMANDRUNNER_WORKERS, MIN_COMMANDRUNNER_WORKERS, MAX_COMMANDRUNNER_WORKERS, log);
+}
+
+int GetCommandRunnerMaxConcurrentCommandsFromJsonConfig(const char* jsonString, void* log)
+{
+    return GetIntegerFromJsonConfig(COMMANDRUNNER_MAX_CONCURRENT_COMMANDS, jsonString, DEFAULT_COMMANDRUNNER_MAX_CONCURRENT_COMMANDS,
+        MIN_COMMANDRUNNER_MAX_CONCURRENT_COMMANDS, MAX_COMMANDRUNNER_MAX_CONCURRENT_COMMANDS, log);
+}
+
 int LoadReportedFromJsonConfig(const char* jsonString, REPORTED_PROPERTY** reportedProperties, void* log)
 {
     JSON_Value* rootValue = NULL;
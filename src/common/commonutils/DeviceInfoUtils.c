@@ -18,7 +18,7 @@ void RemovePrefixBlanks(char* target)
         i += 1;
     }
 
-    memcpy(target, target + i, targetLength - i);
+    memmove(target, target + i, targetLength - i);
     target[targetLength - i] = 0;
 }
 
@@ -35,7 +35,7 @@ void RemovePrefixUpTo(char* target, char marker)
     if (equalSign)
     {
         targetLength = strlen(equalSign + 1);
-        memcpy(target, equalSign + 1, targetLength);
+        memmove(target, equalSign + 1, targetLength);
         target[targetLength] = 0;
     }
 }
@@ -72,13 +72,88 @@ void TruncateAtFirst(char* target, char marker)
     }
 }
 
+static void NormalizePropertyValue(char* value)
+{
+    size_t i = 0;
+
+    // Same as the text results of the commands: control characters, quotes and backslashes become blanks
+    for (i = 0; 0 != value[i]; i++)
+    {
+        if ((((unsigned char)value[i]) < 0x20) || (0x7F == value[i]) || ('"' == value[i]) || ('\\' == value[i]))
+        {
+            value[i] = ' ';
+        }
+    }
+
+    RemovePrefixBlanks(value);
+    RemoveTrailingBlanks(value);
+}
+
+// Reads the value from the first line of a name/value file (such as 'NAME=value' in /etc/os-release or 'name : value' in /proc/cpuinfo),
+// or the first line of the file when no name is given (such as /sys/devices/virtual/dmi/id/product_name). Returns NULL when not found or empty
+static char* GetPropertyFromFile(const char* fileName, const char* name, char separator)
+{
+    FILE* file = NULL;
+    char* line = NULL;
+    char* found = NULL;
+    char* value = NULL;
+    size_t lineSize = 0;
+    size_t nameLength = name ? strlen(name) : 0;
+
+    if (NULL == (file = fopen(fileName, "r")))
+    {
+        return NULL;
+    }
+
+    while ((NULL == value) && (-1 != getline(&line, &lineSize, file)))
+    {
+        if (NULL == name)
+        {
+            value = DuplicateString(line);
+        }
+        else if ((0 == strncmp(line, name, nameLength)) && (NULL != (found = strchr(line + nameLength, separator))) &&
+            (strspn(line + nameLength, " \t") == (size_t)(found - (line + nameLength))))
+        {
+            value = DuplicateString(found + 1);
+        }
+    }
+
+    FREE_MEMORY(line);
+    fclose(file);
+
+    if (NULL != value)
+    {
+        NormalizePropertyValue(value);
+        if (0 == value[0])
+        {
+            FREE_MEMORY(value);
+        }
+    }
+
+    return value;
+}
+
+static long GetMemoryFromFile(const char* name)
+{
+    char* value = GetPropertyFromFile("/proc/meminfo", name, ':');
+    long memory = value ? atol(value) : 0;
+    FREE_MEMORY(value);
+    return memory;
+}
+
 char* GetOsName(void* log)
 {
     const char* osNameCommand = "cat /etc/os-release | grep ID=";
     const char* osPrettyNameCommand = "cat /etc/os-release | grep PRETTY_NAME=";
     char* textResult = NULL;
 
-    if (0 == ExecuteCommand(NULL, osPrettyNameCommand, true, true, 0, 0, &textResult, NULL, log))
+    if ((NULL != (textResult = GetPropertyFromFile("/etc/os-release", "PRETTY_NAME", '='))) ||
+        (NULL != (textResult = GetPropertyFromFile("/etc/os-release", "ID", '='))))
+    {
+        // Comment next line to capture the full pretty name including version (example: 'Ubuntu 20.04.3 LTS')
+        TruncateAtFirst(textResult, ' ');
+    }
+    else if (0 == ExecuteCommand(NULL, osPrettyNameCommand, true, true, 0, 0, &textResult, NULL, log))
     {
         RemovePrefixBlanks(textResult);
         RemoveTrailingBlanks(textResult);
@@ -120,7 +195,11 @@ char* GetOsVersion(void* log)
     const char* osVersionCommand = "cat /etc/os-release | grep VERSION=";
     char* textResult = NULL;
 
-    if (0 == ExecuteCommand(NULL, osVersionCommand, true, true, 0, 0, &textResult, NULL, log))
+    if (NULL != (textResult = GetPropertyFromFile("/etc/os-release", "VERSION", '=')))
+    {
+        TruncateAtFirst(textResult, ' ');
+    }
+    else if (0 == ExecuteCommand(NULL, osVersionCommand, true, true, 0, 0, &textResult, NULL, log))
     {
         RemovePrefixBlanks(textResult);
         RemoveTrailingBlanks(textResult);
@@ -192,7 +271,13 @@ static char* GetAnotherOsProperty(const char* command, void* log)
 char* GetOsKernelName(void* log)
 {
     static char* osKernelNameCommand = "uname -s";
-    char* textResult = GetAnotherOsProperty(osKernelNameCommand, log);
+    struct utsname kernel = {0};
+    char* textResult = (0 == uname(&kernel)) ? DuplicateString(kernel.sysname) : NULL;
+
+    if (NULL == textResult)
+    {
+        textResult = GetAnotherOsProperty(osKernelNameCommand, log);
+    }
     
     if (IsFullLoggingEnabled())
     {
@@ -205,7 +290,13 @@ char* GetOsKernelName(void* log)
 char* GetOsKernelRelease(void* log)
 {
     static char* osKernelReleaseCommand = "uname -r";
-    char* textResult = GetAnotherOsProperty(osKernelReleaseCommand, log);
+    struct utsname kernel = {0};
+    char* textResult = (0 == uname(&kernel)) ? DuplicateString(kernel.release) : NULL;
+
+    if (NULL == textResult)
+    {
+        textResult = GetAnotherOsProperty(osKernelReleaseCommand, log);
+    }
     
     if (IsFullLoggingEnabled())
     {
@@ -218,7 +309,13 @@ char* GetOsKernelRelease(void* log)
 char* GetOsKernelVersion(void* log)
 {
     static char* osKernelVersionCommand = "uname -v";
-    char* textResult = GetAnotherOsProperty(osKernelVersionCommand, log);
+    struct utsname kernel = {0};
+    char* textResult = (0 == uname(&kernel)) ? DuplicateString(kernel.version) : NULL;
+
+    if (NULL == textResult)
+    {
+        textResult = GetAnotherOsProperty(osKernelVersionCommand, log);
+    }
     
     if (IsFullLoggingEnabled())
     {
@@ -231,7 +328,13 @@ char* GetOsKernelVersion(void* log)
 char* GetCpuType(void* log)
 {
     const char* osCpuTypeCommand = "lscpu | grep Architecture:";
-    char* textResult = GetHardwareProperty(osCpuTypeCommand, false, log);
+    struct utsname kernel = {0};
+    char* textResult = (0 == uname(&kernel)) ? DuplicateString(kernel.machine) : NULL;
+
+    if (NULL == textResult)
+    {
+        textResult = GetHardwareProperty(osCpuTypeCommand, false, log);
+    }
     
     if (IsFullLoggingEnabled())
     {
@@ -244,7 +347,13 @@ char* GetCpuType(void* log)
 char* GetCpuVendor(void* log)
 {
     const char* osCpuVendorCommand = "lscpu | grep \"Vendor ID:\"";
-    char* textResult = GetHardwareProperty(osCpuVendorCommand, false, log);
+    char* textResult = GetPropertyFromFile("/proc/cpuinfo", "vendor_id", ':');
+
+    // Not all architectures have the vendor in /proc/cpuinfo (for example ARM where lscpu decodes it)
+    if (NULL == textResult)
+    {
+        textResult = GetHardwareProperty(osCpuVendorCommand, false, log);
+    }
     
     if (IsFullLoggingEnabled())
     {
@@ -257,7 +366,12 @@ char* GetCpuVendor(void* log)
 char* GetCpuModel(void* log)
 {
     const char* osCpuModelCommand = "lscpu | grep \"Model name:\"";
-    char* textResult = GetHardwareProperty(osCpuModelCommand, false, log);
+    char* textResult = GetPropertyFromFile("/proc/cpuinfo", "model name", ':');
+
+    if (NULL == textResult)
+    {
+        textResult = GetHardwareProperty(osCpuModelCommand, false, log);
+    }
     
     if (IsFullLoggingEnabled())
     {
@@ -270,12 +384,13 @@ char* GetCpuModel(void* log)
 long GetTotalMemory(void* log)
 {
     const char* osTotalMemoryCommand = "grep MemTotal /proc/meminfo";
-    char* textResult = GetHardwareProperty(osTotalMemoryCommand, true, log);
-    long totalMemory = 0;
+    char* textResult = NULL;
+    long totalMemory = GetMemoryFromFile("MemTotal");
     
-    if (NULL != textResult)
+    if ((0 == totalMemory) && (NULL != (textResult = GetHardwareProperty(osTotalMemoryCommand, true, log))))
     {
         totalMemory = atol(textResult);
+        FREE_MEMORY(textResult);
     }
     
     if (IsFullLoggingEnabled())
@@ -289,12 +404,13 @@ long GetTotalMemory(void* log)
 long GetFreeMemory(void* log)
 {
     const char* osFreeMemoryCommand = "grep MemFree /proc/meminfo";
-    char* textResult = GetHardwareProperty(osFreeMemoryCommand, true, log);
-    long freeMemory = 0;
+    char* textResult = NULL;
+    long freeMemory = GetMemoryFromFile("MemFree");
     
-    if (NULL != textResult)
+    if ((0 == freeMemory) && (NULL != (textResult = GetHardwareProperty(osFreeMemoryCommand, true, log))))
     {
         freeMemory = atol(textResult);
+        FREE_MEMORY(textResult);
     }
 
     if (IsFullLoggingEnabled())
@@ -307,11 +423,10 @@ long GetFreeMemory(void* log)
 
 char* GetProductName(void* log)
 {
-    const char* osProductNameCommand = "cat /sys/devices/virtual/dmi/id/product_name";
     const char* osProductNameAlternateCommand = "lshw -c system | grep -m 1 \"product:\"";
-    char* textResult = GetAnotherOsProperty(osProductNameCommand, log);
+    char* textResult = GetPropertyFromFile("/sys/devices/virtual/dmi/id/product_name", NULL, 0);
     
-    if ((NULL == textResult) || (0 == strlen(textResult)))
+    if (NULL == textResult)
     {
         textResult = GetHardwareProperty(osProductNameAlternateCommand, false, log);
     }
@@ -326,11 +441,10 @@ char* GetProductName(void* log)
 
 char* GetProductVendor(void* log)
 {
-    const char* osProductVendorCommand = "cat /sys/devices/virtual/dmi/id/sys_vendor";
     const char* osProductVendorAlternateCommand = "lshw -c system | grep -m 1 \"vendor:\"";
-    char* textResult = GetAnotherOsProperty(osProductVendorCommand, log);
+    char* textResult = GetPropertyFromFile("/sys/devices/virtual/dmi/id/sys_vendor", NULL, 0);
 
-    if ((NULL == textResult) || (0 == strlen(textResult)))
+    if (NULL == textResult)
     {
         textResult = GetHardwareProperty(osProductVendorAlternateCommand, false, log);
     }
@@ -345,11 +459,10 @@ char* GetProductVendor(void* log)
 
 char* GetProductVersion(void* log)
 {
-    const char* osProductVersionCommand = "cat /sys/devices/virtual/dmi/id/product_version";
     const char* osProductVersionAlternateCommand = "lshw -c system | grep -m 1 \"version:\"";
-    char* textResult = GetHardwareProperty(osProductVersionCommand, false, log);
+    char* textResult = GetPropertyFromFile("/sys/devices/virtual/dmi/id/product_version", NULL, 0);
 
-    if ((NULL == textResult) || (0 == strlen(textResult)))
+    if (NULL == textResult)
     {
         textResult = GetHardwareProperty(osProductVersionAlternateCommand, false, log);
     }
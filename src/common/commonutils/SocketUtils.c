@@ -4,207 +4,210 @@
 #include "Internal.h"
 
 #define MAX_MPI_URI_LENGTH 32
+#define HTTP_READ_BUFFER_SIZE 1024
+#define MAX_HTTP_HEADERS_SIZE 65536
+#define MAX_HTTP_CONTENT_LENGTH 0x7FFFFFFE
 
-static char* ReadUntilStringFound(int socketHandle, const char* what, void* log)
+// Reads the start line and headers with a few large reads (not one byte at a time) and parses them in one pass,
+// then reads the body, starting with whatever part of it arrived together with the headers
+int ReadHttpMessageFromSocket(int socketHandle, HTTP_MESSAGE* message, void* log)
 {
-    char* found = NULL;
-    char* buffer = NULL;
-    int size = 1;
+    const char* postPrefix = "POST /";
+    const char* httpPrefix = "HTTP/1.1 ";
+    const char* contentLengthLabel = "Content-Length:";
+    const char* connectionLabel = "Connection:";
+    const char* keepAliveValue = "keep-alive";
+    const char* doubleTerminator = "\r\n\r\n";
 
-    if ((NULL == what) || (socketHandle < 0))
+    char* buffer = NULL;
+    char* newBuffer = NULL;
+    char* headersEnd = NULL;
+    char* line = NULL;
+    char* lineEnd = NULL;
+    char* value = NULL;
+    size_t capacity = HTTP_READ_BUFFER_SIZE;
+    size_t size = 0;
+    size_t searchFrom = 0;
+    size_t headersSize = 0;
+    size_t available = 0;
+    size_t uriLength = 0;
+    long contentLength = 0;
+    ssize_t bytes = 0;
+    int status = 0;
+
+    if ((socketHandle < 0) || (NULL == message))
     {
-        OsConfigLogError(log, "ReadUntilStringFound: invalid arguments");
-        return NULL;
+        OsConfigLogError(log, "ReadHttpMessageFromSocket: invalid arguments");
+        return EINVAL;
     }
 
-    buffer = (char*)malloc(size + 1);
-    if (NULL == buffer)
+    memset(message, 0, sizeof(HTTP_MESSAGE));
+    message->httpStatus = 404;
+
+    if (NULL == (buffer = (char*)malloc(capacity)))
     {
-        OsConfigLogError(log, "ReadUntilStringFound: out of memory allocating initial buffer");
-        return NULL;
+        OsConfigLogError(log, "ReadHttpMessageFromSocket: out of memory");
+        return ENOMEM;
     }
 
-    memset(buffer, 0, size + 1);
-
-    while (1 == read(socketHandle, &(buffer[size - 1]), 1))
+    while (NULL == headersEnd)
     {
-        if (NULL != (found = strstr(buffer, what)))
+        if ((size + 1) >= capacity)
         {
-            buffer[size] = 0;
-            break;
-        }
-        else
-        {
-            size += 1;
-            buffer = (char*)realloc(buffer, size + 1);
-            if (NULL == buffer)
+            if ((capacity * 2) > MAX_HTTP_HEADERS_SIZE)
             {
-                OsConfigLogError(log, "ReadUntilStringFound: out of memory reallocating buffer");
+                OsConfigLogError(log, "ReadHttpMessageFromSocket: headers exceed %d bytes", MAX_HTTP_HEADERS_SIZE);
+                status = EMSGSIZE;
                 break;
             }
-            else
+            else if (NULL == (newBuffer = (char*)realloc(buffer, capacity * 2)))
             {
-                buffer[size] = 0;
+                OsConfigLogError(log, "ReadHttpMessageFromSocket: out of memory");
+                status = ENOMEM;
+                break;
             }
-        }
-    }
 
-    if (NULL == found)
-    {
-        FREE_MEMORY(buffer);
-    }
+            buffer = newBuffer;
+            capacity *= 2;
+        }
 
-    return buffer;
-}
+        if (0 > (bytes = read(socketHandle, buffer + size, capacity - size - 1)))
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+            status = errno ? errno : EIO;
+            break;
+        }
+        else if (0 == bytes)
+        {
+            // End of stream, with nothing read this is a peer that closed the connection
+            status = (0 == size) ? ENODATA : EPROTO;
+            break;
+        }
 
-char* ReadUriFromSocket(int socketHandle, void* log)
-{
-    const char* postPrefix = "POST /";
-    char* returnUri = NULL;
-    char* buffer = NULL;
-    char bufferUri[MAX_MPI_URI_LENGTH] = {0};
-    int uriLength = 0;
-    size_t i = 0;
+        size += (size_t)bytes;
+        buffer[size] = 0;
 
-    if (socketHandle < 0)
-    {
-        OsConfigLogError(log, "ReadUriFromSocket: invalid socket (%d)", socketHandle);
-        return NULL;
+        headersEnd = strstr(buffer + searchFrom, doubleTerminator);
+        searchFrom = (size > 3) ? (size - 3) : 0;
     }
 
-    buffer = ReadUntilStringFound(socketHandle, postPrefix, log);
-    if (NULL == buffer)
+    if (0 == status)
     {
-        OsConfigLogError(log, "ReadUriFromSocket: '%s' prefix not found", postPrefix);
-        return NULL;
-    }
+        *headersEnd = 0;
+        headersSize = (size_t)(headersEnd - buffer) + strlen(doubleTerminator);
 
-    FREE_MEMORY(buffer);
-    
-    for (i = 0; i < sizeof(bufferUri); i++)
-    {
-        if (1 == read(socketHandle, &(bufferUri[i]), 1))
+        if (0 == strncmp(buffer, postPrefix, strlen(postPrefix)))
         {
-            if (isalpha(bufferUri[i]))
+            line = buffer + strlen(postPrefix);
+            while ((uriLength < MAX_MPI_URI_LENGTH) && isalpha(line[uriLength]))
             {
-                continue;
+                uriLength += 1;
+            }
+
+            if (NULL != (message->uri = (char*)malloc(uriLength + 1)))
+            {
+                memcpy(message->uri, line, uriLength);
+                message->uri[uriLength] = 0;
             }
             else
             {
-                break;
+                OsConfigLogError(log, "ReadHttpMessageFromSocket: out of memory");
+                status = ENOMEM;
             }
         }
-    }
-
-    uriLength = i;
+        else if ((0 == strncmp(buffer, httpPrefix, strlen(httpPrefix))) && isdigit(buffer[9]) && (buffer[9] >= '1') && (buffer[9] <= '5') &&
+            isdigit(buffer[10]) && isdigit(buffer[11]) && (!isdigit(buffer[12])))
+        {
+            message->httpStatus = (buffer[9] - '0') * 100 + (buffer[10] - '0') * 10 + (buffer[11] - '0');
+        }
 
-    returnUri = (char*)malloc(uriLength + 1);
-    if (NULL != returnUri)
-    {
-        memset(returnUri, 0, uriLength + 1);
-        strncpy(returnUri, bufferUri, uriLength);
-        
-        if (IsFullLoggingEnabled())
+        for (line = strstr(buffer, "\r\n"); (0 == status) && (NULL != line); line = lineEnd)
         {
-            OsConfigLogInfo(log, "ReadUriFromSocket: %s", returnUri);
+            line += 2;
+            lineEnd = strstr(line, "\r\n");
+
+            if (0 == strncasecmp(line, contentLengthLabel, strlen(contentLengthLabel)))
+            {
+                value = line + strlen(contentLengthLabel);
+                contentLength = strtol(value, NULL, 10);
+                if ((contentLength < 0) || (contentLength > MAX_HTTP_CONTENT_LENGTH))
+                {
+                    OsConfigLogError(log, "ReadHttpMessageFromSocket: invalid Content-Length %ld", contentLength);
+                    status = EMSGSIZE;
+                }
+            }
+            else if (0 == strncasecmp(line, connectionLabel, strlen(connectionLabel)))
+            {
+                value = line + strlen(connectionLabel);
+                value += strspn(value, " \t");
+                message->keepAlive = (0 == strncasecmp(value, keepAliveValue, strlen(keepAliveValue))) ? true : false;
+            }
         }
     }
-    else
+
+    if (0 == status)
     {
-        OsConfigLogError(log, "ReadUriFromSocket: out of memory");
-    }
+        message->contentLength = (int)contentLength;
 
-    return returnUri;
-}
+        if (NULL != (message->body = (char*)malloc(contentLength + 1)))
+        {
+            available = ((size - headersSize) < (size_t)contentLength) ? (size - headersSize) : (size_t)contentLength;
+            memcpy(message->body, buffer + headersSize, available);
 
-int ReadHttpStatusFromSocket(int socketHandle, void* log)
-{
-    const char* httpPrefix = "HTTP/1.1";
+            while (available < (size_t)contentLength)
+            {
+                if (0 < (bytes = read(socketHandle, message->body + available, contentLength - available)))
+                {
+                    available += (size_t)bytes;
+                }
+                else if ((0 > bytes) && (EINTR == errno))
+                {
+                    continue;
+                }
+                else
+                {
+                    OsConfigLogError(log, "ReadHttpMessageFromSocket: failed to read complete body, %d bytes of %ld", (int)available, contentLength);
+                    status = ((0 > bytes) && errno) ? errno : EPROTO;
+                    break;
+                }
+            }
 
-    int httpStatus = 404;
-    char* buffer = NULL;
-    char status[4] = {0};
-    char expectedSpace = 'x';
-        
-    if (socketHandle < 0)
-    {
-        OsConfigLogError(log, "ReadHttpStatusFromSocket: invalid socket (%d)", socketHandle);
-        return httpStatus;
+            message->body[available] = 0;
+        }
+        else
+        {
+            OsConfigLogError(log, "ReadHttpMessageFromSocket: out of memory for body of %ld bytes", contentLength);
+            status = ENOMEM;
+        }
     }
 
-    buffer = ReadUntilStringFound(socketHandle, httpPrefix, log);
-    if (NULL == buffer)
+    if ((0 == status) && IsFullLoggingEnabled())
     {
-        OsConfigLogError(log, "ReadHttpStatusFromSocket: '%s' prefix not found", httpPrefix);
-        return httpStatus;
+        OsConfigLogInfo(log, "ReadHttpMessageFromSocket: uri '%s', status %d, Content-Length %d, keep-alive %s",
+            message->uri ? message->uri : "", message->httpStatus, message->contentLength, message->keepAlive ? "yes" : "no");
     }
 
-    if ((1 == read(socketHandle, &expectedSpace, 1)) && (' ' == expectedSpace) && 
-        (3 == read(socketHandle, status, 3)) && (isdigit(status[0]) && (status[0] >= '1') && (status[0] <= '5') && isdigit(status[1]) && isdigit(status[2])))
+    if (0 != status)
     {
-        httpStatus = atoi(status);
-        
-        if (IsFullLoggingEnabled())
-        {
-            OsConfigLogInfo(log, "ReadHttpStatusFromSocket: %d ('%s')", httpStatus, status);
-        }
+        FreeHttpMessage(message);
+        message->httpStatus = 404;
     }
 
     FREE_MEMORY(buffer);
 
-    return httpStatus;
+    return status;
 }
 
-int ReadHttpContentLengthFromSocket(int socketHandle, void* log)
+void FreeHttpMessage(HTTP_MESSAGE* message)
 {
-    const char* contentLengthLabel = "Content-Length: ";
-    const char* doubleTerminator = "\r\n\r\n";
-
-    int httpContentLength = 0;
-    char* buffer = NULL;
-    char* contentLength = NULL;
-    char isolatedContentLength[64] = {0};
-    size_t i = 0;
-
-    if (socketHandle < 0)
-    {
-        OsConfigLogError(log, "ReadHttpContentLengthFromSocket: invalid socket (%d)", socketHandle);
-        return httpContentLength;
-    }
-
-    buffer = ReadUntilStringFound(socketHandle, doubleTerminator, log);
-    if (NULL != buffer)
+    if (NULL != message)
     {
-        contentLength = strstr(buffer, contentLengthLabel);
-        if (NULL != contentLength)
-        {
-            contentLength += strlen(contentLengthLabel);
-            
-            for (i = 0; i < sizeof(isolatedContentLength) - 1; i++)
-            {
-                if (isdigit(contentLength[i]))
-                {
-                    isolatedContentLength[i] = contentLength[i];
-                }
-                else
-                {
-                    break;
-                }
-            }
-
-            if (isdigit(isolatedContentLength[0]))
-            {
-                httpContentLength = atoi(isolatedContentLength);
-                
-                if (IsFullLoggingEnabled())
-                {
-                    OsConfigLogInfo(log, "ReadHttpContentLengthFromSocket: %d ('%s')", httpContentLength, isolatedContentLength);
-                }
-            }
-        }
-        
-        FREE_MEMORY(buffer);
+        FREE_MEMORY(message->uri);
+        FREE_MEMORY(message->body);
+        message->contentLength = 0;
+        message->keepAlive = false;
     }
-
-    return httpContentLength;
-}
\ No newline at end of file
+}
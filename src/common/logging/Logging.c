@@ -4,17 +4,27 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdarg.h>
 #include <string.h>
 #include <assert.h>
 #include <time.h>
 #include <errno.h>
+#include <pthread.h>
+#include <signal.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include "Logging.h"
 
 #define MAX_LOG_TRIM 1000
 
+// Lines queued for the background writer, per log, lines that do not fit are dropped and counted
+#define LOG_BUFFER_SIZE 65536
+
+// Lines are formatted on the stack when they fit, otherwise in a heap allocation
+#define LOG_LINE_SIZE 1024
+
 static bool g_fullLoggingEnabled = false;
+static bool g_millisecondLoggingEnabled = false;
 
 typedef struct OSCONFIG_LOG
 {
@@ -22,8 +32,32 @@ typedef struct OSCONFIG_LOG
     const char* logFileName;
     const char* backLogFileName;
     unsigned int trimLogCount;
+
+    // Ring of formatted lines, head and tail count bytes queued and written since the log was opened
+    char* buffer;
+    size_t head;
+    size_t tail;
+    unsigned long long dropped;
+    size_t droppedAt;
+    bool writing;
+    bool stopping;
+    bool writerStarted;
+    bool synchronous;
+    pthread_t writer;
+    pthread_mutex_t mutex;
+    pthread_cond_t queued;
+    pthread_cond_t written;
+
+    // The process that opened the log, a forked child writes synchronously as it does not have the writer thread
+    pid_t owner;
+    struct OSCONFIG_LOG* next;
 } OSCONFIG_LOG;
 
+// Open logs, flushed at exit
+static OSCONFIG_LOG* g_logs = NULL;
+static pthread_mutex_t g_logsMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t g_logsAtExit = PTHREAD_ONCE_INIT;
+
 void SetFullLogging(bool fullLogging)
 {
     g_fullLoggingEnabled = fullLogging;
@@ -34,11 +68,38 @@ bool IsFullLoggingEnabled()
     return g_fullLoggingEnabled;
 }
 
+void SetMillisecondLogging(bool millisecondLogging)
+{
+    g_millisecondLoggingEnabled = millisecondLogging;
+}
+
+bool IsMillisecondLoggingEnabled()
+{
+    return g_millisecondLoggingEnabled;
+}
+
 static int RestrictAccessToRootOnly(const char* fileName)
 {
     return chmod(fileName, S_ISUID | S_ISGID | S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IXUSR | S_IXGRP);
 }
 
+static void FlushLogsAtExit(void)
+{
+    OSCONFIG_LOG* log = NULL;
+
+    pthread_mutex_lock(&g_logsMutex);
+    for (log = g_logs; NULL != log; log = log->next)
+    {
+        FlushLog((OSCONFIG_LOG_HANDLE)log);
+    }
+    pthread_mutex_unlock(&g_logsMutex);
+}
+
+static void RegisterFlushLogsAtExit(void)
+{
+    atexit(FlushLogsAtExit);
+}
+
 OSCONFIG_LOG_HANDLE OpenLog(const char* logFileName, const char* bakLogFileName)
 {
     OSCONFIG_LOG* newLog = (OSCONFIG_LOG*)malloc(sizeof(OSCONFIG_LOG));
@@ -51,6 +112,7 @@ OSCONFIG_LOG_HANDLE OpenLog(const char* logFileName, const char* bakLogFileName)
 
     newLog->logFileName = logFileName;
     newLog->backLogFileName = newLog->logFileName ? bakLogFileName : NULL;
+    newLog->owner = getpid();
 
     if (NULL != newLog->logFileName)
     {
@@ -63,23 +125,78 @@ OSCONFIG_LOG_HANDLE OpenLog(const char* logFileName, const char* bakLogFileName)
         RestrictAccessToRootOnly(newLog->backLogFileName);
     }
 
+    // Without a buffer the log is written synchronously by the callers
+    newLog->buffer = (char*)malloc(LOG_BUFFER_SIZE);
+    newLog->synchronous = (NULL == newLog->buffer);
+
+    pthread_mutex_init(&newLog->mutex, NULL);
+    pthread_cond_init(&newLog->queued, NULL);
+    pthread_cond_init(&newLog->written, NULL);
+
+    pthread_once(&g_logsAtExit, RegisterFlushLogsAtExit);
+    pthread_mutex_lock(&g_logsMutex);
+    newLog->next = g_logs;
+    g_logs = newLog;
+    pthread_mutex_unlock(&g_logsMutex);
+
     return (OSCONFIG_LOG_HANDLE)newLog;
 }
 
 void CloseLog(OSCONFIG_LOG_HANDLE* log)
 {
+    OSCONFIG_LOG** link = NULL;
+    bool owned = false;
+
     if ((NULL == log) || (NULL == (*log)))
     {
         return;
     }
 
     OSCONFIG_LOG* logToClose = (OSCONFIG_LOG*)(*log);
+    owned = (logToClose->owner == getpid());
+
+    if (owned)
+    {
+        pthread_mutex_lock(&g_logsMutex);
+    }
+    for (link = &g_logs; NULL != *link; link = &((*link)->next))
+    {
+        if (*link == logToClose)
+        {
+            *link = logToClose->next;
+            break;
+        }
+    }
+    if (owned)
+    {
+        pthread_mutex_unlock(&g_logsMutex);
+    }
+
+    // Write out everything still queued, in a forked child the writer thread does not exist
+    if (owned && logToClose->writerStarted)
+    {
+        pthread_mutex_lock(&logToClose->mutex);
+        logToClose->stopping = true;
+        pthread_cond_signal(&logToClose->queued);
+        pthread_mutex_unlock(&logToClose->mutex);
+
+        pthread_join(logToClose->writer, NULL);
+    }
+
+    if (owned)
+    {
+        pthread_cond_destroy(&logToClose->written);
+        pthread_cond_destroy(&logToClose->queued);
+        pthread_mutex_destroy(&logToClose->mutex);
+    }
 
     if (NULL != logToClose->log)
     {
         fclose(logToClose->log);
     }
 
+    free(logToClose->buffer);
+
     memset(logToClose, 0, sizeof(OSCONFIG_LOG));
 
     free(logToClose);
@@ -91,24 +208,78 @@ FILE* GetLogFile(OSCONFIG_LOG_HANDLE log)
     return log ? ((OSCONFIG_LOG*)log)->log : NULL;
 }
 
-static char g_logTime[TIME_FORMAT_STRING_LENGTH] = {0};
+// Per thread, the date/time is formatted again only when the second changes
+static __thread char g_logTime[TIME_FORMAT_STRING_LENGTH] = {0};
+static __thread time_t g_logTimeSecond = 0;
 
-// Returns the local date/time formatted as YYYY-MM-DD HH:MM:SS (for example: 2014-03-19 11:11:52)
+// Returns the local date/time formatted as YYYY-MM-DD HH:MM:SS (for example: 2014-03-19 11:11:52), with milliseconds
+// appended as YYYY-MM-DD HH:MM:SS.mmm when millisecond logging is enabled, the string is owned by the calling thread
 char* GetFormattedTime()
 {
-    time_t rawTime = {0};
-    struct tm* timeInfo = NULL;
-    time(&rawTime);
-    timeInfo = localtime(&rawTime);
-    strftime(g_logTime, ARRAY_SIZE(g_logTime), "%Y-%m-%d %H:%M:%S", timeInfo);
+    struct timespec now = {0};
+    struct tm timeInfo = {0};
+    size_t length = 0;
+
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    if ((now.tv_sec != g_logTimeSecond) || (0 == g_logTime[0]))
+    {
+        if (NULL == localtime_r(&now.tv_sec, &timeInfo))
+        {
+            g_logTime[0] = 0;
+            return g_logTime;
+        }
+        strftime(g_logTime, ARRAY_SIZE(g_logTime), "%Y-%m-%d %H:%M:%S", &timeInfo);
+        g_logTimeSecond = now.tv_sec;
+    }
+
+    // Only the milliseconds change within the same second
+    length = strnlen(g_logTime, TIME_FORMAT_STRING_LENGTH - 5);
+    if (IsMillisecondLoggingEnabled())
+    {
+        snprintf(g_logTime + length, ARRAY_SIZE(g_logTime) - length, ".%03ld", (long)(now.tv_nsec / 1000000));
+    }
+    else
+    {
+        g_logTime[length] = 0;
+    }
+
     return g_logTime;
 }
 
+// Rolls the log over if larger than MAX_LOG_SIZE
+static void RollLog(OSCONFIG_LOG* whatLog)
+{
+    int fileSize = 0;
+
+    // In append mode the file pointer will always be at end of file:
+    fileSize = ftell(whatLog->log);
+
+    if ((fileSize >= MAX_LOG_SIZE) || (-1 == fileSize))
+    {
+        fclose(whatLog->log);
+
+        // Rename the log in place to make a backup copy, overwriting previous copy if any:
+        if ((NULL == whatLog->backLogFileName) || (0 != rename(whatLog->logFileName, whatLog->backLogFileName)))
+        {
+            // If the log could not be renamed, empty it:
+            whatLog->log = fopen(whatLog->logFileName, "w");
+            fclose(whatLog->log);
+        }
+
+        // Reopen the log in append mode:
+        whatLog->log = fopen(whatLog->logFileName, "a");
+
+        // Reapply restrictions once the file is recreated (also for backup, if any):
+        RestrictAccessToRootOnly(whatLog->logFileName);
+        RestrictAccessToRootOnly(whatLog->backLogFileName);
+    }
+}
+
 // Checks and rolls the log over if larger than MAX_LOG_SIZE
 void TrimLog(OSCONFIG_LOG_HANDLE log)
 {
     OSCONFIG_LOG* whatLog = NULL;
-    int fileSize = 0;
 
     if ((NULL == log) || (NULL == (whatLog = (OSCONFIG_LOG*)log)))
     {
@@ -121,27 +292,313 @@ void TrimLog(OSCONFIG_LOG_HANDLE log)
     // Check every 10 calls:
     if (0 == (whatLog->trimLogCount % 10))
     {
-        // In append mode the file pointer will always be at end of file:
-        fileSize = ftell(whatLog->log);
-        
-        if ((fileSize >= MAX_LOG_SIZE) || (-1 == fileSize))
+        RollLog(whatLog);
+    }
+}
+
+static void WriteFromRing(OSCONFIG_LOG* log, size_t tail, size_t head)
+{
+    size_t start = tail % LOG_BUFFER_SIZE;
+    size_t size = head - tail;
+    size_t firstSize = ((start + size) > LOG_BUFFER_SIZE) ? (LOG_BUFFER_SIZE - start) : size;
+
+    fwrite(log->buffer + start, 1, firstSize, log->log);
+    if (firstSize < size)
+    {
+        fwrite(log->buffer, 1, size - firstSize, log->log);
+    }
+}
+
+// Writes a batch of queued lines, from the ring, with a single flush, the count of dropped lines goes where they were dropped
+static void WriteQueuedLines(OSCONFIG_LOG* log, size_t tail, size_t head, unsigned long long dropped, size_t droppedAt)
+{
+    if (NULL == log->log)
+    {
+        return;
+    }
+
+    // Batches are few compared to lines, so the size is checked for each
+    RollLog(log);
+
+    if (NULL == log->log)
+    {
+        return;
+    }
+
+    if (dropped > 0)
+    {
+        WriteFromRing(log, tail, droppedAt);
+        fprintf(log->log, "[%s] [%s:%d]%s%llu log lines dropped, the log buffer was full\n", GetFormattedTime(), __SHORT_FILE__, __LINE__, __ERROR__, dropped);
+        WriteFromRing(log, droppedAt, head);
+    }
+    else
+    {
+        WriteFromRing(log, tail, head);
+    }
+
+    fflush(log->log);
+}
+
+static void* LogWriter(void* context)
+{
+    OSCONFIG_LOG* log = (OSCONFIG_LOG*)context;
+    size_t head = 0;
+    size_t tail = 0;
+    unsigned long long dropped = 0;
+    size_t droppedAt = 0;
+
+    pthread_mutex_lock(&log->mutex);
+
+    while (true)
+    {
+        while ((log->head == log->tail) && (0 == log->dropped) && (false == log->stopping))
         {
-            fclose(whatLog->log);
+            pthread_cond_wait(&log->queued, &log->mutex);
+        }
+
+        if ((log->head == log->tail) && (0 == log->dropped))
+        {
+            break;
+        }
+
+        // The queued lines are written straight from the ring, callers only append past head
+        head = log->head;
+        tail = log->tail;
+        dropped = log->dropped;
+        droppedAt = log->droppedAt;
+        log->dropped = 0;
+        log->writing = true;
+        pthread_mutex_unlock(&log->mutex);
+
+        WriteQueuedLines(log, tail, head, dropped, droppedAt);
+
+        pthread_mutex_lock(&log->mutex);
+        log->tail = head;
+        log->writing = false;
+        pthread_cond_broadcast(&log->written);
+    }
 
-            // Rename the log in place to make a backup copy, overwriting previous copy if any:
-            if ((NULL == whatLog->backLogFileName) || (0 != rename(whatLog->logFileName, whatLog->backLogFileName)))
-            {
-                // If the log could not be renamed, empty it:
-                whatLog->log = fopen(whatLog->logFileName, "w");
-                fclose(whatLog->log);
-            }
-
-            // Reopen the log in append mode:
-            whatLog->log = fopen(whatLog->logFileName, "a");
-            
-            // Reapply restrictions once the file is recreated (also for backup, if any):
-            RestrictAccessToRootOnly(whatLog->logFileName);
-            RestrictAccessToRootOnly(whatLog->backLogFileName);
+    pthread_mutex_unlock(&log->mutex);
+
+    return NULL;
+}
+
+// Called with the log mutex held
+static bool StartLogWriter(OSCONFIG_LOG* log)
+{
+    sigset_t allSignals;
+    sigset_t callerSignals;
+
+    if ((false == log->writerStarted) && (false == log->synchronous))
+    {
+        // Signals stay with the threads of the caller
+        sigfillset(&allSignals);
+        pthread_sigmask(SIG_SETMASK, &allSignals, &callerSignals);
+        log->writerStarted = (0 == pthread_create(&log->writer, NULL, LogWriter, log));
+        pthread_sigmask(SIG_SETMASK, &callerSignals, NULL);
+
+        log->synchronous = !log->writerStarted;
+    }
+
+    return log->writerStarted;
+}
+
+static void WriteLineNow(OSCONFIG_LOG* log, const char* line, size_t length)
+{
+    TrimLog((OSCONFIG_LOG_HANDLE)log);
+
+    if (NULL != log->log)
+    {
+        fwrite(line, 1, length, log->log);
+        fflush(log->log);
+    }
+}
+
+static void QueueLogLine(OSCONFIG_LOG* log, const char* line, size_t length)
+{
+    size_t start = 0;
+    size_t firstSize = 0;
+
+    // A forked child does not have the writer thread and may have inherited the log mutex in any state
+    if (log->owner != getpid())
+    {
+        WriteLineNow(log, line, length);
+        return;
+    }
+
+    pthread_mutex_lock(&log->mutex);
+
+    if (false == StartLogWriter(log))
+    {
+        WriteLineNow(log, line, length);
+    }
+    else if (length > LOG_BUFFER_SIZE)
+    {
+        // Too long for the ring, written directly once everything queued before it is written
+        while ((log->head != log->tail) || log->writing)
+        {
+            pthread_cond_wait(&log->written, &log->mutex);
+        }
+
+        WriteLineNow(log, line, length);
+    }
+    else if ((LOG_BUFFER_SIZE - (log->head - log->tail)) < length)
+    {
+        // Lines dropped until the writer catches up are counted at the position of the first
+        if (0 == log->dropped)
+        {
+            log->droppedAt = log->head;
+        }
+        log->dropped += 1;
+        pthread_cond_signal(&log->queued);
+    }
+    else
+    {
+        start = log->head % LOG_BUFFER_SIZE;
+        firstSize = ((start + length) > LOG_BUFFER_SIZE) ? (LOG_BUFFER_SIZE - start) : length;
+
+        memcpy(log->buffer + start, line, firstSize);
+        if (firstSize < length)
+        {
+            memcpy(log->buffer, line + firstSize, length - firstSize);
+        }
+
+        log->head += length;
+        pthread_cond_signal(&log->queued);
+    }
+
+    pthread_mutex_unlock(&log->mutex);
+}
+
+void OsConfigLogWrite(OSCONFIG_LOG_HANDLE log, const char* fileName, int lineNumber, const char* logLevel, const char* format, ...)
+{
+    char buffer[LOG_LINE_SIZE] = {0};
+    char* line = buffer;
+    int prefixLength = 0;
+    int messageLength = 0;
+    size_t length = 0;
+    va_list arguments;
+
+    bool toFile = (NULL != GetLogFile(log));
+    bool toConsole = (false == IsDaemon()) || (false == IsFullLoggingEnabled());
+
+    if ((false == toFile) && (false == toConsole))
+    {
+        return;
+    }
+
+    // The line is formatted once, on the calling thread, for both the log file and the console
+    prefixLength = snprintf(buffer, sizeof(buffer), "[%s] [%s:%d]%s", GetFormattedTime(), fileName, lineNumber, logLevel);
+    if ((prefixLength < 0) || ((size_t)prefixLength >= (sizeof(buffer) / 2)))
+    {
+        return;
+    }
+
+    va_start(arguments, format);
+    messageLength = vsnprintf(buffer + prefixLength, sizeof(buffer) - prefixLength, format, arguments);
+    va_end(arguments);
+
+    if (messageLength < 0)
+    {
+        return;
+    }
+
+    // Room for the end of line and the null terminator
+    length = (size_t)prefixLength + (size_t)messageLength + 1;
+    if ((length + 1) > sizeof(buffer))
+    {
+        if (NULL != (line = (char*)malloc(length + 1)))
+        {
+            memcpy(line, buffer, prefixLength);
+            va_start(arguments, format);
+            vsnprintf(line + prefixLength, (size_t)messageLength + 1, format, arguments);
+            va_end(arguments);
+        }
+        else
+        {
+            // Out of memory, the message is truncated
+            line = buffer;
+            length = sizeof(buffer) - 1;
+        }
+    }
+
+    line[length - 1] = '\n';
+    line[length] = 0;
+
+    if (toFile)
+    {
+        QueueLogLine((OSCONFIG_LOG*)log, line, length);
+    }
+
+    if (toConsole)
+    {
+        fwrite(line, 1, length, stdout);
+    }
+
+    if (line != buffer)
+    {
+        free(line);
+    }
+}
+
+void FlushLog(OSCONFIG_LOG_HANDLE log)
+{
+    OSCONFIG_LOG* whatLog = (OSCONFIG_LOG*)log;
+
+    if ((NULL == whatLog) || (whatLog->owner != getpid()))
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&whatLog->mutex);
+    while (whatLog->writerStarted && ((whatLog->head != whatLog->tail) || (whatLog->dropped > 0) || whatLog->writing))
+    {
+        pthread_cond_signal(&whatLog->queued);
+        pthread_cond_wait(&whatLog->written, &whatLog->mutex);
+    }
+    pthread_mutex_unlock(&whatLog->mutex);
+}
+
+// Takes no lock and only calls write, lines the writer thread was writing at the time of the crash may show up twice
+void FlushLogOnCrash(OSCONFIG_LOG_HANDLE log)
+{
+    OSCONFIG_LOG* whatLog = (OSCONFIG_LOG*)log;
+    size_t head = 0;
+    size_t tail = 0;
+    size_t start = 0;
+    size_t size = 0;
+    ssize_t written = 0;
+    int descriptor = -1;
+
+    if ((NULL == whatLog) || (NULL == whatLog->log) || (NULL == whatLog->buffer) || (whatLog->owner != getpid()))
+    {
+        return;
+    }
+
+    head = whatLog->head;
+    tail = whatLog->tail;
+
+    if ((head == tail) || ((head - tail) > LOG_BUFFER_SIZE) || (0 > (descriptor = fileno(whatLog->log))))
+    {
+        return;
+    }
+
+    while (tail < head)
+    {
+        start = tail % LOG_BUFFER_SIZE;
+        size = ((start + (head - tail)) > LOG_BUFFER_SIZE) ? (LOG_BUFFER_SIZE - start) : (head - tail);
+
+        if (0 < (written = write(descriptor, whatLog->buffer + start, size)))
+        {
+            tail += (size_t)written;
+        }
+        else if ((0 > written) && (EINTR == errno))
+        {
+            continue;
+        }
+        else
+        {
+            break;
         }
     }
 }
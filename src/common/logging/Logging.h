@@ -9,7 +9,8 @@
 // Maximum log size (131072 is 128KB aka 1024 * 128), increase or decrease as needed
 #define MAX_LOG_SIZE 131072
 
-#define TIME_FORMAT_STRING_LENGTH 20
+// YYYY-MM-DD HH:MM:SS with optional .mmm milliseconds
+#define TIME_FORMAT_STRING_LENGTH 24
 
 #ifndef ARRAY_SIZE
 #define ARRAY_SIZE(a) (sizeof(a) / sizeof(a[0]))
@@ -28,49 +29,43 @@ void CloseLog(OSCONFIG_LOG_HANDLE* log);
 void SetFullLogging(bool fullLogging);
 bool IsFullLoggingEnabled(void);
 
+void SetMillisecondLogging(bool millisecondLogging);
+bool IsMillisecondLoggingEnabled(void);
+
 FILE* GetLogFile(OSCONFIG_LOG_HANDLE log);
 char* GetFormattedTime();
 void TrimLog(OSCONFIG_LOG_HANDLE log);
 bool IsDaemon(void);
 
+// Formats the line on the caller and queues it for the log writer thread, the line is also printed to the console when not a daemon
+void OsConfigLogWrite(OSCONFIG_LOG_HANDLE log, const char* fileName, int lineNumber, const char* logLevel, const char* format, ...) __attribute__((format(printf, 5, 6)));
+
+// Waits until all lines queued so far are written to the log file
+void FlushLog(OSCONFIG_LOG_HANDLE log);
+
+// Writes the lines still queued for the log file without waiting for the writer thread, safe to call from a crash signal handler
+void FlushLogOnCrash(OSCONFIG_LOG_HANDLE log);
+
 #define __SHORT_FILE__ (strrchr(__FILE__, '/') ? strrchr(__FILE__, '/') + 1 : __FILE__)
 #define __LOG__(log, format, loglevel, ...) printf("[%s] [%s:%d]%s" format "\n", GetFormattedTime(), __SHORT_FILE__, __LINE__, loglevel, ## __VA_ARGS__)
-#define __LOG_TO_FILE__(log, format, loglevel, ...) {\
-    TrimLog(log);\
-    fprintf(GetLogFile(log), "[%s] [%s:%d]%s" format "\n", GetFormattedTime(), __SHORT_FILE__, __LINE__, loglevel, ## __VA_ARGS__);\
-}\
-
 #define __INFO__ " "
 #define __ERROR__ " [ERROR] "
 
 #define OSCONFIG_LOG_INFO(log, format, ...) __LOG__(log, format, __INFO__, ## __VA_ARGS__)
 #define OSCONFIG_LOG_ERROR(log, format, ...) __LOG__(log, format, __ERROR__, ## __VA_ARGS__)
-#define OSCONFIG_FILE_LOG_INFO(log, format, ...) __LOG_TO_FILE__(log, format, __INFO__, ## __VA_ARGS__)
-#define OSCONFIG_FILE_LOG_ERROR(log, format, ...) __LOG_TO_FILE__(log, format, __ERROR__, ## __VA_ARGS__)
 
 #define OsConfigLogInfo(log, FORMAT, ...) {\
-    if (NULL != GetLogFile(log)) {\
-        OSCONFIG_FILE_LOG_INFO(log, FORMAT, ##__VA_ARGS__);\
-        fflush(GetLogFile(log));\
-    }\
-    if ((false == IsDaemon()) || (false == IsFullLoggingEnabled())) {\
-        OSCONFIG_LOG_INFO(log, FORMAT, ##__VA_ARGS__);\
-    }\
+    OsConfigLogWrite(log, __SHORT_FILE__, __LINE__, __INFO__, FORMAT, ##__VA_ARGS__);\
 }\
 
 #define OsConfigLogError(log, FORMAT, ...) {\
-    if (NULL != GetLogFile(log)) {\
-        OSCONFIG_FILE_LOG_ERROR(log, FORMAT, ##__VA_ARGS__);\
-        fflush(GetLogFile(log));\
-    }\
-    if ((false == IsDaemon()) || (false == IsFullLoggingEnabled())) {\
-        OSCONFIG_LOG_ERROR(log, FORMAT, ##__VA_ARGS__);\
-    }\
+    OsConfigLogWrite(log, __SHORT_FILE__, __LINE__, __ERROR__, FORMAT, ##__VA_ARGS__);\
 }\
 
 #define LogAssert(log, CONDITION) {\
     if (!(CONDITION)) {\
         OsConfigLogError(log, "Assert in %s", __func__);\
+        FlushLog(log);\
         assert(CONDITION);\
     }\
 }\
@@ -6,6 +6,7 @@
 #include <stdbool.h>
 #include <unistd.h>
 #include <errno.h>
+#include <pthread.h>
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <parson.h>
@@ -21,21 +22,90 @@
 
 extern MPI_HANDLE g_mpiHandle;
 
+static const char* g_mpiSocket = "/run/osconfig/mpid.sock";
+
+// There is one MPI handle per client process, so one persistent (keep-alive) connection is kept for it, serialized by this lock
+static int g_mpiSocketHandle = -1;
+static pthread_mutex_t g_mpiSocketMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void CloseMpiSocket(void)
+{
+    if (0 <= g_mpiSocketHandle)
+    {
+        close(g_mpiSocketHandle);
+        g_mpiSocketHandle = -1;
+    }
+}
+
+// An idle connection that reads as end of file (or fails) was dropped by the platform, for example on restart
+static bool IsMpiSocketStale(void)
+{
+    char peek = 0;
+    ssize_t bytes = recv(g_mpiSocketHandle, &peek, sizeof(peek), MSG_PEEK | MSG_DONTWAIT);
+
+    return ((0 <= bytes) || ((EAGAIN != errno) && (EWOULDBLOCK != errno) && (EINTR != errno))) ? true : false;
+}
+
+static int OpenMpiSocket(const char* name, void* log)
+{
+    struct sockaddr_un socketAddress = {0};
+    socklen_t socketLength = 0;
+    int status = MPI_OK;
+
+    if ((0 <= g_mpiSocketHandle) && IsMpiSocketStale())
+    {
+        if (IsFullLoggingEnabled())
+        {
+            OsConfigLogInfo(log, "CallMpi(%s): reconnecting to socket '%s'", name, g_mpiSocket);
+        }
+        CloseMpiSocket();
+    }
+
+    if (0 <= g_mpiSocketHandle)
+    {
+        return status;
+    }
+
+    g_mpiSocketHandle = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (0 > g_mpiSocketHandle)
+    {
+        status = errno ? errno : EIO;
+        OsConfigLogError(log, "CallMpi(%s): failed to open socket '%s' (%d)", name, g_mpiSocket, status);
+    }
+    else
+    {
+        memset(&socketAddress, 0, sizeof(socketAddress));
+        socketAddress.sun_family = AF_UNIX;
+        strncpy(socketAddress.sun_path, g_mpiSocket, sizeof(socketAddress.sun_path) - 1);
+        socketLength = sizeof(socketAddress);
+
+        if (0 != connect(g_mpiSocketHandle, (struct sockaddr*)&socketAddress, socketLength))
+        {
+            status = errno ? errno : EIO;
+            OsConfigLogError(log, "CallMpi(%s): failed to connect to socket '%s' (%d)", name, g_mpiSocket, status);
+            CloseMpiSocket();
+        }
+    }
+
+    return status;
+}
+
 static int CallMpi(const char* name, const char* request, char** response, int* responseSize, void* log)
 {
-    const char* mpiSocket = "/run/osconfig/mpid.sock";
-    const char* dataFormat = "POST /%s/ HTTP/1.1\r\nHost: OSConfig\r\nUser-Agent: OSConfig\r\nAccept: */*\r\nContent-Type: application/json\r\nContent-Length: %d\r\n\r\n%s";
+    const char* mpiSocket = g_mpiSocket;
+    const char* dataFormat = "POST /%s/ HTTP/1.1\r\nHost: OSConfig\r\nUser-Agent: OSConfig\r\nAccept: */*\r\nConnection: keep-alive\r\nContent-Type: application/json\r\nContent-Length: %d\r\n\r\n%s";
     
     int socketHandle = -1;
     char* data = {0};
     int estimatedDataSize = 0;
     int actualDataSize = 0;
     char contentLengthString[MPI_MAX_CONTENT_LENGTH] = {0};
-    struct sockaddr_un socketAddress = {0};
-    socklen_t socketLength = 0;
     ssize_t bytes = 0;
     int status = MPI_OK;
-    int httpStatus = -1;
+    HTTP_MESSAGE reply = {0};
+    bool keepAlive = false;
+    bool reused = false;
+    bool connectionFailed = true;
 
     if ((NULL == name) || (NULL == request) || (NULL == response) || (NULL == responseSize))
     {
@@ -60,37 +130,34 @@ static int CallMpi(const char* name, const char* request, char** response, int*
 
     memset(data, 0, estimatedDataSize);
 
-    socketHandle = socket(AF_UNIX, SOCK_STREAM, 0);
-    if (0 > socketHandle)
-    {
-        status = errno ? errno : EIO;
-        OsConfigLogError(log, "CallMpi(%s): failed to open socket '%s' (%d)", name, mpiSocket, status);
-    }
-    else
-    {
-        memset(&socketAddress, 0, sizeof(socketAddress));
-        socketAddress.sun_family = AF_UNIX;
-        strncpy(socketAddress.sun_path, mpiSocket, sizeof(socketAddress.sun_path) - 1);
-        socketLength = sizeof(socketAddress);
-    }
+    snprintf(data, estimatedDataSize, dataFormat, name, strlen(request), request);
+    actualDataSize = (int)strlen(data);
 
-    if (MPI_OK == status)
+    pthread_mutex_lock(&g_mpiSocketMutex);
+
+    reused = (0 <= g_mpiSocketHandle) ? true : false;
+
+    if (MPI_OK == (status = OpenMpiSocket(name, log)))
     {
-        if (0 == connect(socketHandle, (struct sockaddr*)&socketAddress, socketLength))
-        {
-            snprintf(data, estimatedDataSize, dataFormat, name, strlen(request), request);
-            actualDataSize = (int)strlen(data);
-        }
-        else
+        socketHandle = g_mpiSocketHandle;
+        bytes = send(socketHandle, data, actualDataSize, MSG_NOSIGNAL);
+
+        if (reused && (bytes != actualDataSize))
         {
-            status = errno ? errno : EIO;
-            OsConfigLogError(log, "CallMpi(%s): failed to connect to socket '%s' (%d)", name, mpiSocket, status);
+            // The platform dropped the persistent connection under us, retry once on a new one
+            CloseMpiSocket();
+            socketHandle = -1;
+
+            if (MPI_OK == (status = OpenMpiSocket(name, log)))
+            {
+                socketHandle = g_mpiSocketHandle;
+                bytes = send(socketHandle, data, actualDataSize, MSG_NOSIGNAL);
+            }
         }
     }
 
     if (MPI_OK == status)
     {
-        bytes = send(socketHandle, data, actualDataSize, 0);
         if (bytes != actualDataSize)
         {
             status = errno ? errno : EIO;
@@ -113,37 +180,33 @@ static int CallMpi(const char* name, const char* request, char** response, int*
 
     if (MPI_OK == status)
     {
-        httpStatus = ReadHttpStatusFromSocket(socketHandle, log);
-        status = (200 == httpStatus) ? MPI_OK : httpStatus;
-
-        *responseSize = ReadHttpContentLengthFromSocket(socketHandle, log);
-        *response = (char*)malloc(*responseSize + 1);
-        if (NULL != *response)
+        if (0 == (status = ReadHttpMessageFromSocket(socketHandle, &reply, log)))
         {
-            memset(*response, 0, *responseSize + 1);
-            
-            if (*responseSize != read(socketHandle, *response, *responseSize))
-            {
-                if ((MPI_OK == status) || IsFullLoggingEnabled())
-                {
-                    OsConfigLogError(log, "CallMpi(%s): failed to read %d bytes response from socket '%s' (%d)", name, *responseSize, mpiSocket, status);
-                }
-                status = errno ? errno : EIO;
-            }
+            status = (200 == reply.httpStatus) ? MPI_OK : reply.httpStatus;
+            keepAlive = reply.keepAlive;
+            connectionFailed = false;
+
+            // The response takes ownership of the body
+            *response = reply.body;
+            *responseSize = reply.contentLength;
+            reply.body = NULL;
         }
         else
         {
-            status = ENOMEM;
-            *responseSize = 0;
-            OsConfigLogError(log, "CallMpi(%s): failed to allocate memory for response (%d)", name, status);
+            OsConfigLogError(log, "CallMpi(%s): failed to read response from socket '%s' (%d)", name, mpiSocket, status);
         }
+
+        FreeHttpMessage(&reply);
     }
 
-    if (0 <= socketHandle)
+    // Keep the connection only when the platform agreed to and the exchange completed, otherwise start over next time
+    if (connectionFailed || (!keepAlive))
     {
-        close(socketHandle);
+        CloseMpiSocket();
     }
 
+    pthread_mutex_unlock(&g_mpiSocketMutex);
+
     if (IsFullLoggingEnabled())
     {
         OsConfigLogInfo(log, "CallMpi(name: '%s', request: '%s', response: '%s', response size: %d bytes) to socket '%s' returned %d", 
@@ -268,6 +331,11 @@ void CallMpiClose(MPI_HANDLE clientSession, void* log)
 
     FREE_MEMORY(request);
     FREE_MEMORY(response);
+
+    // The session is over, do not hold on to the persistent connection
+    pthread_mutex_lock(&g_mpiSocketMutex);
+    CloseMpiSocket();
+    pthread_mutex_unlock(&g_mpiSocketMutex);
     
     OsConfigLogInfo(log, "CallMpiClose(%p)", clientSession);
 }
@@ -556,6 +624,182 @@ int CallMpiGetReported(MPI_JSON_STRING* payload, int* payloadSizeBytes, void* lo
     return status;
 }
 
+int CallMpiGetMany(MPI_OBJECT* objects, int numObjects, void* log)
+{
+    const char *name = "MpiGetMany";
+    static const char *requestBodyFormat = "{ \"ClientSession\": %s, \"Objects\": %s }";
+    static const char *componentNameLabel = "ComponentName";
+    static const char *objectNameLabel = "ObjectName";
+    static const char *statusLabel = "Status";
+    static const char *payloadLabel = "Payload";
+
+    JSON_Value* requestValue = NULL;
+    JSON_Array* requestArray = NULL;
+    JSON_Value* objectValue = NULL;
+    JSON_Value* responseValue = NULL;
+    JSON_Array* responseArray = NULL;
+    JSON_Object* responseObject = NULL;
+    char* serializedObjects = NULL;
+    char* request = NULL;
+    char* response = NULL;
+    int requestSize = 0;
+    int responseSize = 0;
+    int status = MPI_OK;
+    char* statusFromResponse = NULL;
+    const char* componentName = NULL;
+    const char* objectName = NULL;
+    int i = 0;
+
+    if ((NULL == g_mpiHandle) || (0 == strlen((char*)g_mpiHandle)))
+    {
+        status = EPERM;
+        OsConfigLogError(log, "CallMpiGetMany: called without a valid MPI handle (%d)", status);
+        return status;
+    }
+
+    if ((NULL == objects) || (0 >= numObjects))
+    {
+        status = EINVAL;
+        OsConfigLogError(log, "CallMpiGetMany: called with invalid arguments (%d)", status);
+        return status;
+    }
+
+    for (i = 0; i < numObjects; i++)
+    {
+        objects[i].payload = NULL;
+        objects[i].payloadSizeBytes = 0;
+        objects[i].status = EINVAL;
+    }
+
+    if ((NULL == (requestValue = json_value_init_array())) || (NULL == (requestArray = json_value_get_array(requestValue))))
+    {
+        status = ENOMEM;
+    }
+
+    for (i = 0; (MPI_OK == status) && (i < numObjects); i++)
+    {
+        if ((NULL == objects[i].componentName) || (NULL == objects[i].objectName))
+        {
+            OsConfigLogError(log, "CallMpiGetMany: invalid component or object name at index %d", i);
+            status = EINVAL;
+        }
+        else if ((NULL == (objectValue = json_value_init_object())) ||
+            (JSONSuccess != json_object_set_string(json_value_get_object(objectValue), componentNameLabel, objects[i].componentName)) ||
+            (JSONSuccess != json_object_set_string(json_value_get_object(objectValue), objectNameLabel, objects[i].objectName)) ||
+            (JSONSuccess != json_array_append_value(requestArray, objectValue)))
+        {
+            json_value_free(objectValue);
+            status = ENOMEM;
+        }
+    }
+
+    if ((MPI_OK == status) && (NULL == (serializedObjects = json_serialize_to_string(requestValue))))
+    {
+        status = ENOMEM;
+    }
+
+    json_value_free(requestValue);
+
+    if (MPI_OK == status)
+    {
+        requestSize = strlen(requestBodyFormat) + strlen((char*)g_mpiHandle) + strlen(serializedObjects) + 1;
+
+        if (NULL != (request = (char*)malloc(requestSize)))
+        {
+            snprintf(request, requestSize, requestBodyFormat, (char*)g_mpiHandle, serializedObjects);
+        }
+        else
+        {
+            status = ENOMEM;
+        }
+    }
+
+    json_free_serialized_string(serializedObjects);
+
+    if (MPI_OK != status)
+    {
+        OsConfigLogError(log, "CallMpiGetMany: failed to build request for %d objects (%d)", numObjects, status);
+        return status;
+    }
+
+    status = CallMpi(name, request, &response, &responseSize, log);
+
+    FREE_MEMORY(request);
+
+    if (HTTP_INTERNAL_SERVER_ERROR == status)
+    {
+        if ((NULL != response) && (responseSize > 0))
+        {
+            statusFromResponse = ParseString(log, response);
+            status = (NULL == statusFromResponse) ? EINVAL : atoi(statusFromResponse);
+            FREE_MEMORY(statusFromResponse);
+        }
+        else
+        {
+            OsConfigLogError(log, "CallMpiGetMany: invalid response for HTTP internal server error (500)");
+            status = EINVAL;
+        }
+    }
+    else if (MPI_OK == status)
+    {
+        if ((NULL == response) || (NULL == (responseValue = json_parse_string(response))) || (NULL == (responseArray = json_value_get_array(responseValue))) ||
+            (numObjects != (int)json_array_get_count(responseArray)))
+        {
+            OsConfigLogError(log, "CallMpiGetMany: invalid response (%p, %d)", response, responseSize);
+            status = EINVAL;
+        }
+
+        // Results come back in request order
+        for (i = 0; (MPI_OK == status) && (i < numObjects); i++)
+        {
+            if ((NULL == (responseObject = json_array_get_object(responseArray, i))) ||
+                (NULL == (componentName = json_object_get_string(responseObject, componentNameLabel))) ||
+                (NULL == (objectName = json_object_get_string(responseObject, objectNameLabel))) ||
+                (0 != strcmp(componentName, objects[i].componentName)) || (0 != strcmp(objectName, objects[i].objectName)) ||
+                (JSONNumber != json_value_get_type(json_object_get_value(responseObject, statusLabel))))
+            {
+                OsConfigLogError(log, "CallMpiGetMany: invalid response for %s.%s at index %d", objects[i].componentName, objects[i].objectName, i);
+                status = EINVAL;
+            }
+            else if (MPI_OK == (objects[i].status = (int)json_object_get_number(responseObject, statusLabel)))
+            {
+                if ((NULL == (objects[i].payload = json_serialize_to_string(json_object_get_value(responseObject, payloadLabel)))) ||
+                    (!IsValidMimObjectPayload(objects[i].payload, (int)strlen(objects[i].payload), log)))
+                {
+                    OsConfigLogError(log, "CallMpiGetMany(%s, %s): invalid payload", objects[i].componentName, objects[i].objectName);
+                    FREE_MEMORY(objects[i].payload);
+                    objects[i].status = EINVAL;
+                }
+                else
+                {
+                    objects[i].payloadSizeBytes = (int)strlen(objects[i].payload);
+                }
+            }
+        }
+
+        json_value_free(responseValue);
+    }
+
+    if (MPI_OK != status)
+    {
+        for (i = 0; i < numObjects; i++)
+        {
+            FREE_MEMORY(objects[i].payload);
+            objects[i].payloadSizeBytes = 0;
+            objects[i].status = status;
+        }
+    }
+
+    FREE_MEMORY(response);
+
+    if (IsFullLoggingEnabled())
+    {
+        OsConfigLogInfo(log, "CallMpiGetMany(%p, %d objects): %d", g_mpiHandle, numObjects, status);
+    }
+
+    return status;
+}
+
 void CallMpiFree(MPI_JSON_STRING payload)
 {
     FREE_MEMORY(payload);
@@ -9,12 +9,23 @@ extern "C"
 {
 #endif
 
+// One component object for CallMpiGetMany, payload and status are filled in by the call
+typedef struct MPI_OBJECT
+{
+    const char* componentName;
+    const char* objectName;
+    MPI_JSON_STRING payload;
+    int payloadSizeBytes;
+    int status;
+} MPI_OBJECT;
+
 MPI_HANDLE CallMpiOpen(const char* clientName, const unsigned int maxPayloadSizeBytes, void* log);
 void CallMpiClose(MPI_HANDLE clientSession, void* log);
 int CallMpiSet(const char* componentName, const char* propertyName, const MPI_JSON_STRING payload, const int payloadSizeBytes, void* log);
 int CallMpiGet(const char* componentName, const char* propertyName, MPI_JSON_STRING* payload, int* payloadSizeBytes, void* log);
 int CallMpiSetDesired(const MPI_JSON_STRING payload, const int payloadSizeBytes, void* log);
 int CallMpiGetReported(MPI_JSON_STRING* payload, int* payloadSizeBytes, void* log);
+int CallMpiGetMany(MPI_OBJECT* objects, int numObjects, void* log);
 void CallMpiFree(MPI_JSON_STRING payload);
 
 #ifdef __cplusplus
@@ -1,50 +1,44 @@
 // Copyright (c) Microsoft Corporation. All rights reserved.
 // Licensed under the MIT License.
 
-#include <ctime>
-#include <fstream>
+#include <algorithm>
+#include <cstdint>
+#include <sys/eventfd.h>
 #include <unistd.h>
 
 #include <Command.h>
 
-static const char alphanum[] = "0123456789"\
-    "ABCDEFGHIJKLMNOPQRSTUVWXYZ"\
-    "abcdefghijklmnopqrstuvwxyz";
-
 OSCONFIG_LOG_HANDLE CommandRunnerLog::m_log = nullptr;
 
+const size_t Command::m_maxOutputSizeBytes = 1024 * 1024;
+
 template<typename T>
 int DeserializeMember(const rapidjson::Value& document, const std::string key, T& value);
 
-Command::Command(std::string id, std::string command, unsigned int timeout, bool replaceEol) :
+Command::Command(std::string id, std::string command, unsigned int timeout, bool replaceEol, std::string orderingGroup) :
     m_arguments(command),
     m_timeout(timeout),
     m_replaceEol(replaceEol),
+    m_orderingGroup(orderingGroup),
     m_status(id, 0, "", Command::State::Unknown),
-    m_statusMutex()
+    m_statusMutex(),
+    m_cancelEvent(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)),
+    m_canceled(false),
+    m_outputStart(0),
+    m_outputTotalSize(0),
+    m_textResultLimit(SIZE_MAX)
 {
-    std::string tmp;
-    std::string uniqueId;
-
-    char const* dir = getenv("TMPDIR");
-    tmp = (NULL == dir) ? "/tmp" : dir;
-
-    srand((unsigned)time(NULL) * getpid());
-    uniqueId.reserve(10);
-
-    for (int i = 0; i < 10; ++i)
+    if (m_cancelEvent < 0)
     {
-        uniqueId += alphanum[rand() % (sizeof(alphanum) - 1)];
+        OsConfigLogError(CommandRunnerLog::Get(), "Failed to create cancel event for command '%s' (%d), the command can only be canceled before it starts", id.c_str(), errno);
     }
-
-    m_tmpFile = tmp + "/~osconfig-" + uniqueId;
 }
 
 Command::~Command()
 {
-    if (FileExists(m_tmpFile.c_str()) && (0 != remove(m_tmpFile.c_str())))
+    if (m_cancelEvent >= 0)
     {
-        OsConfigLogError(CommandRunnerLog::Get(), "Failed to remove file: %s", m_tmpFile.c_str());
+        close(m_cancelEvent);
     }
 }
 
@@ -60,40 +54,45 @@ int Command::Execute(unsigned int maxPayloadSizeBytes)
     }
     else
     {
-        char* textResult = nullptr;
-        void* context = reinterpret_cast<void*>(const_cast<char*>(m_tmpFile.c_str()));
-        unsigned int maxTextResultSize = 0;
-
         if (maxPayloadSizeBytes > 0)
         {
+            // Leave room for the rest of the status, and for a null terminator as ExecuteCommand does
             unsigned int estimatedSize = Command::Status::Serialize(Command::Status(status.m_id, 0, "", Command::State::Unknown)).size();
-            maxTextResultSize = (maxPayloadSizeBytes > estimatedSize) ? (maxPayloadSizeBytes - estimatedSize) : 1;
+            m_textResultLimit = (maxPayloadSizeBytes > estimatedSize) ? (maxPayloadSizeBytes - estimatedSize - 1) : 0;
         }
 
         SetStatus(0, "", Command::State::Running);
 
-        exitCode = ExecuteCommand(context, m_arguments.c_str(), m_replaceEol, true, maxTextResultSize, m_timeout, &textResult, &Command::ExecutionCallback, CommandRunnerLog::Get());
+        // The output is kept as it is read, so that it can be watched while the command is running
+        exitCode = StreamCommand(reinterpret_cast<void*>(this), m_arguments.c_str(), m_timeout, m_cancelEvent, &Command::OutputCallback, CommandRunnerLog::Get());
 
-        SetStatus(exitCode, (textResult != nullptr) ? std::string(textResult) : "");
-
-        if (textResult != nullptr)
-        {
-            free(textResult);
-        }
+        CompactOutput();
+        SetStatus(exitCode, GetStatus().m_textResult);
     }
 
     return exitCode;
 }
 
+bool Command::IsExclusive()
+{
+    return false;
+}
+
 int Command::Cancel()
 {
     int status = 0;
     std::lock_guard<std::mutex> lock(m_statusMutex);
 
-    if ((Command::State::Canceled != m_status.m_state) && !FileExists(m_tmpFile.c_str()))
+    if ((Command::State::Canceled != m_status.m_state) && !m_canceled)
     {
-        std::ofstream output(m_tmpFile);
-        output.close();
+        uint64_t signal = 1;
+        m_canceled = true;
+
+        // The process group of a running command is killed right away, a command that did not start yet is skipped
+        if ((m_cancelEvent >= 0) && (sizeof(signal) != write(m_cancelEvent, &signal, sizeof(signal))))
+        {
+            OsConfigLogError(CommandRunnerLog::Get(), "Failed to signal cancel event for command '%s' (%d)", m_status.m_id.c_str(), errno);
+        }
     }
     else
     {
@@ -111,7 +110,8 @@ bool Command::IsComplete()
 
 bool Command::IsCanceled()
 {
-    return FileExists(m_tmpFile.c_str());
+    std::lock_guard<std::mutex> lock(m_statusMutex);
+    return m_canceled;
 }
 
 std::string Command::GetId()
@@ -155,26 +155,126 @@ void Command::SetStatus(int exitCode, std::string textResult, Command::State sta
     m_status.m_state = state;
 }
 
-int Command::ExecutionCallback(void* context)
+Command::Output Command::GetOutput(size_t offset, size_t maxSerializedSize)
+{
+    std::lock_guard<std::mutex> lock(m_statusMutex);
+    size_t first = m_outputTotalSize - m_output.size();
+    size_t index = 0;
+    size_t serializedSize = 0;
+    std::string textResult;
+
+    offset = std::min(std::max(offset, first), m_outputTotalSize);
+    index = m_outputStart + (offset - first);
+
+    for (size_t position = offset; position < m_outputTotalSize; position++)
+    {
+        if (index >= m_output.size())
+        {
+            index -= m_output.size();
+        }
+
+        // Line feeds are the only characters left that are escaped in JSON
+        serializedSize += (EOL == m_output[index]) ? 2 : 1;
+        if (serializedSize > maxSerializedSize)
+        {
+            break;
+        }
+
+        textResult += m_output[index++];
+    }
+
+    // A page that stops short of the end is cut back to a UTF-8 character boundary, the rest of the character starts the next page
+    if ((offset + textResult.size()) < m_outputTotalSize)
+    {
+        size_t lead = textResult.size();
+        while ((lead > 0) && (0x80 == (static_cast<unsigned char>(textResult[lead - 1]) & 0xC0)))
+        {
+            lead--;
+        }
+
+        if (lead > 1)
+        {
+            unsigned char byte = static_cast<unsigned char>(textResult[lead - 1]);
+            size_t length = (byte >= 0xF0) ? 4 : (byte >= 0xE0) ? 3 : (byte >= 0xC0) ? 2 : 1;
+            if ((textResult.size() - (lead - 1)) < length)
+            {
+                textResult.resize(lead - 1);
+            }
+        }
+    }
+
+    return Command::Output(m_status.m_id, offset, textResult, m_outputTotalSize, m_status.m_state);
+}
+
+void Command::AppendOutput(const char* output, size_t outputSize)
 {
-    int result = 0;
+    std::string text(output, outputSize);
+    SanitizeTextResult(&text[0], text.size(), m_replaceEol, true);
+
+    std::lock_guard<std::mutex> lock(m_statusMutex);
+
+    if (m_status.m_textResult.size() < m_textResultLimit)
+    {
+        m_status.m_textResult.append(text, 0, m_textResultLimit - m_status.m_textResult.size());
+    }
+
+    m_outputTotalSize += text.size();
+
+    // Only the most recent m_maxOutputSizeBytes of the output are kept
+    const char* data = text.c_str();
+    size_t size = text.size();
+    if (size > m_maxOutputSizeBytes)
+    {
+        data += size - m_maxOutputSizeBytes;
+        size = m_maxOutputSizeBytes;
+    }
 
-    if (nullptr != context)
+    while (size > 0)
     {
-        char* name = reinterpret_cast<char*>(context);
-        if (FileExists(name))
+        size_t chunk = 0;
+        if (m_output.size() < m_maxOutputSizeBytes)
         {
-            remove(name);
-            result = 1;
+            chunk = std::min(size, m_maxOutputSizeBytes - m_output.size());
+            m_output.insert(m_output.end(), data, data + chunk);
         }
+        else
+        {
+            chunk = std::min(size, m_maxOutputSizeBytes - m_outputStart);
+            std::copy(data, data + chunk, m_output.begin() + m_outputStart);
+            m_outputStart = (m_outputStart + chunk) % m_maxOutputSizeBytes;
+        }
+
+        data += chunk;
+        size -= chunk;
     }
+}
 
-    return result;
+void Command::CompactOutput()
+{
+    std::lock_guard<std::mutex> lock(m_statusMutex);
+
+    // The output no longer grows once the command completes, keep it in order without the spare capacity
+    std::rotate(m_output.begin(), m_output.begin() + m_outputStart, m_output.end());
+    m_outputStart = 0;
+    m_output.shrink_to_fit();
+}
+
+void Command::OutputCallback(void* context, const char* output, size_t outputSize)
+{
+    if ((nullptr != context) && (nullptr != output) && (outputSize > 0))
+    {
+        reinterpret_cast<Command*>(context)->AppendOutput(output, outputSize);
+    }
 }
 
 ShutdownCommand::ShutdownCommand(std::string id, std::string command, unsigned int timeout, bool replaceEol) :
     Command(id, command, timeout, replaceEol) { }
 
+bool ShutdownCommand::IsExclusive()
+{
+    return true;
+}
+
 int ShutdownCommand::Execute(unsigned int maxPayloadSizeBytes)
 {
     int exitCode = 0;
@@ -204,12 +304,14 @@ bool Command::operator ==(const Command& other) const
     return ((m_status.m_id == other.m_status.m_id) && (m_arguments == other.m_arguments) && (m_timeout == other.m_timeout) && (m_replaceEol == other.m_replaceEol));
 }
 
-Command::Arguments::Arguments(std::string id, std::string command, Command::Action action, unsigned int timeout, bool singleLineTextResult) :
+Command::Arguments::Arguments(std::string id, std::string command, Command::Action action, unsigned int timeout, bool singleLineTextResult, std::string orderingGroup, unsigned int textResultOffset) :
     m_id(id),
     m_arguments(command),
     m_action(action),
     m_timeout(timeout),
-    m_singleLineTextResult(singleLineTextResult) { }
+    m_singleLineTextResult(singleLineTextResult),
+    m_orderingGroup(orderingGroup),
+    m_textResultOffset(textResultOffset) { }
 
 std::string Command::Arguments::Serialize(const Command::Arguments& arguments)
 {
@@ -238,6 +340,18 @@ void Command::Arguments::Serialize(rapidjson::Writer<rapidjson::StringBuffer>& w
     writer.String(g_singleLineTextResult.c_str());
     writer.Bool(arguments.m_singleLineTextResult);
 
+    if (!arguments.m_orderingGroup.empty())
+    {
+        writer.String(g_orderingGroup.c_str());
+        writer.String(arguments.m_orderingGroup.c_str());
+    }
+
+    if (arguments.m_textResultOffset > 0)
+    {
+        writer.String(g_textResultOffset.c_str());
+        writer.Uint(arguments.m_textResultOffset);
+    }
+
     writer.EndObject();
 }
 
@@ -248,6 +362,8 @@ Command::Arguments Command::Arguments::Deserialize(const rapidjson::Value& value
     Command::Action action = Command::Action::None;
     unsigned int timeout = 0;
     bool singleLineTextResult = false;
+    std::string orderingGroup = "";
+    unsigned int textResultOffset = 0;
 
     if (value.IsObject())
     {
@@ -272,6 +388,11 @@ Command::Arguments Command::Arguments::Deserialize(const rapidjson::Value& value
                         {
                             OsConfigLogError(CommandRunnerLog::Get(), "%s.%s is empty", g_commandArguments.c_str(), g_commandId.c_str());
                         }
+                        else if ((Command::Action::RefreshCommandStatus == action) && (0 != DeserializeMember(value, g_textResultOffset, textResultOffset)))
+                        {
+                            // TextResultOffset is an optional field, by default the output is reported from its start
+                            textResultOffset = 0;
+                        }
                         break;
 
                     case Command::Action::RunCommand:
@@ -296,6 +417,12 @@ Command::Arguments Command::Arguments::Deserialize(const rapidjson::Value& value
                                         singleLineTextResult = true;
                                         OsConfigLogInfo(CommandRunnerLog::Get(), "%s.%s default value 'true' used for command id: %s", g_commandArguments.c_str(), g_singleLineTextResult.c_str(), id.c_str());
                                     }
+
+                                    // OrderingGroup is an optional field, commands without one may run concurrently
+                                    if (0 != DeserializeMember(value, g_orderingGroup, orderingGroup))
+                                    {
+                                        orderingGroup = "";
+                                    }
                                 }
                                 else
                                 {
@@ -325,7 +452,7 @@ Command::Arguments Command::Arguments::Deserialize(const rapidjson::Value& value
         OsConfigLogError(CommandRunnerLog::Get(), "Invalid command arguments JSON value");
     }
 
-    return Command::Arguments(id, command, action, timeout, singleLineTextResult);
+    return Command::Arguments(id, command, action, timeout, singleLineTextResult, orderingGroup, textResultOffset);
 }
 
 Command::Status::Status(const std::string id, int exitCode, std::string textResult, Command::State state) :
@@ -395,6 +522,43 @@ Command::Status Command::Status::Deserialize(const rapidjson::Value& value)
     return Command::Status(id, exitCode, textResult, state);
 }
 
+Command::Output::Output(const std::string id, size_t offset, std::string textResult, size_t totalSize, Command::State state) :
+    m_id(id),
+    m_offset(offset),
+    m_textResult(textResult),
+    m_totalSize(totalSize),
+    m_state(state) { }
+
+std::string Command::Output::Serialize(const Command::Output& output)
+{
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    Command::Output::Serialize(writer, output);
+    return buffer.GetString();
+}
+
+void Command::Output::Serialize(rapidjson::Writer<rapidjson::StringBuffer>& writer, const Command::Output& output)
+{
+    writer.StartObject();
+
+    writer.Key(g_commandId.c_str());
+    writer.String(output.m_id.c_str());
+
+    writer.Key(g_textResultOffset.c_str());
+    writer.Uint64(output.m_offset);
+
+    writer.Key(g_textResult.c_str());
+    writer.String(output.m_textResult.c_str());
+
+    writer.Key(g_textResultTotalSize.c_str());
+    writer.Uint64(output.m_totalSize);
+
+    writer.Key(g_currentState.c_str());
+    writer.Int(output.m_state);
+
+    writer.EndObject();
+}
+
 int Deserialize(const rapidjson::Value& object, const char* key, std::string& value)
 {
     int status = 0;
@@ -10,6 +10,7 @@
 #include <rapidjson/stringbuffer.h>
 #include <rapidjson/writer.h>
 #include <string>
+#include <vector>
 
 #include <CommonUtils.h>
 #include <Logging.h>
@@ -20,12 +21,17 @@ const std::string g_arguments = "arguments";
 const std::string g_action = "action";
 const std::string g_timeout = "timeout";
 const std::string g_singleLineTextResult = "singleLineTextResult";
+const std::string g_orderingGroup = "orderingGroup";
+const std::string g_textResultOffset = "textResultOffset";
 
 const std::string g_commandStatus = "commandStatus";
 const std::string g_resultCode = "resultCode";
 const std::string g_textResult = "textResult";
 const std::string g_currentState = "currentState";
 
+const std::string g_commandOutput = "commandOutput";
+const std::string g_textResultTotalSize = "textResultTotalSize";
+
 #define COMMANDRUNNER_LOGFILE "/var/log/osconfig_commandrunner.log"
 #define COMMADRUNNER_ROLLEDLOGFILE "/var/log/osconfig_commandrunner.bak"
 
@@ -81,8 +87,10 @@ public:
         const Command::Action m_action;
         const unsigned int m_timeout;
         const bool m_singleLineTextResult;
+        const std::string m_orderingGroup;
+        const unsigned int m_textResultOffset;
 
-        Arguments(std::string id, std::string command, Command::Action action, unsigned int timeout, bool singleLineTextResult);
+        Arguments(std::string id, std::string command, Command::Action action, unsigned int timeout, bool singleLineTextResult, std::string orderingGroup = "", unsigned int textResultOffset = 0);
 
         static std::string Serialize(const Command::Arguments& arguments);
         static void Serialize(rapidjson::Writer<rapidjson::StringBuffer>& writer, const Command::Arguments& arguments);
@@ -104,14 +112,38 @@ public:
         static Command::Status Deserialize(const rapidjson::Value& object);
     };
 
+    // A page of the output kept for a command, textResultOffset counts from the first byte the command wrote
+    class Output
+    {
+    public:
+        const std::string m_id;
+        size_t m_offset;
+        std::string m_textResult;
+        size_t m_totalSize;
+        Command::State m_state;
+
+        Output(const std::string id, size_t offset, std::string textResult, size_t totalSize, Command::State state);
+
+        static std::string Serialize(const Command::Output& output);
+        static void Serialize(rapidjson::Writer<rapidjson::StringBuffer>& writer, const Command::Output& output);
+    };
+
+    static const size_t m_maxOutputSizeBytes;
+
     const std::string m_arguments;
     const unsigned int m_timeout;
     const bool m_replaceEol;
 
-    Command(std::string id, std::string command, unsigned int timeout, bool replaceEol);
+    // Commands sharing a non-empty ordering group run one at a time, in the order received
+    const std::string m_orderingGroup;
+
+    Command(std::string id, std::string command, unsigned int timeout, bool replaceEol, std::string orderingGroup = "");
     ~Command();
 
     virtual int Execute(unsigned int maxPayloadSizeBytes);
+
+    // Exclusive commands wait for all other commands of the session and hold back the ones after them
+    virtual bool IsExclusive();
     int Cancel();
 
     bool IsComplete();
@@ -122,15 +154,30 @@ public:
     void SetStatus(int exitCode, std::string textResult = "");
     void SetStatus(int exitCode, std::string textResult, State state);
 
+    // Reads the kept output from offset, or from the oldest byte still kept, up to maxSerializedSize bytes once serialized
+    Output GetOutput(size_t offset, size_t maxSerializedSize);
+
     bool operator ==(const Command& other) const;
 
 protected:
     Status m_status;
     std::mutex m_statusMutex;
 
-    std::string m_tmpFile;
+    // Signaled once by Cancel, the running command is killed as soon as it becomes readable
+    int m_cancelEvent;
+    bool m_canceled;
+
+    // Most recent output of the command, a ring of up to m_maxOutputSizeBytes guarded by m_statusMutex,
+    // cached completed commands keep only what their output actually used
+    std::vector<char> m_output;
+    size_t m_outputStart;
+    size_t m_outputTotalSize;
+    size_t m_textResultLimit;
+
+    void AppendOutput(const char* output, size_t outputSize);
+    void CompactOutput();
 
-    static int ExecutionCallback(void* context);
+    static void OutputCallback(void* context, const char* output, size_t outputSize);
 };
 
 class ShutdownCommand : public Command
@@ -139,6 +186,7 @@ public:
     ShutdownCommand(std::string id, std::string command, unsigned int timeout, bool replaceEol);
 
     int Execute(unsigned int maxPayloadSizeBytes) override;
+    bool IsExclusive() override;
 };
 
 #endif // COMMAND_H
\ No newline at end of file
@@ -1,12 +1,14 @@
 // Copyright (c) Microsoft Corporation. All rights reserved.
 // Licensed under the MIT License.
 
+#include <algorithm>
+#include <fcntl.h>
 #include <fstream>
 #include <rapidjson/document.h>
 #include <rapidjson/istreamwrapper.h>
 #include <rapidjson/stringbuffer.h>
 #include <rapidjson/writer.h>
-#include <rapidjson/prettywriter.h>
+#include <unistd.h>
 
 #include <Command.h>
 #include <CommandRunner.h>
@@ -15,7 +17,9 @@
 const std::string CommandRunner::m_componentName = "CommandRunner";
 const unsigned int CommandRunner::m_maxCacheSize = 10;
 const char* CommandRunner::m_persistedCacheFile = "/etc/osconfig/osconfig_commandrunner.cache";
-const char* CommandRunner::m_defaultCacheTemplate = "{}";
+const unsigned int CommandRunner::m_maxJournalSizeBytes = 64 * 1024;
+const char* CommandRunner::m_configurationFile = "/etc/osconfig/osconfig.json";
+const unsigned int CommandRunner::m_defaultMaxConcurrentCommands = 1;
 
 constexpr const char g_moduleInfo[] = R""""({
     "Name": "CommandRunner",
@@ -29,12 +33,18 @@ constexpr const char g_moduleInfo[] = R""""({
     "UserAccount": 0})"""";
 
 std::mutex CommandRunner::m_diskCacheMutex;
+long CommandRunner::m_compactedJournalSize = 0;
 
-CommandRunner::CommandRunner(std::string clientName, unsigned int maxPayloadSizeBytes, bool usePersistedCache) :
+static const char g_journalClient[] = "client";
+static const char g_journalStatus[] = "status";
+
+CommandRunner::CommandRunner(std::string clientName, unsigned int maxPayloadSizeBytes, bool usePersistedCache, unsigned int maxConcurrentCommands) :
     m_clientName(clientName),
     m_maxPayloadSizeBytes(maxPayloadSizeBytes),
     m_usePersistedCache(usePersistedCache),
-    m_lastPayloadHash(0)
+    m_maxConcurrentCommands((maxConcurrentCommands > 0) ? maxConcurrentCommands : 1),
+    m_lastPayloadHash(0),
+    m_reportedTextResultOffset(0)
 {
     if (m_usePersistedCache)
     {
@@ -52,32 +62,24 @@ CommandRunner::CommandRunner(std::string clientName, unsigned int maxPayloadSize
         m_commandIdLoadedFromDisk = "";
     }
 
-    // Start the worker thread
-    m_workerThread = std::thread(&CommandRunner::WorkerThread, std::ref(*this));
+    GetWorkerPool().Register(this);
 }
 
 CommandRunner::~CommandRunner()
 {
-    while (!m_commandQueue.Empty())
     {
-        std::shared_ptr<Command> command = m_commandQueue.Pop().lock();
-        if (nullptr != command)
+        std::lock_guard<std::mutex> lock(m_cacheMutex);
+        for (auto& command : m_cacheBuffer)
         {
-            command->Cancel();
+            if (!command->IsComplete())
+            {
+                command->Cancel();
+            }
         }
     }
 
-    // Push nullptr to signal the worker thread to exit
-    m_commandQueue.Push(std::weak_ptr<Command>());
-
-    try
-    {
-        if (m_workerThread.joinable())
-        {
-            m_workerThread.join();
-        }
-    }
-    catch (const std::exception& e) {}
+    // Drops the commands still queued and waits for the running ones to stop
+    GetWorkerPool().Unregister(this);
 
     Command::Status status = GetStatusToPersist();
     if (!status.m_id.empty() && (0 != PersistCommandStatus(status)))
@@ -156,7 +158,7 @@ int CommandRunner::Set(const char* componentName, const char* objectName, const
                         // Update the partial command loaded from the persisted cache
                         Command::Status currentStatus = m_commandMap[arguments.m_id]->GetStatus();
 
-                        std::shared_ptr<Command> command = std::make_shared<Command>(arguments.m_id, arguments.m_arguments, arguments.m_timeout, arguments.m_singleLineTextResult);
+                        std::shared_ptr<Command> command = std::make_shared<Command>(arguments.m_id, arguments.m_arguments, arguments.m_timeout, arguments.m_singleLineTextResult, arguments.m_orderingGroup);
                         command->SetStatus(currentStatus.m_exitCode, currentStatus.m_textResult, currentStatus.m_state);
 
                         m_commandMap[arguments.m_id] = command;
@@ -170,7 +172,7 @@ int CommandRunner::Set(const char* componentName, const char* objectName, const
                     switch (arguments.m_action)
                     {
                         case Command::Action::RunCommand:
-                            status = Run(arguments.m_id, arguments.m_arguments, arguments.m_timeout, arguments.m_singleLineTextResult);
+                            status = Run(arguments.m_id, arguments.m_arguments, arguments.m_timeout, arguments.m_singleLineTextResult, arguments.m_orderingGroup);
                             break;
                         case Command::Action::Reboot:
                             status = Reboot(arguments.m_id);
@@ -182,7 +184,7 @@ int CommandRunner::Set(const char* componentName, const char* objectName, const
                             status = Cancel(arguments.m_id);
                             break;
                         case Command::Action::RefreshCommandStatus:
-                            status = Refresh(arguments.m_id);
+                            status = Refresh(arguments.m_id, arguments.m_textResultOffset);
                             break;
                         case Command::Action::None:
                             OsConfigLogInfo(CommandRunnerLog::Get(), "No action for command: %s", arguments.m_id.c_str());
@@ -238,19 +240,17 @@ int CommandRunner::Get(const char* componentName, const char* objectName, MMI_JS
                 Command::Status commandStatus = GetReportedStatus();
                 Command::Status::Serialize(writer, commandStatus);
 
-                *payload = new (std::nothrow) char[buffer.GetSize()];
+                status = CopyJsonPayload(payload, payloadSizeBytes, buffer);
+            }
+            else if (0 == g_commandOutput.compare(objectName))
+            {
+                rapidjson::StringBuffer buffer;
+                rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
 
-                if (nullptr != *payload)
-                {
-                    std::fill(*payload, *payload + buffer.GetSize(), 0);
-                    std::memcpy(*payload, buffer.GetString(), buffer.GetSize());
-                    *payloadSizeBytes = buffer.GetSize();
-                }
-                else
-                {
-                    OsConfigLogError(CommandRunnerLog::Get(), "Failed to allocate memory for payload");
-                    status = ENOMEM;
-                }
+                Command::Output commandOutput = GetReportedOutput();
+                Command::Output::Serialize(writer, commandOutput);
+
+                status = CopyJsonPayload(payload, payloadSizeBytes, buffer);
             }
             else
             {
@@ -280,12 +280,12 @@ unsigned int CommandRunner::GetMaxPayloadSizeBytes() const
 
 void CommandRunner::WaitForCommands()
 {
-    m_commandQueue.WaitUntilEmpty();
+    GetWorkerPool().WaitUntilIdle(this);
 }
 
-int CommandRunner::Run(const std::string id, std::string arguments, unsigned int timeout, bool singleLineTextResult)
+int CommandRunner::Run(const std::string id, std::string arguments, unsigned int timeout, bool singleLineTextResult, std::string orderingGroup)
 {
-    std::shared_ptr<Command> command = std::make_shared<Command>(id, arguments, timeout, singleLineTextResult);
+    std::shared_ptr<Command> command = std::make_shared<Command>(id, arguments, timeout, singleLineTextResult, orderingGroup);
     return ScheduleCommand(command);
 }
 
@@ -321,13 +321,13 @@ int CommandRunner::Cancel(const std::string id)
     return status;
 }
 
-int CommandRunner::Refresh(const std::string id)
+int CommandRunner::Refresh(const std::string id, size_t textResultOffset)
 {
     int status = 0;
 
     if (CommandIdExists(id))
     {
-        SetReportedStatusId(id);
+        SetReportedStatusId(id, textResultOffset);
     }
     else
     {
@@ -363,7 +363,7 @@ int CommandRunner::ScheduleCommand(std::shared_ptr<Command> command)
             {
                 if (0 == (status = CacheCommand(command)))
                 {
-                    m_commandQueue.Push(command);
+                    GetWorkerPool().Push(this, command);
                 }
                 else
                 {
@@ -402,14 +402,19 @@ int CommandRunner::CacheCommand(std::shared_ptr<Command> command)
             m_cacheBuffer.push_front(command);
             SetReportedStatusId(command->GetId());
 
-            // Remove any completed commands from the cache if the cache size is greater than the maximum size
-            while (m_cacheBuffer.size() > m_maxCacheSize)
+            // Remove the oldest completed commands from the cache if the cache size is greater than the maximum size,
+            // commands that are still queued or running stay cached until they complete
+            auto oldestCommand = m_cacheBuffer.end();
+            while ((m_cacheBuffer.size() > m_maxCacheSize) && (oldestCommand != m_cacheBuffer.begin()))
             {
-                std::shared_ptr<Command> oldestCommand = m_cacheBuffer.back();
-                if ((nullptr != oldestCommand) && (oldestCommand->IsComplete()))
+                --oldestCommand;
+                if ((nullptr == *oldestCommand) || (*oldestCommand)->IsComplete())
                 {
-                    m_cacheBuffer.pop_back();
-                    m_commandMap.erase(oldestCommand->GetId());
+                    if (nullptr != *oldestCommand)
+                    {
+                        m_commandMap.erase((*oldestCommand)->GetId());
+                    }
+                    oldestCommand = m_cacheBuffer.erase(oldestCommand);
                 }
             }
         }
@@ -428,10 +433,11 @@ int CommandRunner::CacheCommand(std::shared_ptr<Command> command)
     return status;
 }
 
-void CommandRunner::SetReportedStatusId(const std::string id)
+void CommandRunner::SetReportedStatusId(const std::string id, size_t textResultOffset)
 {
     std::lock_guard<std::mutex> lock(m_reportedStatusIdMutex);
     m_reportedStatusId = id;
+    m_reportedTextResultOffset = textResultOffset;
 }
 
 std::string CommandRunner::GetReportedStatusId()
@@ -455,29 +461,78 @@ Command::Status CommandRunner::GetReportedStatus()
     }
 }
 
-void CommandRunner::WorkerThread(CommandRunner& instance)
+Command::Output CommandRunner::GetReportedOutput()
 {
-    OsConfigLogInfo(CommandRunnerLog::Get(), "Starting worker thread for session: %s", instance.m_clientName.c_str());
-
+    std::string reportedCommandId;
+    size_t textResultOffset = 0;
     std::shared_ptr<Command> command;
-    while (nullptr != (command = instance.m_commandQueue.Front().lock()))
+    size_t maxTextResultSize = SIZE_MAX;
+
     {
-        int exitCode = command->Execute(instance.m_maxPayloadSizeBytes);
+        std::lock_guard<std::mutex> lock(m_reportedStatusIdMutex);
+        reportedCommandId = m_reportedStatusId;
+        textResultOffset = m_reportedTextResultOffset;
+    }
 
-        if (IsFullLoggingEnabled())
-        {
-            OsConfigLogInfo(CommandRunnerLog::Get(), "Command '%s' (%s) completed with code: %d", command->GetId().c_str(), command->m_arguments.c_str(), exitCode);
-        }
-        else
+    {
+        std::lock_guard<std::mutex> lock(m_cacheMutex);
+        if (m_commandMap.find(reportedCommandId) != m_commandMap.end())
         {
-            OsConfigLogInfo(CommandRunnerLog::Get(), "Command '%s' completed with code: %d", command->GetId().c_str(), exitCode);
+            command = m_commandMap[reportedCommandId];
         }
+    }
+
+    if (nullptr == command)
+    {
+        return Command::Output("", 0, "", 0, Command::State::Unknown);
+    }
 
-        instance.PersistCommandStatus(command->GetStatus());
-        instance.m_commandQueue.Pop();
+    // Each page fills what the payload leaves after the rest of the object, with room for the largest offset and size
+    if (m_maxPayloadSizeBytes > 0)
+    {
+        size_t estimatedSize = Command::Output::Serialize(Command::Output(reportedCommandId, SIZE_MAX, "", SIZE_MAX, Command::State::Unknown)).size();
+        maxTextResultSize = (m_maxPayloadSizeBytes > estimatedSize) ? (m_maxPayloadSizeBytes - estimatedSize) : 0;
     }
 
-    OsConfigLogInfo(CommandRunnerLog::Get(), "Worker thread stopped for session: %s", instance.m_clientName.c_str());
+    return command->GetOutput(textResultOffset, maxTextResultSize);
+}
+
+CommandRunner::WorkerPool& CommandRunner::GetWorkerPool()
+{
+    static WorkerPool workerPool(GetWorkerThreadsFromConfiguration());
+    return workerPool;
+}
+
+unsigned int CommandRunner::GetWorkerThreadsFromConfiguration()
+{
+    char* jsonConfiguration = LoadStringFromFile(m_configurationFile, false, CommandRunnerLog::Get());
+    int workerThreads = GetCommandRunnerWorkersFromJsonConfig(jsonConfiguration, CommandRunnerLog::Get());
+    FREE_MEMORY(jsonConfiguration);
+    return static_cast<unsigned int>(workerThreads);
+}
+
+unsigned int CommandRunner::GetMaxConcurrentCommandsFromConfiguration()
+{
+    char* jsonConfiguration = LoadStringFromFile(m_configurationFile, false, CommandRunnerLog::Get());
+    int maxConcurrentCommands = GetCommandRunnerMaxConcurrentCommandsFromJsonConfig(jsonConfiguration, CommandRunnerLog::Get());
+    FREE_MEMORY(jsonConfiguration);
+    return static_cast<unsigned int>(maxConcurrentCommands);
+}
+
+void CommandRunner::Execute(std::shared_ptr<Command> command)
+{
+    int exitCode = command->Execute(m_maxPayloadSizeBytes);
+
+    if (IsFullLoggingEnabled())
+    {
+        OsConfigLogInfo(CommandRunnerLog::Get(), "Command '%s' (%s) completed with code: %d", command->GetId().c_str(), command->m_arguments.c_str(), exitCode);
+    }
+    else
+    {
+        OsConfigLogInfo(CommandRunnerLog::Get(), "Command '%s' completed with code: %d", command->GetId().c_str(), exitCode);
+    }
+
+    PersistCommandStatus(command->GetStatus());
 }
 
 Command::Status CommandRunner::GetStatusToPersist()
@@ -496,32 +551,29 @@ Command::Status CommandRunner::GetStatusToPersist()
 int CommandRunner::LoadPersistedCommandStatus(const std::string& clientName)
 {
     int status = 0;
+    JournalRecords records;
+    bool compact = false;
 
     std::lock_guard<std::mutex> lock(m_diskCacheMutex);
-    std::ifstream file(m_persistedCacheFile);
 
-    if (file.good())
+    status = ReadJournal(records, compact);
+
+    // Rewrite a cache in the previous JSON format, or with damaged records, before anything gets appended to it
+    if (compact)
     {
-        rapidjson::IStreamWrapper isw(file);
-        rapidjson::Document document;
+        CompactJournal(records);
+    }
 
-        if (document.ParseStream(isw).HasParseError())
-        {
-            OsConfigLogError(CommandRunnerLog::Get(), "Failed to parse cache file");
-            status = EINVAL;
-        }
-        else if (!document.IsObject())
-        {
-            OsConfigLogError(CommandRunnerLog::Get(), "Cache file JSON is not an array");
-            status = EINVAL;
-        }
-        else if (document.HasMember(clientName.c_str()))
+    if (0 == status)
+    {
+        auto client = records.find(clientName);
+        if (client != records.end())
         {
-            const rapidjson::Value& client = document[clientName.c_str()];
-
-            for (auto& it : client.GetArray())
+            for (auto& record : client->second)
             {
-                Command::Status commandStatus = Command::Status::Deserialize(it);
+                rapidjson::Document document;
+                document.Parse(record.second.c_str());
+                Command::Status commandStatus = Command::Status::Deserialize(document[g_journalStatus]);
 
                 std::shared_ptr<Command> command = std::make_shared<Command>(commandStatus.m_id, "", 0, "");
                 command->SetStatus(commandStatus.m_exitCode, commandStatus.m_textResult, commandStatus.m_state);
@@ -550,144 +602,444 @@ int CommandRunner::PersistCommandStatus(const Command::Status& status)
 int CommandRunner::PersistCommandStatus(const std::string& clientName, const Command::Status commandStatus)
 {
     int status = 0;
-    rapidjson::Document document;
-    rapidjson::Document statusDocument;
-    statusDocument.Parse(Command::Status::Serialize(commandStatus, false).c_str());
+    JournalRecords records;
+    bool compact = false;
+    long journalSize = 0;
+    std::string record = SerializeJournalRecord(clientName, commandStatus);
+    char crc[16] = {0};
+
     std::lock_guard<std::mutex> lock(m_diskCacheMutex);
 
-    std::ifstream file(m_persistedCacheFile);
-    if (file.good())
+    // Each status update is one line appended to the journal: the CRC-32 of the record, a space and the record
+    snprintf(crc, sizeof(crc), "%08x ", Crc32(record));
+    record = crc + record + "\n";
+
+    bool created = !FileExists(m_persistedCacheFile);
+    std::FILE* file = std::fopen(m_persistedCacheFile, "a+");
+    if (nullptr == file)
     {
-        rapidjson::IStreamWrapper isw(file);
-        if (document.ParseStream(isw).HasParseError() || (!document.IsObject()))
+        OsConfigLogError(CommandRunnerLog::Get(), "Failed to open file: %s", m_persistedCacheFile);
+        status = EACCES;
+    }
+    else
+    {
+        // Terminate a record torn by an earlier crash, so that it does not swallow this one
+        if ((0 == std::fseek(file, -1, SEEK_END)) && ('\n' != std::fgetc(file)))
+        {
+            record = "\n" + record;
+        }
+        std::fseek(file, 0, SEEK_END);
+
+        int rc = std::fputs(record.c_str(), file);
+
+        if ((0 > rc) || (EOF == rc))
         {
-            document.Parse(m_defaultCacheTemplate);
+            status = errno ? errno : EINVAL;
+            OsConfigLogError(CommandRunnerLog::Get(), "Failed write to file %s, error: %d %s", m_persistedCacheFile, status, errno ? strerror(errno) : "-");
+        }
+
+        fflush(file);
+        journalSize = std::ftell(file);
+        std::fclose(file);
+
+        if (created)
+        {
+            RestrictFileAccessToCurrentAccountOnly(m_persistedCacheFile);
         }
     }
-    else
+
+    // Keep only the latest record of each cached command once the journal grows past its limit, or past twice its
+    // last compacted size when that alone is above the limit, so that each compaction is paid for by many appends
+    if ((0 == status) && (journalSize > std::max(static_cast<long>(m_maxJournalSizeBytes), 2 * m_compactedJournalSize)) && (0 == ReadJournal(records, compact)))
     {
-        document.Parse(m_defaultCacheTemplate);
+        status = CompactJournal(records);
     }
 
-    rapidjson::Document::AllocatorType& allocator = document.GetAllocator();
+    return status;
+}
+
+int CommandRunner::ReadJournal(JournalRecords& records, bool& compact)
+{
+    int status = 0;
+    std::ifstream file(m_persistedCacheFile);
+    std::string line;
+
+    records.clear();
+    compact = false;
+
+    if (!file.good())
+    {
+        return status;
+    }
 
-    if (document.HasMember(clientName.c_str()))
+    // A cache written in the previous JSON format is read whole, the caller converts it with a compaction
+    if ('{' == (file >> std::ws).peek())
     {
-        bool updated = false;
-        rapidjson::Value& client = document[clientName.c_str()];
+        rapidjson::IStreamWrapper isw(file);
+        rapidjson::Document document;
+        compact = true;
 
-        if (!client.IsArray())
+        if (document.ParseStream(isw).HasParseError() || !document.IsObject())
         {
-            client.SetArray();
+            OsConfigLogError(CommandRunnerLog::Get(), "Failed to parse cache file");
+            return EINVAL;
         }
 
-        for (auto& it : client.GetArray())
+        for (auto& client : document.GetObject())
         {
-            if (it.HasMember(g_commandId.c_str()) && it[g_commandId.c_str()].IsString() && (it[g_commandId.c_str()].GetString() == commandStatus.m_id))
+            if (client.value.IsArray())
             {
-                it.CopyFrom(statusDocument, allocator);
-                updated = true;
-                break;
+                for (auto& it : client.value.GetArray())
+                {
+                    Command::Status commandStatus = Command::Status::Deserialize(it);
+                    if (!commandStatus.m_id.empty())
+                    {
+                        records[client.name.GetString()].push_back(std::make_pair(commandStatus.m_id, SerializeJournalRecord(client.name.GetString(), commandStatus)));
+                    }
+                }
             }
         }
 
-        if (!updated)
+        return status;
+    }
+
+    while (std::getline(file, line))
+    {
+        rapidjson::Document document;
+        std::string record = (line.size() > 9) ? line.substr(9) : "";
+
+        // Records that fail the CRC check, such as one torn by a power loss while appending, are skipped
+        if (record.empty() || (' ' != line[8]) || (strtoul(line.substr(0, 8).c_str(), nullptr, 16) != Crc32(record)) ||
+            document.Parse(record.c_str()).HasParseError() || !document.HasMember(g_journalClient) || !document[g_journalClient].IsString() || !document.HasMember(g_journalStatus))
         {
-            if (client.Size() >= m_maxCacheSize)
+            OsConfigLogError(CommandRunnerLog::Get(), "Skipping damaged record in cache file %s", m_persistedCacheFile);
+            compact = true;
+            continue;
+        }
+
+        std::string id = Command::Status::Deserialize(document[g_journalStatus]).m_id;
+        std::vector<std::pair<std::string, std::string>>& client = records[document[g_journalClient].GetString()];
+
+        auto existing = std::find_if(client.begin(), client.end(), [&](const std::pair<std::string, std::string>& entry) { return entry.first == id; });
+        if (existing != client.end())
+        {
+            existing->second = record;
+        }
+        else
+        {
+            if (client.size() >= m_maxCacheSize)
             {
-                client.Erase(client.Begin());
+                client.erase(client.begin());
             }
 
-            client.PushBack(statusDocument, allocator);
+            client.push_back(std::make_pair(id, record));
         }
     }
-    else
+
+    return status;
+}
+
+int CommandRunner::CompactJournal(const JournalRecords& records)
+{
+    int status = 0;
+    std::string compactedFile = std::string(m_persistedCacheFile) + ".tmp";
+    char crc[16] = {0};
+
+    std::FILE* file = std::fopen(compactedFile.c_str(), "w");
+    if (nullptr == file)
     {
-        rapidjson::Value object(rapidjson::kArrayType);
-        object.PushBack(statusDocument, allocator);
-        document.AddMember(rapidjson::Value(clientName.c_str(), allocator), object, allocator);
+        OsConfigLogError(CommandRunnerLog::Get(), "Failed to open file: %s", compactedFile.c_str());
+        return EACCES;
     }
 
-    rapidjson::StringBuffer buffer;
-    rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
-    document.Accept(writer);
+    for (auto& client : records)
+    {
+        for (auto& record : client.second)
+        {
+            snprintf(crc, sizeof(crc), "%08x ", Crc32(record.second));
+            if ((EOF == std::fputs(crc, file)) || (EOF == std::fputs(record.second.c_str(), file)) || (EOF == std::fputs("\n", file)))
+            {
+                status = errno ? errno : EINVAL;
+            }
+        }
+    }
+
+    // The compacted journal has to be on disk before the rename makes it the only copy
+    if (((0 != fflush(file)) || (0 != fsync(fileno(file)))) && (0 == status))
+    {
+        status = errno ? errno : EIO;
+    }
+
+    m_compactedJournalSize = std::ftell(file);
+    std::fclose(file);
+    RestrictFileAccessToCurrentAccountOnly(compactedFile.c_str());
 
-    if (buffer.GetSize() > 0)
+    // The compacted journal replaces the old one in a single rename, so a crash leaves either of them intact
+    if ((0 != status) || (0 != rename(compactedFile.c_str(), m_persistedCacheFile)))
+    {
+        status = status ? status : errno;
+        OsConfigLogError(CommandRunnerLog::Get(), "Failed to compact cache file %s, error: %d %s", m_persistedCacheFile, status, strerror(status));
+        remove(compactedFile.c_str());
+    }
+    else
     {
-        std::FILE* file = std::fopen(m_persistedCacheFile, "w+");
-        if (nullptr == file)
+        // Persist the rename itself
+        std::string directory = m_persistedCacheFile;
+        size_t separator = directory.find_last_of('/');
+        directory = (std::string::npos != separator) ? directory.substr(0, separator + 1) : ".";
+
+        int descriptor = open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+        if ((descriptor < 0) || (0 != fsync(descriptor)))
         {
-            OsConfigLogError(CommandRunnerLog::Get(), "Failed to open file: %s", m_persistedCacheFile);
-            status = EACCES;
+            OsConfigLogError(CommandRunnerLog::Get(), "Failed to sync directory of cache file %s, error: %d", m_persistedCacheFile, errno);
         }
-        else
+
+        if (descriptor >= 0)
         {
-            int rc = std::fputs(buffer.GetString(), file);
+            close(descriptor);
+        }
+    }
 
-            if ((0 > rc) || (EOF == rc))
-            {
-                status = errno ? errno : EINVAL;
-                OsConfigLogError(CommandRunnerLog::Get(), "Failed write to file %s, error: %d %s", m_persistedCacheFile, status, errno ? strerror(errno) : "-");
-            }
+    return status;
+}
 
-            fflush(file);
-            std::fclose(file);
+std::string CommandRunner::SerializeJournalRecord(const std::string& clientName, const Command::Status& status)
+{
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
 
-            RestrictFileAccessToCurrentAccountOnly(m_persistedCacheFile);
+    writer.StartObject();
+    writer.Key(g_journalClient);
+    writer.String(clientName.c_str());
+    writer.Key(g_journalStatus);
+    Command::Status::Serialize(writer, status, false);
+    writer.EndObject();
+
+    return buffer.GetString();
+}
+
+uint32_t CommandRunner::Crc32(const std::string& data)
+{
+    uint32_t crc = 0xFFFFFFFF;
+
+    for (unsigned char byte : data)
+    {
+        crc ^= byte;
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
         }
     }
 
+    return ~crc;
+}
+
+int CommandRunner::CopyJsonPayload(MMI_JSON_STRING* payload, int* payloadSizeBytes, const rapidjson::StringBuffer& buffer)
+{
+    int status = MMI_OK;
+
+    *payload = new (std::nothrow) char[buffer.GetSize()];
+
+    if (nullptr != *payload)
+    {
+        std::fill(*payload, *payload + buffer.GetSize(), 0);
+        std::memcpy(*payload, buffer.GetString(), buffer.GetSize());
+        *payloadSizeBytes = buffer.GetSize();
+    }
+    else
+    {
+        OsConfigLogError(CommandRunnerLog::Get(), "Failed to allocate memory for payload");
+        status = ENOMEM;
+    }
+
     return status;
 }
 
-template<class T>
-CommandRunner::SafeQueue<T>::SafeQueue() :
-    m_queue(),
-    m_mutex(),
-    m_condition() { }
+CommandRunner::WorkerPool::WorkerPool(unsigned int maxWorkerThreads) :
+    m_stopping(false)
+{
+    for (unsigned int i = 0; i < maxWorkerThreads; i++)
+    {
+        m_workerThreads.push_back(std::thread(&CommandRunner::WorkerPool::WorkerThread, std::ref(*this)));
+    }
+}
 
-template<class T>
-void CommandRunner::SafeQueue<T>::Push(T value)
+CommandRunner::WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+        m_condition.notify_all();
+    }
+
+    for (auto& workerThread : m_workerThreads)
+    {
+        try
+        {
+            if (workerThread.joinable())
+            {
+                workerThread.join();
+            }
+        }
+        catch (const std::exception& e) {}
+    }
+}
+
+void CommandRunner::WorkerPool::Register(CommandRunner* session)
 {
     std::lock_guard<std::mutex> lock(m_mutex);
-    m_queue.push(value);
-    m_condition.notify_one();
+    if (m_sessions.find(session) == m_sessions.end())
+    {
+        m_sessions[session] = Session();
+        m_turns.push_back(session);
+    }
 }
 
-template<class T>
-T CommandRunner::SafeQueue<T>::Pop()
+void CommandRunner::WorkerPool::Unregister(CommandRunner* session)
 {
     std::unique_lock<std::mutex> lock(m_mutex);
-    m_condition.wait(lock, [this] { return !m_queue.empty(); });
-    T value = m_queue.front();
-    m_queue.pop();
+    auto it = m_sessions.find(session);
 
-    if (m_queue.empty())
+    if (it != m_sessions.end())
     {
-        m_conditionEmpty.notify_one();
+        it->second.m_pending.clear();
+        m_conditionIdle.wait(lock, [&] { return 0 == it->second.m_running; });
+
+        m_sessions.erase(it);
+        m_turns.erase(std::remove(m_turns.begin(), m_turns.end(), session), m_turns.end());
+        m_conditionIdle.notify_all();
     }
+}
+
+void CommandRunner::WorkerPool::Push(CommandRunner* session, std::weak_ptr<Command> command)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_sessions.find(session);
 
-    return value;
+    if (it != m_sessions.end())
+    {
+        it->second.m_pending.push_back(command);
+        m_condition.notify_one();
+    }
 }
 
-template<class T>
-T CommandRunner::SafeQueue<T>::Front()
+void CommandRunner::WorkerPool::WaitUntilIdle(CommandRunner* session)
 {
     std::unique_lock<std::mutex> lock(m_mutex);
-    m_condition.wait(lock, [this] { return !m_queue.empty(); });
-    return m_queue.front();
+    m_conditionIdle.wait(lock, [&] { return IsIdle(session); });
 }
 
-template<class T>
-bool CommandRunner::SafeQueue<T>::Empty()
+bool CommandRunner::WorkerPool::IsIdle(CommandRunner* session)
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    return m_queue.empty();
+    auto it = m_sessions.find(session);
+    return (it == m_sessions.end()) || (it->second.m_pending.empty() && (0 == it->second.m_running));
 }
 
-template<class T>
-void CommandRunner::SafeQueue<T>::WaitUntilEmpty()
+bool CommandRunner::WorkerPool::Next(CommandRunner*& session, std::shared_ptr<Command>& command)
 {
-    std::unique_lock<std::mutex> lock(m_mutex);
-    m_conditionEmpty.wait(lock, [this] { return m_queue.empty(); });
+    // Visit the sessions round robin so that a busy session cannot hold back the others
+    for (size_t turn = 0; turn < m_turns.size(); turn++)
+    {
+        CommandRunner* candidate = m_turns.front();
+        m_turns.pop_front();
+        m_turns.push_back(candidate);
+
+        Session& state = m_sessions[candidate];
+        if (state.m_runningExclusive || (state.m_running >= candidate->m_maxConcurrentCommands))
+        {
+            continue;
+        }
+
+        for (auto pending = state.m_pending.begin(); pending != state.m_pending.end();)
+        {
+            std::shared_ptr<Command> next = pending->lock();
+            if (nullptr == next)
+            {
+                pending = state.m_pending.erase(pending);
+                continue;
+            }
+
+            bool runnable = false;
+            bool stop = false;
+
+            if (next->IsExclusive())
+            {
+                // Commands received after an exclusive one (reboot, shutdown) wait for it
+                runnable = (0 == state.m_running);
+                stop = true;
+            }
+            else
+            {
+                runnable = next->m_orderingGroup.empty() || (state.m_runningGroups.find(next->m_orderingGroup) == state.m_runningGroups.end());
+            }
+
+            if (runnable)
+            {
+                state.m_pending.erase(pending);
+                state.m_running++;
+                state.m_runningExclusive = next->IsExclusive();
+                if (!next->m_orderingGroup.empty())
+                {
+                    state.m_runningGroups.insert(next->m_orderingGroup);
+                }
+
+                session = candidate;
+                command = next;
+                return true;
+            }
+            else if (stop)
+            {
+                break;
+            }
+
+            ++pending;
+        }
+
+        if (state.m_pending.empty() && (0 == state.m_running))
+        {
+            m_conditionIdle.notify_all();
+        }
+    }
+
+    return false;
+}
+
+void CommandRunner::WorkerPool::Complete(CommandRunner* session, std::shared_ptr<Command> command)
+{
+    Session& state = m_sessions[session];
+
+    state.m_running--;
+    state.m_runningExclusive = false;
+    if (!command->m_orderingGroup.empty())
+    {
+        state.m_runningGroups.erase(command->m_orderingGroup);
+    }
+
+    // A finished command may unblock commands of its own session that other workers passed over
+    m_condition.notify_all();
+    m_conditionIdle.notify_all();
+}
+
+void CommandRunner::WorkerPool::WorkerThread(WorkerPool& pool)
+{
+    std::unique_lock<std::mutex> lock(pool.m_mutex);
+
+    while (!pool.m_stopping)
+    {
+        CommandRunner* session = nullptr;
+        std::shared_ptr<Command> command;
+
+        if (pool.Next(session, command))
+        {
+            lock.unlock();
+            session->Execute(command);
+            lock.lock();
+
+            pool.Complete(session, command);
+        }
+        else
+        {
+            pool.m_condition.wait(lock);
+        }
+    }
 }
\ No newline at end of file
@@ -5,14 +5,17 @@
 #define COMMANDRUNNER_H
 
 #include <condition_variable>
+#include <cstdint>
+#include <deque>
 #include <map>
 #include <mutex>
-#include <queue>
 #include <rapidjson/document.h>
 #include <rapidjson/stringbuffer.h>
 #include <rapidjson/writer.h>
+#include <set>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include <Command.h>
 #include <Mmi.h>
@@ -24,9 +27,15 @@ public:
 
     static const unsigned int m_maxCacheSize;
     static const char* m_persistedCacheFile;
-    static const char* m_defaultCacheTemplate;
+    static const unsigned int m_maxJournalSizeBytes;
 
-    CommandRunner(std::string name, unsigned int maxSizeInBytes = 0, bool usePersistedCache = true);
+    static const char* m_configurationFile;
+    static const unsigned int m_defaultMaxConcurrentCommands;
+
+    // Per client limit read from the general OSConfig configuration file, commands run one at a time unless configured otherwise
+    static unsigned int GetMaxConcurrentCommandsFromConfiguration();
+
+    CommandRunner(std::string name, unsigned int maxSizeInBytes = 0, bool usePersistedCache = true, unsigned int maxConcurrentCommands = m_defaultMaxConcurrentCommands);
     ~CommandRunner();
 
     static int GetInfo(const char* clientName, MMI_JSON_STRING* payload, int* payloadSizeBytes);
@@ -36,73 +45,99 @@ public:
     const std::string& GetClientName() const;
     unsigned int GetMaxPayloadSizeBytes() const;
 
-    // Helper method to wait for the worker thread during unit tests
+    // Helper method to wait for the scheduled commands during unit tests
     void WaitForCommands();
 
 private:
-    template<class T>
-    class SafeQueue
+    // Worker threads shared by all sessions, taking turns between the sessions with runnable commands
+    class WorkerPool
     {
     public:
-        SafeQueue();
-        ~SafeQueue() { }
+        WorkerPool(unsigned int maxWorkerThreads);
+        ~WorkerPool();
 
-        void Push(T element);
-        T Pop();
-        T Front();
-        bool Empty();
-        void WaitUntilEmpty();
+        void Register(CommandRunner* session);
+        void Unregister(CommandRunner* session);
+        void Push(CommandRunner* session, std::weak_ptr<Command> command);
+        void WaitUntilIdle(CommandRunner* session);
 
     private:
-        std::queue<T> m_queue;
-        mutable std::mutex m_mutex;
+        struct Session
+        {
+            std::deque<std::weak_ptr<Command>> m_pending;
+            std::set<std::string> m_runningGroups;
+            unsigned int m_running = 0;
+            bool m_runningExclusive = false;
+        };
+
+        bool Next(CommandRunner*& session, std::shared_ptr<Command>& command);
+        void Complete(CommandRunner* session, std::shared_ptr<Command> command);
+        bool IsIdle(CommandRunner* session);
+
+        static void WorkerThread(WorkerPool& pool);
+
+        std::vector<std::thread> m_workerThreads;
+        std::map<CommandRunner*, Session> m_sessions;
+        std::deque<CommandRunner*> m_turns;
+        bool m_stopping;
+        std::mutex m_mutex;
         std::condition_variable m_condition;
-        std::condition_variable m_conditionEmpty;
+        std::condition_variable m_conditionIdle;
     };
 
     const std::string m_clientName;
     const unsigned int m_maxPayloadSizeBytes;
     const bool m_usePersistedCache;
+    const unsigned int m_maxConcurrentCommands;
 
     std::string m_commandIdLoadedFromDisk;
     size_t m_lastPayloadHash;
 
-    std::thread m_workerThread;
-    SafeQueue<std::weak_ptr<Command>> m_commandQueue;
-
     std::deque<std::shared_ptr<Command>> m_cacheBuffer;
     std::map<std::string, std::shared_ptr<Command>> m_commandMap;
     std::mutex m_cacheMutex;
 
     std::string m_reportedStatusId;
+    size_t m_reportedTextResultOffset;
     std::mutex m_reportedStatusIdMutex;
 
+    // Latest persisted status record of each command, per client, oldest first
+    typedef std::map<std::string, std::vector<std::pair<std::string, std::string>>> JournalRecords;
+
     static std::mutex m_diskCacheMutex;
+    static long m_compactedJournalSize;
 
-    int Run(const std::string id, std::string arguments, unsigned int timeout, bool singleLineTextResult);
+    int Run(const std::string id, std::string arguments, unsigned int timeout, bool singleLineTextResult, std::string orderingGroup);
     int Reboot(const std::string id);
     int Shutdown(const std::string id);
     int Cancel(const std::string id);
     void CancelAll();
-    int Refresh(const std::string id);
+    int Refresh(const std::string id, size_t textResultOffset = 0);
 
     bool CommandExists(std::shared_ptr<Command> command);
     bool CommandIdExists(const std::string& id);
     int ScheduleCommand(std::shared_ptr<Command> command);
     int CacheCommand(std::shared_ptr<Command> command);
 
-    void SetReportedStatusId(const std::string id);
+    void SetReportedStatusId(const std::string id, size_t textResultOffset = 0);
     std::string GetReportedStatusId();
     Command::Status GetReportedStatus();
+    Command::Output GetReportedOutput();
 
-    static void WorkerThread(CommandRunner& instance);
-    void Execute(Command command);
+    static WorkerPool& GetWorkerPool();
+    static unsigned int GetWorkerThreadsFromConfiguration();
+    void Execute(std::shared_ptr<Command> command);
 
     Command::Status GetStatusToPersist();
     int LoadPersistedCommandStatus(const std::string& clientName);
     int PersistCommandStatus(const Command::Status& status);
     static int PersistCommandStatus(const std::string& clientName, const Command::Status status);
 
+    static int ReadJournal(JournalRecords& records, bool& compact);
+    static int CompactJournal(const JournalRecords& records);
+    static std::string SerializeJournalRecord(const std::string& clientName, const Command::Status& status);
+    static uint32_t Crc32(const std::string& data);
+
     static int WriteFile(const std::string& fileName, const rapidjson::StringBuffer& buffer);
     static int CopyJsonPayload(MMI_JSON_STRING* payload, int* payloadSizeBytes, const rapidjson::StringBuffer& buffer);
 };
@@ -83,7 +83,7 @@ MMI_HANDLE MmiOpen(
 
     if (nullptr != clientName)
     {
-        CommandRunner* commandRunner = new (std::nothrow) CommandRunner(clientName, maxPayloadSizeBytes);
+        CommandRunner* commandRunner = new (std::nothrow) CommandRunner(clientName, maxPayloadSizeBytes, true, CommandRunner::GetMaxConcurrentCommandsFromConfiguration());
         if (nullptr != commandRunner)
         {
             handle = reinterpret_cast<MMI_HANDLE>(commandRunner);
@@ -1,8 +1,12 @@
 // Copyright (c) Microsoft Corporation. All rights reserved.
 // Licensed under the MIT License.
 
+#include <chrono>
+#include <fstream>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include <sstream>
+#include <thread>
 
 #include <Command.h>
 #include <CommandRunner.h>
@@ -54,6 +58,22 @@ namespace Tests
         return std::to_string(id++);
     }
 
+    // Polls until the condition holds, the deadline only bounds how long a failing test takes
+    template<typename Condition>
+    static bool WaitUntil(Condition condition)
+    {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+        while (!condition())
+        {
+            if (std::chrono::steady_clock::now() > deadline)
+            {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return true;
+    }
+
     TEST_F(CommandRunnerTests, SetInvalidComponent)
     {
         std::string id = Id();
@@ -348,6 +368,315 @@ namespace Tests
         EXPECT_TRUE(IsJsonEq(Command::Status::Serialize(status), std::string(reportedPayload, payloadSizeBytes)));
     }
 
+    TEST_F(CommandRunnerTests, RunCommandsConcurrently)
+    {
+        CommandRunner commandRunner("CommandRunner_Concurrent_Test_Client", 0, false, 2);
+        std::string id1 = Id();
+        std::string id2 = Id();
+        Command::Arguments arguments1(id1, "sleep 60", Command::Action::RunCommand, 0, false);
+        Command::Arguments arguments2(id2, "echo 'quick'", Command::Action::RunCommand, 0, false);
+        Command::Arguments refresh1(id1, "", Command::Action::RefreshCommandStatus, 0, false);
+        Command::Arguments refresh2(id2, "", Command::Action::RefreshCommandStatus, 0, false);
+        Command::Arguments cancel1(id1, "", Command::Action::CancelCommand, 0, false);
+        Command::Status status1(id1, 0, "", Command::State::Running);
+        Command::Status status2(id2, 0, "quick\n", Command::State::Succeeded);
+
+        std::string desiredPayload1 = Command::Arguments::Serialize(arguments1);
+        std::string desiredPayload2 = Command::Arguments::Serialize(arguments2);
+        std::string refreshPayload1 = Command::Arguments::Serialize(refresh1);
+        std::string refreshPayload2 = Command::Arguments::Serialize(refresh2);
+        std::string cancelPayload1 = Command::Arguments::Serialize(cancel1);
+
+        MMI_JSON_STRING reportedPayload = nullptr;
+        int payloadSizeBytes = 0;
+
+        EXPECT_EQ(MMI_OK, commandRunner.Set(m_component, m_desiredObject, (MMI_JSON_STRING)(desiredPayload1.c_str()), desiredPayload1.size()));
+        EXPECT_EQ(MMI_OK, commandRunner.Set(m_component, m_desiredObject, (MMI_JSON_STRING)(desiredPayload2.c_str()), desiredPayload2.size()));
+
+        // The quick command does not wait behind the long running one, which is still running once the quick one succeeded
+        EXPECT_TRUE(WaitUntil([&]()
+        {
+            EXPECT_EQ(MMI_OK, commandRunner.Set(m_component, m_desiredObject, (MMI_JSON_STRING)(refreshPayload2.c_str()), refreshPayload2.size()));
+            EXPECT_EQ(MMI_OK, commandRunner.Get(m_component, m_reportedObject, &reportedPayload, &payloadSizeBytes));
+            bool succeeded = IsJsonEq(Command::Status::Serialize(status2), std::string(reportedPayload, payloadSizeBytes));
+            delete[] reportedPayload;
+            return succeeded;
+        }));
+
+        EXPECT_EQ(MMI_OK, commandRunner.Set(m_component, m_desiredObject, (MMI_JSON_STRING)(refreshPayload1.c_str()), refreshPayload1.size()));
+        EXPECT_EQ(MMI_OK, commandRunner.Get(m_component, m_reportedObject, &reportedPayload, &payloadSizeBytes));
+        EXPECT_TRUE(IsJsonEq(Command::Status::Serialize(status1), std::string(reportedPayload, payloadSizeBytes)));
+
+        EXPECT_EQ(MMI_OK, commandRunner.Set(m_component, m_desiredObject, (MMI_JSON_STRING)(cancelPayload1.c_str()), cancelPayload1.size()));
+        commandRunner.WaitForCommands();
+    }
+
+    TEST_F(CommandRunnerTests, RunCommandsInOrderingGroup)
+    {
+        CommandRunner commandRunner("CommandRunner_Ordering_Test_Client", 0, false, 2);
+        const std::string outputFile = "~commandrunner_ordering_group";
+        std::string id1 = Id();
+        std::string id2 = Id();
+        Command::Arguments arguments1(id1, "sleep 1; echo 'first' >> " + outputFile, Command::Action::RunCommand, 0, false, "group");
+        Command::Arguments arguments2(id2, "echo 'second' >> " + outputFile, Command::Action::RunCommand, 0, false, "group");
+
+        std::string desiredPayload1 = Command::Arguments::Serialize(arguments1);
+        std::string desiredPayload2 = Command::Arguments::Serialize(arguments2);
+
+        EXPECT_EQ(MMI_OK, commandRunner.Set(m_component, m_desiredObject, (MMI_JSON_STRING)(desiredPayload1.c_str()), desiredPayload1.size()));
+        EXPECT_EQ(MMI_OK, commandRunner.Set(m_component, m_desiredObject, (MMI_JSON_STRING)(desiredPayload2.c_str()), desiredPayload2.size()));
+
+        commandRunner.WaitForCommands();
+
+        std::ifstream output(outputFile);
+        std::stringstream content;
+        content << output.rdbuf();
+        EXPECT_EQ("first\nsecond\n", content.str());
+
+        remove(outputFile.c_str());
+    }
+
+    TEST_F(CommandRunnerTests, RunCommandPartialTextResult)
+    {
+        std::string id = Id();
+        Command::Arguments arguments(id, "echo 'partial'; sleep 60", Command::Action::RunCommand, 0, false);
+        Command::Arguments cancel(id, "", Command::Action::CancelCommand, 0, false);
+        Command::Status status(id, 0, "partial\n", Command::State::Running);
+
+        std::string desiredPayload = Command::Arguments::Serialize(arguments);
+        std::string cancelPayload = Command::Arguments::Serialize(cancel);
+        MMI_JSON_STRING reportedPayload = nullptr;
+        int payloadSizeBytes = 0;
+
+        EXPECT_EQ(MMI_OK, m_commandRunner->Set(m_component, m_desiredObject, (MMI_JSON_STRING)(desiredPayload.c_str()), desiredPayload.size()));
+
+        // The output written so far is reported while the command is still running
+        EXPECT_TRUE(WaitUntil([&]()
+        {
+            EXPECT_EQ(MMI_OK, m_commandRunner->Get(m_component, m_reportedObject, &reportedPayload, &payloadSizeBytes));
+            bool reported = IsJsonEq(Command::Status::Serialize(status), std::string(reportedPayload, payloadSizeBytes));
+            delete[] reportedPayload;
+            return reported;
+        }));
+
+        EXPECT_EQ(MMI_OK, m_commandRunner->Set(m_component, m_desiredObject, (MMI_JSON_STRING)(cancelPayload.c_str()), cancelPayload.size()));
+        m_commandRunner->WaitForCommands();
+    }
+
+    TEST_F(CommandRunnerTests, RunCommandOutputPages)
+    {
+        const unsigned int maxPayloadSizeBytes = 200;
+        CommandRunner commandRunner("CommandRunner_Output_Test_Client", maxPayloadSizeBytes, false);
+        std::string id = Id();
+        Command::Arguments arguments(id, "seq 1 100", Command::Action::RunCommand, 0, false);
+        std::string desiredPayload = Command::Arguments::Serialize(arguments);
+        std::string expectedOutput;
+        std::string output;
+        size_t offset = 0;
+        size_t totalSize = 0;
+        int pages = 0;
+
+        for (int i = 1; i <= 100; i++)
+        {
+            expectedOutput += std::to_string(i) + "\n";
+        }
+
+        EXPECT_EQ(MMI_OK, commandRunner.Set(m_component, m_desiredObject, (MMI_JSON_STRING)(desiredPayload.c_str()), desiredPayload.size()));
+        commandRunner.WaitForCommands();
+
+        do
+        {
+            Command::Arguments refresh(id, "", Command::Action::RefreshCommandStatus, 0, false, "", offset);
+            std::string refreshPayload = Command::Arguments::Serialize(refresh);
+            MMI_JSON_STRING reportedPayload = nullptr;
+            int payloadSizeBytes = 0;
+            rapidjson::Document document;
+
+            EXPECT_EQ(MMI_OK, commandRunner.Set(m_component, m_desiredObject, (MMI_JSON_STRING)(refreshPayload.c_str()), refreshPayload.size()));
+            EXPECT_EQ(MMI_OK, commandRunner.Get(m_component, g_commandOutput.c_str(), &reportedPayload, &payloadSizeBytes));
+            EXPECT_LE(payloadSizeBytes, static_cast<int>(maxPayloadSizeBytes));
+
+            ASSERT_FALSE(document.Parse(reportedPayload, payloadSizeBytes).HasParseError());
+            EXPECT_EQ(offset, document[g_textResultOffset.c_str()].GetUint64());
+            EXPECT_EQ(Command::State::Succeeded, document[g_currentState.c_str()].GetInt());
+
+            std::string page = document[g_textResult.c_str()].GetString();
+            ASSERT_FALSE(page.empty());
+
+            output += page;
+            offset += page.size();
+            totalSize = document[g_textResultTotalSize.c_str()].GetUint64();
+            pages++;
+
+            delete[] reportedPayload;
+        }
+        while (offset < totalSize);
+
+        EXPECT_GT(pages, 1);
+        EXPECT_EQ(expectedOutput, output);
+    }
+
+    TEST_F(CommandRunnerTests, CommandOutputKeepsMostRecentBytes)
+    {
+        const size_t outputSize = Command::m_maxOutputSizeBytes + 1000;
+        Command command(Id(), "head -c " + std::to_string(outputSize) + " /dev/zero | tr '\\0' 'a'", 0, false);
+
+        EXPECT_EQ(0, command.Execute(0));
+
+        Command::Output output = command.GetOutput(0, SIZE_MAX);
+        EXPECT_EQ(outputSize - Command::m_maxOutputSizeBytes, output.m_offset);
+        EXPECT_EQ(outputSize, output.m_totalSize);
+        EXPECT_EQ(Command::m_maxOutputSizeBytes, output.m_textResult.size());
+        EXPECT_EQ(std::string::npos, output.m_textResult.find_first_not_of('a'));
+    }
+
+    TEST_F(CommandRunnerTests, CommandOutputPagesOnCharacterBoundaries)
+    {
+        // One, two, three and four byte UTF-8 characters, pages of 6 bytes cut some of them
+        const std::string text = "a\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80";
+        const size_t pageSize = 6;
+        Command command(Id(), "for i in 1 2 3 4 5 6 7 8; do printf '" + text + "'; done", 0, false);
+        std::string expectedOutput;
+        std::string textResult;
+        size_t offset = 0;
+
+        for (int i = 0; i < 8; i++)
+        {
+            expectedOutput += text;
+        }
+
+        EXPECT_EQ(0, command.Execute(0));
+
+        while (offset < expectedOutput.size())
+        {
+            Command::Output output = command.GetOutput(offset, pageSize);
+            ASSERT_FALSE(output.m_textResult.empty());
+
+            // The last character of each page is complete
+            size_t lead = output.m_textResult.find_last_not_of("\x80\x81\x82\x83\x84\x85\x86\x87\x88\x89\x8A\x8B\x8C\x8D\x8E\x8F"
+                "\x90\x91\x92\x93\x94\x95\x96\x97\x98\x99\x9A\x9B\x9C\x9D\x9E\x9F\xA0\xA1\xA2\xA3\xA4\xA5\xA6\xA7\xA8\xA9\xAA\xAB\xAC\xAD\xAE\xAF"
+                "\xB0\xB1\xB2\xB3\xB4\xB5\xB6\xB7\xB8\xB9\xBA\xBB\xBC\xBD\xBE\xBF");
+            ASSERT_NE(std::string::npos, lead);
+            unsigned char byte = static_cast<unsigned char>(output.m_textResult[lead]);
+            size_t length = (byte >= 0xF0) ? 4 : (byte >= 0xE0) ? 3 : (byte >= 0xC0) ? 2 : 1;
+            EXPECT_EQ(length, output.m_textResult.size() - lead);
+
+            textResult += output.m_textResult;
+            offset = output.m_offset + output.m_textResult.size();
+        }
+
+        EXPECT_EQ(expectedOutput, textResult);
+    }
+
+    // Runs against a journal of its own, restored to the default one even when a test fails partway
+    class CommandRunnerJournalTests : public CommandRunnerTests
+    {
+    protected:
+        static const char m_clientName[];
+        const char* m_defaultPersistedCacheFile = nullptr;
+
+        std::string m_journalId;
+        std::string m_desiredPayload;
+        std::string m_refreshPayload;
+
+        void SetUp() override
+        {
+            CommandRunnerTests::SetUp();
+
+            m_defaultPersistedCacheFile = CommandRunner::m_persistedCacheFile;
+            CommandRunner::m_persistedCacheFile = "~commandrunner_journal";
+            remove(CommandRunner::m_persistedCacheFile);
+
+            m_journalId = Id();
+            m_desiredPayload = Command::Arguments::Serialize(Command::Arguments(m_journalId, "echo 'hello world'", Command::Action::RunCommand, 0, false));
+            m_refreshPayload = Command::Arguments::Serialize(Command::Arguments(m_journalId, "", Command::Action::RefreshCommandStatus, 0, false));
+        }
+
+        void TearDown() override
+        {
+            remove(CommandRunner::m_persistedCacheFile);
+            CommandRunner::m_persistedCacheFile = m_defaultPersistedCacheFile;
+
+            CommandRunnerTests::TearDown();
+        }
+
+        // Sets the payload on a new CommandRunner that loads the journal and expects the status it then reports
+        void ExpectReportedStatus(const std::string& payload, const Command::Status& status)
+        {
+            MMI_JSON_STRING reportedPayload = nullptr;
+            int payloadSizeBytes = 0;
+
+            CommandRunner commandRunner(m_clientName, 0, true);
+            EXPECT_EQ(MMI_OK, commandRunner.Set(m_component, m_desiredObject, (MMI_JSON_STRING)(payload.c_str()), payload.size()));
+            EXPECT_EQ(MMI_OK, commandRunner.Get(m_component, m_reportedObject, &reportedPayload, &payloadSizeBytes));
+            EXPECT_TRUE(IsJsonEq(Command::Status::Serialize(status), std::string(reportedPayload, payloadSizeBytes)));
+        }
+    };
+
+    const char CommandRunnerJournalTests::m_clientName[] = "CommandRunner_Journal_Test_Client";
+
+    TEST_F(CommandRunnerJournalTests, PersistedCommandStatusJournal)
+    {
+        {
+            CommandRunner commandRunner(m_clientName, 0, true);
+            EXPECT_EQ(MMI_OK, commandRunner.Set(m_component, m_desiredObject, (MMI_JSON_STRING)(m_desiredPayload.c_str()), m_desiredPayload.size()));
+            commandRunner.WaitForCommands();
+        }
+
+        // A record torn while being appended is skipped when the journal is read back
+        std::ofstream journal(CommandRunner::m_persistedCacheFile, std::ios::app);
+        journal << "0badc0de {\"client\":\"" << m_clientName << "\",\"sta";
+        journal.close();
+
+        ExpectReportedStatus(m_refreshPayload, Command::Status(m_journalId, 0, "", Command::State::Succeeded));
+    }
+
+    TEST_F(CommandRunnerJournalTests, PersistedCommandStatusAfterTornRecord)
+    {
+        std::string tornRecord = std::string("0badc0de {\"client\":\"") + m_clientName + "\",\"sta";
+        std::string line;
+        int records = 0;
+
+        {
+            CommandRunner commandRunner(m_clientName, 0, true);
+
+            // A record torn after the journal was loaded, the next record is appended on a line of its own
+            std::ofstream journal(CommandRunner::m_persistedCacheFile, std::ios::app);
+            journal << tornRecord;
+            journal.close();
+
+            EXPECT_EQ(MMI_OK, commandRunner.Set(m_component, m_desiredObject, (MMI_JSON_STRING)(m_desiredPayload.c_str()), m_desiredPayload.size()));
+            commandRunner.WaitForCommands();
+        }
+
+        std::ifstream journal(CommandRunner::m_persistedCacheFile);
+        EXPECT_TRUE(std::getline(journal, line));
+        EXPECT_EQ(tornRecord, line);
+        while (std::getline(journal, line))
+        {
+            records++;
+        }
+        journal.close();
+        EXPECT_LT(0, records);
+
+        ExpectReportedStatus(m_refreshPayload, Command::Status(m_journalId, 0, "", Command::State::Succeeded));
+    }
+
+    TEST_F(CommandRunnerJournalTests, PersistedCommandStatusFromPreviousCacheFormat)
+    {
+        std::string refreshPayload = Command::Arguments::Serialize(Command::Arguments("previous", "", Command::Action::RefreshCommandStatus, 0, false));
+
+        std::ofstream cache(CommandRunner::m_persistedCacheFile);
+        cache << "{\"" << m_clientName << "\": [{\"commandId\": \"previous\", \"resultCode\": 1, \"currentState\": 3}]}";
+        cache.close();
+
+        // Read from the previous format the first time, then from the journal it was converted to
+        for (int i = 0; i < 2; i++)
+        {
+            ExpectReportedStatus(refreshPayload, Command::Status("previous", 1, "", Command::State::Failed));
+        }
+    }
+
     TEST_F(CommandRunnerTests, ExecuteCommand)
     {
         EXPECT_EQ(0, m_command->Execute(0));
@@ -367,6 +696,22 @@ namespace Tests
         EXPECT_EQ(ECANCELED, m_command->Execute(0));
     }
 
+    TEST_F(CommandRunnerTests, CancelRunningCommand)
+    {
+        Command command(Id(), "sleep 10 & sleep 10; wait", 0, false);
+        int exitCode = 0;
+
+        std::thread worker([&command, &exitCode]() { exitCode = command.Execute(0); });
+        EXPECT_TRUE(WaitUntil([&command]() { return Command::State::Running == command.GetStatus().m_state; }));
+        EXPECT_EQ(0, command.Cancel());
+        worker.join();
+
+        // The whole process group is killed, the command ends as canceled rather than with the exit code of the shell
+        EXPECT_EQ(ECANCELED, exitCode);
+        EXPECT_EQ(ECANCELED, command.GetStatus().m_exitCode);
+        EXPECT_EQ(Command::State::Canceled, command.GetStatus().m_state);
+    }
+
     TEST_F(CommandRunnerTests, CommandStatus)
     {
         Command::Status defaultStatus = m_command->GetStatus();
@@ -488,5 +833,18 @@ namespace Tests
         EXPECT_EQ(Command::State::Succeeded, status.m_state);
     }
 
+    TEST_F(CommandRunnerTests, DeserializeOrderingGroup)
+    {
+        Command::Arguments arguments("id", "echo 'hello world'", Command::Action::RunCommand, 0, false, "group");
+
+        rapidjson::Document document;
+        document.Parse(Command::Arguments::Serialize(arguments).c_str());
+
+        Command::Arguments deserialized = Command::Arguments::Deserialize(document);
+
+        EXPECT_EQ("id", deserialized.m_id);
+        EXPECT_EQ("group", deserialized.m_orderingGroup);
+    }
+
 
 } // namespace Tests
\ No newline at end of file
@@ -46,6 +46,8 @@ const char g_targetDrop[] = "DROP";
 const char g_chainInput[] = "INPUT";
 const char g_chainOutput[] = "OUTPUT";
 
+const char g_rejectWithDefault[] = "icmp-port-unreachable";
+
 OSCONFIG_LOG_HANDLE FirewallLog::m_logHandle = nullptr;
 
 int FirewallModuleBase::GetInfo(const char* clientName, MMI_JSON_STRING* payload, int* payloadSizeBytes)
@@ -431,7 +433,7 @@ std::string IpTablesRule::Specification() const
 
     ruleSpec << " ";
 
-    if (m_protocol != "any")
+    if (!m_protocol.ToString().empty() && (m_protocol != "any"))
     {
         ruleSpec << "-p " << m_protocol << " ";
     }
@@ -478,6 +480,137 @@ std::string IpTablesRule::Specification() const
     return ruleSpec.str();
 }
 
+static bool GetSavedAddress(const std::string& address, std::string& savedAddress)
+{
+    // iptables -S prints IPv4 addresses as masked network/prefix pairs and omits 0.0.0.0/0
+    std::string host = address;
+    std::string prefixString;
+    int prefix = 32;
+    size_t separator = address.find('/');
+    struct in_addr networkAddress = {0};
+    char buffer[INET_ADDRSTRLEN] = {0};
+
+    savedAddress.clear();
+
+    if (address.empty())
+    {
+        return true;
+    }
+
+    if (std::string::npos != separator)
+    {
+        host = address.substr(0, separator);
+        prefixString = address.substr(separator + 1);
+
+        if (prefixString.empty() || (prefixString.size() > 2) || (std::string::npos != prefixString.find_first_not_of("0123456789")))
+        {
+            return false;
+        }
+
+        prefix = std::stoi(prefixString);
+    }
+
+    if ((prefix > 32) || (1 != inet_pton(AF_INET, host.c_str(), &networkAddress)))
+    {
+        return false;
+    }
+
+    networkAddress.s_addr &= (0 == prefix) ? 0 : htonl(0xFFFFFFFFu << (32 - prefix));
+
+    if (nullptr == inet_ntop(AF_INET, &networkAddress, buffer, sizeof(buffer)))
+    {
+        return false;
+    }
+
+    if (prefix > 0)
+    {
+        savedAddress = std::string(buffer) + "/" + std::to_string(prefix);
+    }
+
+    return true;
+}
+
+std::string IpTablesRule::SavedSpecification() const
+{
+    std::stringstream ruleSpec;
+    std::string source;
+    std::string destination;
+
+    // Host names, IPv6 addresses and option combinations that iptables rejects have no saved form,
+    // the caller then has to let iptables match the rule itself
+    if (!GetSavedAddress(m_sourceAddress, source) || !GetSavedAddress(m_destinationAddress, destination))
+    {
+        return "";
+    }
+
+    if (m_direction == "in")
+    {
+        ruleSpec << "-A " << g_chainInput;
+    }
+    else if (m_direction == "out")
+    {
+        ruleSpec << "-A " << g_chainOutput;
+    }
+    else
+    {
+        return "";
+    }
+
+    if (!source.empty())
+    {
+        ruleSpec << " -s " << source;
+    }
+
+    if (!destination.empty())
+    {
+        ruleSpec << " -d " << destination;
+    }
+
+    if (!m_protocol.ToString().empty() && (m_protocol != "any"))
+    {
+        ruleSpec << " -p " << m_protocol;
+    }
+
+    if (!m_sourcePort.empty() || !m_destinationPort.empty())
+    {
+        if ((m_protocol != "tcp") && (m_protocol != "udp"))
+        {
+            return "";
+        }
+
+        ruleSpec << " -m " << m_protocol;
+
+        if (!m_sourcePort.empty())
+        {
+            ruleSpec << " --sport " << m_sourcePort;
+        }
+
+        if (!m_destinationPort.empty())
+        {
+            ruleSpec << " --dport " << m_destinationPort;
+        }
+    }
+
+    if (m_action == "accept")
+    {
+        ruleSpec << " -j " << g_targetAccept;
+    }
+    else if (m_action == "drop")
+    {
+        ruleSpec << " -j " << g_targetDrop;
+    }
+    else if (m_action == "reject")
+    {
+        ruleSpec << " -j " << g_targetReject << " --reject-with " << g_rejectWithDefault;
+    }
+    else
+    {
+        return "";
+    }
+
+    return ruleSpec.str();
+}
+
 IpTables::State IpTables::Detect() const
 {
     const char* command = "iptables -S | grep -E \"^-A (INPUT|OUTPUT)\" | wc -l";
@@ -514,6 +647,7 @@ std::string IpTables::Fingerprint() const
     std::string hash;
     char* textResult = nullptr;
 
+    // Hashes the raw standard output, the same as iptables -S | sha256sum
     if (nullptr != (textResult = HashCommand(command, FirewallLog::Get())))
     {
         hash = textResult;
@@ -607,6 +741,24 @@ int IpTables::SetDefaultPolicies(const std::vector<IpTablesPolicy> policies)
 }
 
 bool IpTables::Exists(const IpTables::Rule& rule) const
+{
+    bool exists = false;
+    std::string savedSpecification = (m_ruleCountsValid && m_savedSpecificationsVerified) ? rule.SavedSpecification() : "";
+
+    if (!savedSpecification.empty())
+    {
+        auto ruleCount = m_ruleCounts.find(savedSpecification);
+        exists = (ruleCount != m_ruleCounts.end()) && (ruleCount->second > 0);
+    }
+    else
+    {
+        exists = Check(rule);
+    }
+
+    return exists;
+}
+
+bool IpTables::Check(const IpTables::Rule& rule) const
 {
     bool exists = false;
     char* textResult = nullptr;
@@ -641,6 +793,10 @@ int IpTables::Add(const IpTables::Rule& rule, std::string& error)
 
         error = textResult;
     }
+    else
+    {
+        UpdateRuleCount(rule, 1);
+    }
 
     FREE_MEMORY(textResult);
 
@@ -666,18 +822,253 @@ int IpTables::Remove(const IpTables::Rule& rule, std::string& error)
 
         error = textResult;
     }
+    else
+    {
+        UpdateRuleCount(rule, -1);
+    }
 
     FREE_MEMORY(textResult);
 
     return status;
 }
 
-int IpTables::SetRules(const std::vector<IpTables::Rule>& rules)
+bool IpTables::GetRules(std::string& rules) const
+{
+    const char* command = "iptables -S";
+
+    bool result = false;
+    char* textResult = nullptr;
+
+    if (0 == ExecuteCommand(nullptr, command, false, false, 0, 0, &textResult, nullptr, FirewallLog::Get()))
+    {
+        rules = textResult ? textResult : "";
+        result = true;
+    }
+    else
+    {
+        OsConfigLogError(FirewallLog::Get(), "Failed to read the current rules: %s", textResult);
+    }
+
+    FREE_MEMORY(textResult);
+
+    return result;
+}
+
+bool IpTables::GetRuleCounts(std::map<std::string, int>& ruleCounts) const
+{
+    const std::string inputPrefix = std::string("-A ") + g_chainInput + " ";
+    const std::string outputPrefix = std::string("-A ") + g_chainOutput + " ";
+
+    std::string rules;
+    std::string line;
+
+    ruleCounts.clear();
+
+    if (!GetRules(rules))
+    {
+        return false;
+    }
+
+    std::stringstream stream(rules);
+    while (std::getline(stream, line))
+    {
+        if ((0 == line.compare(0, inputPrefix.size(), inputPrefix)) || (0 == line.compare(0, outputPrefix.size(), outputPrefix)))
+        {
+            ruleCounts[line]++;
+        }
+    }
+
+    return true;
+}
+
+void IpTables::UpdateRuleCount(const IpTables::Rule& rule, int change)
+{
+    std::string savedSpecification = rule.SavedSpecification();
+
+    if (savedSpecification.empty())
+    {
+        // The rule may match an entry in another form, so the captured rules can no longer be trusted
+        m_ruleCountsValid = false;
+    }
+    else if (m_ruleCountsValid)
+    {
+        int& count = m_ruleCounts[savedSpecification];
+        count = std::max(0, count + change);
+    }
+}
+
+int IpTables::Restore(const std::string& input, std::string& error)
 {
     int status = 0;
+    char* textResult = nullptr;
+
+    // The batch goes to iptables-restore on stdin, --noflush keeps every rule that is not explicitly inserted or deleted
+    if (0 != (status = ExecuteCommandWithInput("iptables-restore --noflush", input.c_str(), input.size(), true, 0, &textResult, FirewallLog::Get())))
+    {
+        error = textResult ? textResult : "";
+    }
+
+    FREE_MEMORY(textResult);
+
+    return status;
+}
+
+int IpTables::GetFailedRuleIndex(const std::string& error, const std::vector<int>& lineIndexes)
+{
+    std::smatch match;
+    int index = -1;
+
+    if (std::regex_search(error, match, std::regex("line:? ([0-9]+)")))
+    {
+        size_t line = std::stoul(match[1].str());
+        if ((line >= 1) && (line <= lineIndexes.size()))
+        {
+            index = lineIndexes[line - 1];
+        }
+    }
+
+    return index;
+}
+
+bool IpTables::SetRulesInBatch(const std::vector<IpTables::Rule>& rules, std::vector<std::string>& errors, int& status)
+{
+    std::map<std::string, int> ruleCounts;
+    std::map<std::string, int> appliedRuleCounts;
+    std::set<std::string> savedSpecifications;
+    std::vector<std::string> batchErrors;
+    std::vector<int> lineIndexes;
+    std::stringstream input;
+    std::string error;
+    int batchStatus = 0;
+    int index = rules.size() - 1;
+
+    if (m_batchDisabled || !m_ruleCountsValid)
+    {
+        return false;
+    }
+
+    ruleCounts = m_ruleCounts;
+
+    // Input line 1 is the table header, every following line maps back to the index of its desired rule
+    input << "*filter\n";
+    lineIndexes.push_back(-1);
+
+    // Same traversal as applying the rules one by one, so that the resulting
+    // rule order in the iptables chain is the same as the desired order
+    for (auto it = rules.rbegin(); it != rules.rend(); ++it, --index)
+    {
+        const Rule& rule = *it;
+
+        if (rule.HasParseError())
+        {
+            for (const std::string& parseError : rule.GetParseError())
+            {
+                batchErrors.push_back("[" + std::to_string(index) + "] " + parseError);
+            }
+            continue;
+        }
+
+        std::string specification = rule.Specification();
+        std::string savedSpecification = rule.SavedSpecification();
+
+        if (savedSpecification.empty() || (std::string::npos != specification.find_first_of("\r\n")))
+        {
+            OsConfigLogInfo(FirewallLog::Get(), "Rule %d cannot be matched against iptables -S output, applying rules one by one", index);
+            return false;
+        }
+
+        DesiredState state = rule.GetDesiredState();
+        int& count = ruleCounts[savedSpecification];
+        savedSpecifications.insert(savedSpecification);
+
+        // Until a batch showed iptables -S listing rules in their derived saved form, a rule missing from the
+        // snapshot may be there in another form, iptables -C tells before the batch inserts it a second time
+        if ((0 == count) && !m_savedSpecificationsVerified && Check(rule))
+        {
+            OsConfigLogError(FirewallLog::Get(), "iptables -S output does not match rule '%s', applying rules one by one", savedSpecification.c_str());
+            m_batchDisabled = true;
+            m_ruleCountsValid = false;
+            return false;
+        }
+
+        if (state == "present")
+        {
+            if (0 == count)
+            {
+                input << "-I " << specification << "\n";
+                lineIndexes.push_back(index);
+                count = 1;
+            }
+        }
+        else if (state == "absent")
+        {
+            for (; count > 0; --count)
+            {
+                input << "-D " << specification << "\n";
+                lineIndexes.push_back(index);
+            }
+        }
+        else
+        {
+            OsConfigLogError(FirewallLog::Get(), "Invalid desired rule state (%d): %s", index, rule.GetDesiredState().ToString().c_str());
+            batchStatus = EINVAL;
+        }
+    }
+
+    if (lineIndexes.size() > 1)
+    {
+        input << "COMMIT\n";
+
+        if (0 != Restore(input.str(), error))
+        {
+            // iptables-restore reports the first line it failed on, nothing was applied
+            int failedIndex = GetFailedRuleIndex(error, lineIndexes);
+            if (failedIndex >= 0)
+            {
+                OsConfigLogError(FirewallLog::Get(), "Failed to apply rule (%d) in batch: %s", failedIndex, error.c_str());
+            }
+
+            OsConfigLogError(FirewallLog::Get(), "iptables-restore failed, applying rules one by one: %s", error.c_str());
+            return false;
+        }
+
+        // Verify that the applied rules show up in their derived saved form, otherwise
+        // a later batch could insert duplicates of rules it does not recognize
+        if (!(m_ruleCountsValid = GetRuleCounts(appliedRuleCounts)))
+        {
+            m_ruleCounts.clear();
+        }
+        else
+        {
+            for (const std::string& savedSpecification : savedSpecifications)
+            {
+                if ((ruleCounts[savedSpecification] > 0) != (appliedRuleCounts[savedSpecification] > 0))
+                {
+                    OsConfigLogError(FirewallLog::Get(), "iptables -S output does not match rule '%s', applying rules one by one", savedSpecification.c_str());
+                    m_batchDisabled = true;
+                    m_ruleCountsValid = false;
+                    return false;
+                }
+            }
+
+            m_savedSpecificationsVerified = true;
+            m_ruleCounts = appliedRuleCounts;
+        }
+    }
+
+    errors.insert(errors.end(), batchErrors.begin(), batchErrors.end());
+    if (0 != batchStatus)
+    {
+        status = batchStatus;
+    }
+
+    return true;
+}
+
+void IpTables::SetRulesOneByOne(const std::vector<IpTables::Rule>& rules, std::vector<std::string>& errors, int& status)
+{
     int index = rules.size() - 1;
     std::string error;
-    std::vector<std::string> errors;
 
     // Iterate through the rules in reverse order to ensure that the resulting
     // rule order in the iptables chain is the same as the desired order
@@ -712,6 +1103,7 @@ int IpTables::SetRules(const std::vector<IpTables::Rule>& rules)
                     if (0 != Remove(rule, error))
                     {
                         errors.push_back("Failed to remove rule (" + std::to_string(index) + "): " + error);
+                        break;
                     }
                 }
             }
@@ -722,6 +1114,24 @@ int IpTables::SetRules(const std::vector<IpTables::Rule>& rules)
             }
         }
     }
+}
+
+int IpTables::SetRules(const std::vector<IpTables::Rule>& rules)
+{
+    int status = 0;
+    std::vector<std::string> errors;
+
+    // Apply the difference against one iptables -S snapshot in a single iptables-restore
+    // transaction, falling back to one iptables call per rule for per-rule error reporting
+    m_ruleCountsValid = !m_batchDisabled && GetRuleCounts(m_ruleCounts);
+
+    if (!SetRulesInBatch(rules, errors, status))
+    {
+        SetRulesOneByOne(rules, errors, status);
+    }
+
+    m_ruleCounts.clear();
+    m_ruleCountsValid = false;
 
     if (errors.size() > 0)
     {
@@ -3,7 +3,9 @@
 
 #pragma once
 
+#include <arpa/inet.h>
 #include <cstdarg>
+#include <map>
 #include <memory>
 #include <ostream>
 #include <rapidjson/document.h>
@@ -12,6 +14,7 @@
 #include <set>
 #include <sstream>
 #include <string>
+#include <unistd.h>
 #include <vector>
 
 #include <CommonUtils.h>
@@ -204,6 +207,9 @@ public:
     IpTablesRule() = default;
 
     virtual std::string Specification() const override;
+
+    // The rule as iptables -S and iptables-save print it, or empty when that cannot be derived without iptables itself
+    std::string SavedSpecification() const;
 };
 
 class IpTablesPolicy : public GenericPolicy
@@ -271,10 +277,34 @@ public:
     int SetRules(const std::vector<Rule>& rules) override;
     int SetDefaultPolicies(const std::vector<Policy> policies) override;
 
+    // The index of the rule on the input line iptables-restore reports it failed on, lineIndexes maps input lines (from 1) to rules, -1 when there is none
+    static int GetFailedRuleIndex(const std::string& error, const std::vector<int>& lineIndexes);
+
+protected:
+    // Each runs one iptables command
+    virtual int Add(const Rule& rule, std::string& error);
+    virtual int Remove(const Rule& rule, std::string& error);
+    virtual bool Check(const Rule& rule) const;
+    virtual bool GetRules(std::string& rules) const;
+    virtual int Restore(const std::string& input, std::string& error);
+
 private:
-    int Add(const Rule& rule, std::string& error);
-    int Remove(const Rule& rule, std::string& error);
     bool Exists(const Rule& rule) const;
+
+    bool SetRulesInBatch(const std::vector<Rule>& rules, std::vector<std::string>& errors, int& status);
+    void SetRulesOneByOne(const std::vector<Rule>& rules, std::vector<std::string>& errors, int& status);
+    bool GetRuleCounts(std::map<std::string, int>& ruleCounts) const;
+    void UpdateRuleCount(const Rule& rule, int change);
+
+    // Set when iptables -S output did not match the derived rule specifications, rules are then applied one by one
+    bool m_batchDisabled = false;
+
+    // Set once a batch was applied and iptables -S listed its rules in the derived saved form
+    bool m_savedSpecificationsVerified = false;
+
+    // Rules captured at the start of SetRules, while valid and verified Exists looks rules up here instead of running iptables -C
+    std::map<std::string, int> m_ruleCounts;
+    bool m_ruleCountsValid = false;
 };
 
 class FirewallModuleBase
@@ -123,6 +123,58 @@ namespace tests
         return errors.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
     }
 
+    // Runs no iptables commands, iptables -S prints the given rules and iptables -C finds the given specifications
+    class MockIpTables : public IpTables
+    {
+    public:
+        std::string savedRules;
+        std::string savedRulesAfterRestore;
+        std::set<std::string> existingRules;
+        std::string restoreError;
+        std::vector<std::string> restoreInputs;
+        std::vector<std::string> addedRules;
+        mutable int checkCount = 0;
+
+    protected:
+        int Add(const Rule& rule, std::string&) override;
+        int Remove(const Rule& rule, std::string&) override;
+        bool Check(const Rule& rule) const override;
+        bool GetRules(std::string& rules) const override;
+        int Restore(const std::string& input, std::string& error) override;
+    };
+
+    int MockIpTables::Add(const Rule& rule, std::string&)
+    {
+        addedRules.push_back(rule.Specification());
+        existingRules.insert(rule.Specification());
+        return 0;
+    }
+
+    int MockIpTables::Remove(const Rule& rule, std::string&)
+    {
+        existingRules.erase(rule.Specification());
+        return 0;
+    }
+
+    bool MockIpTables::Check(const Rule& rule) const
+    {
+        checkCount++;
+        return existingRules.find(rule.Specification()) != existingRules.end();
+    }
+
+    bool MockIpTables::GetRules(std::string& rules) const
+    {
+        rules = restoreInputs.empty() ? savedRules : savedRulesAfterRestore;
+        return true;
+    }
+
+    int MockIpTables::Restore(const std::string& input, std::string& error)
+    {
+        restoreInputs.push_back(input);
+        error = restoreError;
+        return restoreError.empty() ? 0 : EXIT_FAILURE;
+    }
+
     class FirewallTests : public ::testing::Test
     {
     protected:
@@ -431,6 +483,115 @@ namespace tests
         }
     }
 
+    TEST_F(FirewallTests, SavedRuleSpecification)
+    {
+        std::vector<std::pair<std::string, std::string>> rules = {
+            { Rule("present", "accept", "in"), "-A INPUT -j ACCEPT" },
+            { Rule("present", "drop", "out", "icmp"), "-A OUTPUT -p icmp -j DROP" },
+            { Rule("present", "reject", "in", "udp"), "-A INPUT -p udp -j REJECT --reject-with icmp-port-unreachable" },
+            { "{\"desiredState\": \"present\", \"action\": \"accept\", \"direction\": \"in\", \"protocol\": \"tcp\", \"sourceAddress\": \"10.0.0.1\", \"destinationAddress\": \"10.1.2.3/16\", \"sourcePort\": 1024, \"destinationPort\": 22}",
+                "-A INPUT -s 10.0.0.1/32 -d 10.1.0.0/16 -p tcp -m tcp --sport 1024 --dport 22 -j ACCEPT" },
+            { "{\"desiredState\": \"absent\", \"action\": \"drop\", \"direction\": \"out\", \"sourceAddress\": \"0.0.0.0/0\"}", "-A OUTPUT -j DROP" },
+            { "{\"desiredState\": \"present\", \"action\": \"accept\", \"direction\": \"in\", \"sourceAddress\": \"example.com\"}", "" },
+            { "{\"desiredState\": \"present\", \"action\": \"accept\", \"direction\": \"in\", \"sourceAddress\": \"10.0.0.1/33\"}", "" },
+            { "{\"desiredState\": \"present\", \"action\": \"accept\", \"direction\": \"in\", \"destinationPort\": 22}", "" },
+        };
+
+        for (auto rule : rules)
+        {
+            rapidjson::Document document;
+            document.Parse(rule.first.c_str());
+
+            IpTablesRule ipTablesRule;
+            ipTablesRule.Parse(document);
+
+            EXPECT_FALSE(ipTablesRule.HasParseError()) << rule.first;
+            EXPECT_EQ(rule.second, ipTablesRule.SavedSpecification()) << rule.first;
+        }
+    }
+
+    std::vector<IpTablesRule> ParseRules(const std::vector<std::string>& rulesJson)
+    {
+        std::vector<IpTablesRule> rules;
+
+        for (auto& ruleJson : rulesJson)
+        {
+            rapidjson::Document document;
+            document.Parse(ruleJson.c_str());
+
+            IpTablesRule rule;
+            rule.Parse(document);
+            rules.push_back(rule);
+        }
+
+        return rules;
+    }
+
+    TEST_F(FirewallTests, SetRulesInBatch)
+    {
+        MockIpTables ipTables;
+        std::vector<IpTablesRule> rules = ParseRules({
+            Rule("present", "accept", "in"),
+            Rule("present", "drop", "out", "icmp"),
+            "{\"desiredState\": \"absent\", \"action\": \"drop\", \"direction\": \"out\", \"sourceAddress\": \"0.0.0.0/0\"}",
+        });
+
+        ipTables.savedRules = "-P INPUT ACCEPT\n-A INPUT -j ACCEPT\n-A OUTPUT -j DROP\n-A OUTPUT -j DROP\n";
+        ipTables.savedRulesAfterRestore = "-P INPUT ACCEPT\n-A OUTPUT -p icmp -j DROP\n-A INPUT -j ACCEPT\n";
+
+        // Only the difference is applied, in reverse order as one by one, the missing rule is checked first as nothing was verified yet
+        EXPECT_EQ(0, ipTables.SetRules(rules));
+        ASSERT_EQ(1, ipTables.restoreInputs.size());
+        EXPECT_EQ("*filter\n-D " + rules[2].Specification() + "\n-D " + rules[2].Specification() + "\n-I " + rules[1].Specification() + "\nCOMMIT\n", ipTables.restoreInputs[0]);
+        EXPECT_EQ(1, ipTables.checkCount);
+        EXPECT_TRUE(ipTables.addedRules.empty());
+
+        // Verified by the first batch, nothing left to apply and nothing to check with iptables -C
+        EXPECT_EQ(0, ipTables.SetRules(rules));
+        EXPECT_EQ(1, ipTables.restoreInputs.size());
+        EXPECT_EQ(1, ipTables.checkCount);
+    }
+
+    TEST_F(FirewallTests, SetRulesInBatchUnmatchedRule)
+    {
+        MockIpTables ipTables;
+        std::vector<IpTablesRule> rules = ParseRules({ Rule("present", "accept", "in") });
+
+        // The rule exists but iptables -S does not list it in the derived form, so it is not inserted again
+        ipTables.savedRules = "-P INPUT ACCEPT\n-A INPUT -m comment --comment other -j ACCEPT\n";
+        ipTables.existingRules.insert(rules[0].Specification());
+
+        EXPECT_EQ(0, ipTables.SetRules(rules));
+        EXPECT_TRUE(ipTables.restoreInputs.empty());
+        EXPECT_TRUE(ipTables.addedRules.empty());
+    }
+
+    TEST_F(FirewallTests, SetRulesInBatchWithError)
+    {
+        MockIpTables ipTables;
+        std::vector<IpTablesRule> rules = ParseRules({ Rule("present", "accept", "in"), Rule("present", "drop", "out", "icmp") });
+
+        ipTables.savedRules = "-P INPUT ACCEPT\n";
+        ipTables.restoreError = "iptables-restore: line 2 failed";
+
+        // Nothing was applied by the failed batch, so the rules are applied one by one
+        EXPECT_EQ(0, ipTables.SetRules(rules));
+        EXPECT_EQ(1, ipTables.restoreInputs.size());
+        EXPECT_EQ(std::vector<std::string>({ rules[1].Specification(), rules[0].Specification() }), ipTables.addedRules);
+    }
+
+    TEST_F(FirewallTests, GetFailedRuleIndex)
+    {
+        // Line 1 is the table header, then one line per rule in reverse order
+        std::vector<int> lineIndexes = { -1, 1, 0, 0 };
+
+        EXPECT_EQ(1, IpTables::GetFailedRuleIndex("iptables-restore: line 2 failed", lineIndexes));
+        EXPECT_EQ(0, IpTables::GetFailedRuleIndex("iptables-restore v1.8.7 (nf_tables): unknown option \"--foo\"\nError occurred at line: 4\n", lineIndexes));
+        EXPECT_EQ(-1, IpTables::GetFailedRuleIndex("iptables-restore: line 1 failed", lineIndexes));
+        EXPECT_EQ(-1, IpTables::GetFailedRuleIndex("iptables-restore: line 5 failed", lineIndexes));
+        EXPECT_EQ(-1, IpTables::GetFailedRuleIndex("iptables-restore: unable to initialize table 'filter'", lineIndexes));
+    }
+
     TEST_F(FirewallTests, ParsePolicyWithError)
     {
         std::vector<std::string> invalidPolicies = {
@@ -11,6 +11,16 @@
 #include <sstream>
 #include <unordered_map>
 #include <stdio.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <linux/if.h>
+#include <linux/if_arp.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <fstream>
+#include <functional>
 #include <Networking.h>
 #include <CommonUtils.h>
 
@@ -33,6 +43,11 @@ const char* g_getDnsServers = "systemd-resolve --status";
 
 const char* g_systemdResolvedServiceName = "systemd-resolved.service";
 
+const char* g_sysClassNet = "/sys/class/net/";
+const char* g_devTypePrefix = "DEVTYPE=";
+const char* g_resolvConfFiles[] = {"/run/systemd/resolve/resolv.conf", "/etc/resolv.conf"};
+const unsigned int g_netlinkBufferSize = 32768;
+
 const char* g_macAddressesPrefix = "link/";
 const char* g_ipAddressesPrefix = "inet";
 const char* g_subnetMasksPrefix = "inet";
@@ -102,10 +117,24 @@ NetworkingObject::NetworkingObject(unsigned int maxPayloadSizeBytes)
 {
     m_maxPayloadSizeBytes = maxPayloadSizeBytes;
     m_networkManagementService = NetworkManagementService::Unknown;
+    m_useNetlink = true;
 }
 
 NetworkingObject::~NetworkingObject() {}
 
+NetworkingObjectBase::~NetworkingObjectBase()
+{
+    if (0 <= m_netlinkEventsSocket)
+    {
+        close(m_netlinkEventsSocket);
+    }
+}
+
+unsigned long long NetworkingObjectBase::GetGeneration()
+{
+    return m_generation;
+}
+
 std::string NetworkingObject::RunCommand(const char* command)
 {
     char* textResult = nullptr;
@@ -764,12 +793,430 @@ void NetworkingObjectBase::RefreshInterfaceData()
     GenerateDnsServersMap();
 }
 
+// Sends a rtnetlink dump request and passes each message of the reply to the handler, returns false on any error
+static bool DumpNetlink(int netlinkSocket, unsigned short type, unsigned char family, unsigned int sequence, const std::function<void(struct nlmsghdr*)>& handler)
+{
+    struct
+    {
+        struct nlmsghdr header;
+        struct rtgenmsg message;
+    } request;
+    struct sockaddr_nl kernel;
+    std::vector<char> buffer(g_netlinkBufferSize);
+
+    std::memset(&request, 0, sizeof(request));
+    request.header.nlmsg_len = NLMSG_LENGTH(sizeof(struct rtgenmsg));
+    request.header.nlmsg_type = type;
+    request.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    request.header.nlmsg_seq = sequence;
+    request.message.rtgen_family = family;
+
+    std::memset(&kernel, 0, sizeof(kernel));
+    kernel.nl_family = AF_NETLINK;
+
+    if (0 > sendto(netlinkSocket, &request, request.header.nlmsg_len, 0, (struct sockaddr*)&kernel, sizeof(kernel)))
+    {
+        return false;
+    }
+
+    while (true)
+    {
+        ssize_t received = recv(netlinkSocket, buffer.data(), buffer.size(), 0);
+        if ((0 > received) && (EINTR == errno))
+        {
+            continue;
+        }
+        else if (0 >= received)
+        {
+            return false;
+        }
+
+        int remaining = (int)received;
+        for (struct nlmsghdr* message = (struct nlmsghdr*)buffer.data(); NLMSG_OK(message, (unsigned int)remaining); message = NLMSG_NEXT(message, remaining))
+        {
+            if (message->nlmsg_seq != sequence)
+            {
+                continue;
+            }
+            else if (NLMSG_DONE == message->nlmsg_type)
+            {
+                return true;
+            }
+            else if (NLMSG_ERROR == message->nlmsg_type)
+            {
+                return false;
+            }
+
+            handler(message);
+        }
+    }
+}
+
+static void GetNetlinkAttributes(struct rtattr* attribute, int length, std::vector<struct rtattr*>& attributes)
+{
+    std::fill(attributes.begin(), attributes.end(), nullptr);
+    for (; RTA_OK(attribute, length); attribute = RTA_NEXT(attribute, length))
+    {
+        if (attribute->rta_type < attributes.size())
+        {
+            attributes[attribute->rta_type] = attribute;
+        }
+    }
+}
+
+static std::string FormatHardwareAddress(struct rtattr* attribute)
+{
+    std::string address;
+    const unsigned char* bytes = (const unsigned char*)RTA_DATA(attribute);
+    char byte[3] = {0};
+
+    for (size_t i = 0; i < RTA_PAYLOAD(attribute); i++)
+    {
+        std::snprintf(byte, sizeof(byte), "%02x", bytes[i]);
+        address += (i > 0) ? (g_colon + std::string(byte)) : std::string(byte);
+    }
+
+    return address;
+}
+
+// Same names as udev and networkctl use for interfaces without a DEVTYPE
+static std::string GetLinkTypeName(unsigned short type)
+{
+    switch (type)
+    {
+        case ARPHRD_ETHER:
+            return "ether";
+        case ARPHRD_LOOPBACK:
+            return "loopback";
+        case ARPHRD_NONE:
+            return "none";
+        case ARPHRD_PPP:
+            return "ppp";
+        case ARPHRD_TUNNEL:
+            return "tunnel";
+        case ARPHRD_TUNNEL6:
+            return "tunnel6";
+        case ARPHRD_SIT:
+            return "sit";
+        case ARPHRD_IPGRE:
+            return "gre";
+        case ARPHRD_INFINIBAND:
+            return "infiniband";
+        case ARPHRD_CAN:
+            return "can";
+        default:
+            return std::to_string(type);
+    }
+}
+
+// Reported interface types keep the names nmcli uses for GENERAL.TYPE, kernel names without an nmcli equivalent are kept as is
+static std::string GetNmcliTypeName(const std::string& kernelType)
+{
+    static const std::map<std::string, std::string> nmcliTypes = {{"ether", "ethernet"}, {"wlan", "wifi"}, {"none", "tun"},
+        {"tunnel", "ip-tunnel"}, {"tunnel6", "ip-tunnel"}, {"sit", "ip-tunnel"}, {"gre", "ip-tunnel"}};
+
+    auto nmcliType = nmcliTypes.find(kernelType);
+    return (nmcliType != nmcliTypes.end()) ? nmcliType->second : kernelType;
+}
+
+static std::string GetInterfaceTypeFromSysfs(const std::string& interfaceName, unsigned short linkType)
+{
+    std::ifstream uevent(g_sysClassNet + interfaceName + "/uevent");
+    std::string line;
+
+    while (std::getline(uevent, line))
+    {
+        if (0 == line.compare(0, std::strlen(g_devTypePrefix), g_devTypePrefix))
+        {
+            return GetNmcliTypeName(line.substr(std::strlen(g_devTypePrefix)));
+        }
+    }
+
+    return GetNmcliTypeName(GetLinkTypeName(linkType));
+}
+
+static std::string FormatLinkFlags(unsigned int flags)
+{
+    const std::vector<std::pair<unsigned int, const char*>> names = {{IFF_LOOPBACK, "LOOPBACK"}, {IFF_BROADCAST, "BROADCAST"}, {IFF_POINTOPOINT, "POINTOPOINT"},
+        {IFF_MULTICAST, "MULTICAST"}, {IFF_NOARP, "NOARP"}, {IFF_UP, "UP"}, {IFF_LOWER_UP, "LOWER_UP"}};
+    std::string text = ((flags & IFF_UP) && !(flags & IFF_RUNNING)) ? "NO-CARRIER" : g_emptyString;
+
+    for (size_t i = 0; i < names.size(); i++)
+    {
+        if (flags & names[i].first)
+        {
+            text += (text.empty() ? g_emptyString : g_comma) + std::string(names[i].second);
+        }
+    }
+
+    return "<" + text + ">";
+}
+
+static std::string FormatAddressScope(unsigned char scope)
+{
+    switch (scope)
+    {
+        case RT_SCOPE_UNIVERSE:
+            return "global";
+        case RT_SCOPE_SITE:
+            return "site";
+        case RT_SCOPE_LINK:
+            return "link";
+        case RT_SCOPE_HOST:
+            return "host";
+        default:
+            return std::to_string(scope);
+    }
+}
+
+bool NetworkingObjectBase::RefreshInterfaceDataFromNetlink()
+{
+    const char* operationalStates[] = {"UNKNOWN", "NOTPRESENT", "DOWN", "LOWERLAYERDOWN", "TESTING", "DORMANT", "UP"};
+    std::map<int, std::string> interfaceNames;
+    std::map<int, unsigned short> linkTypes;
+    std::vector<struct rtattr*> attributes;
+    unsigned int sequence = 0;
+    bool result = false;
+
+    int netlinkSocket = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (0 > netlinkSocket)
+    {
+        if (IsFullLoggingEnabled())
+        {
+            OsConfigLogError(NetworkingLog::Get(), "Cannot open a rtnetlink socket (%d), using commands", errno);
+        }
+        return false;
+    }
+
+    this->m_interfaceNames.clear();
+    this->m_interfaceTypesMap.clear();
+    this->m_ipSettingsMap.clear();
+    this->m_defaultGatewaysMap.clear();
+
+    // The settings are kept in the same form as 'ip addr' prints them, so both backends share the parsing
+    result = DumpNetlink(netlinkSocket, RTM_GETLINK, AF_UNSPEC, ++sequence, [&](struct nlmsghdr* message)
+    {
+        struct ifinfomsg* link = (struct ifinfomsg*)NLMSG_DATA(message);
+        if ((RTM_NEWLINK != message->nlmsg_type) || (message->nlmsg_len < NLMSG_LENGTH(sizeof(*link))))
+        {
+            return;
+        }
+
+        attributes.assign(IFLA_MAX + 1, nullptr);
+        GetNetlinkAttributes(IFLA_RTA(link), IFLA_PAYLOAD(message), attributes);
+        if (nullptr == attributes[IFLA_IFNAME])
+        {
+            return;
+        }
+
+        std::string interfaceName((const char*)RTA_DATA(attributes[IFLA_IFNAME]));
+        unsigned char operationalState = attributes[IFLA_OPERSTATE] ? *(unsigned char*)RTA_DATA(attributes[IFLA_OPERSTATE]) : 0;
+        std::string interfaceData = FormatLinkFlags(link->ifi_flags) + " mtu " + (attributes[IFLA_MTU] ? std::to_string(*(unsigned int*)RTA_DATA(attributes[IFLA_MTU])) : "0") +
+            " state " + ((operationalState < ARRAY_SIZE(operationalStates)) ? operationalStates[operationalState] : operationalStates[0]) + "\n";
+
+        if ((nullptr != attributes[IFLA_ADDRESS]) && (RTA_PAYLOAD(attributes[IFLA_ADDRESS]) > 0))
+        {
+            interfaceData += "    link/" + GetLinkTypeName(link->ifi_type) + g_spaceString + FormatHardwareAddress(attributes[IFLA_ADDRESS]);
+            if (nullptr != attributes[IFLA_BROADCAST])
+            {
+                interfaceData += " brd " + FormatHardwareAddress(attributes[IFLA_BROADCAST]);
+            }
+            interfaceData += "\n";
+        }
+
+        interfaceNames[link->ifi_index] = interfaceName;
+        linkTypes[link->ifi_index] = link->ifi_type;
+        this->m_interfaceNames.push_back(interfaceName);
+        this->m_ipSettingsMap[interfaceName] = interfaceData;
+    });
+
+    result = result && DumpNetlink(netlinkSocket, RTM_GETADDR, AF_UNSPEC, ++sequence, [&](struct nlmsghdr* message)
+    {
+        struct ifaddrmsg* address = (struct ifaddrmsg*)NLMSG_DATA(message);
+        char text[INET6_ADDRSTRLEN] = {0};
+        if ((RTM_NEWADDR != message->nlmsg_type) || (message->nlmsg_len < NLMSG_LENGTH(sizeof(*address))) || (interfaceNames.end() == interfaceNames.find(address->ifa_index)))
+        {
+            return;
+        }
+
+        attributes.assign(IFA_MAX + 1, nullptr);
+        GetNetlinkAttributes(IFA_RTA(address), IFA_PAYLOAD(message), attributes);
+
+        // As 'ip addr', the local address for IPv4 (differs from IFA_ADDRESS on point to point links), IFA_FLAGS extends the 8-bit flags
+        struct rtattr* value = ((AF_INET == address->ifa_family) && (nullptr != attributes[IFA_LOCAL])) ? attributes[IFA_LOCAL] : attributes[IFA_ADDRESS];
+        unsigned int flags = attributes[IFA_FLAGS] ? *(unsigned int*)RTA_DATA(attributes[IFA_FLAGS]) : address->ifa_flags;
+        if ((nullptr == value) || (nullptr == inet_ntop(address->ifa_family, RTA_DATA(value), text, sizeof(text))))
+        {
+            return;
+        }
+
+        this->m_ipSettingsMap[interfaceNames[address->ifa_index]] += std::string((AF_INET6 == address->ifa_family) ? "    inet6 " : "    inet ") + text + g_slash +
+            std::to_string(address->ifa_prefixlen) + " scope " + FormatAddressScope(address->ifa_scope) + ((flags & IFA_F_PERMANENT) ? "" : " dynamic") + "\n";
+    });
+
+    // As 'ip route', IPv4 default routes of the main table
+    result = result && DumpNetlink(netlinkSocket, RTM_GETROUTE, AF_INET, ++sequence, [&](struct nlmsghdr* message)
+    {
+        struct rtmsg* route = (struct rtmsg*)NLMSG_DATA(message);
+        char text[INET6_ADDRSTRLEN] = {0};
+        if ((RTM_NEWROUTE != message->nlmsg_type) || (message->nlmsg_len < NLMSG_LENGTH(sizeof(*route))) || (0 != route->rtm_dst_len) || (RTN_UNICAST != route->rtm_type))
+        {
+            return;
+        }
+
+        attributes.assign(RTA_MAX + 1, nullptr);
+        GetNetlinkAttributes(RTM_RTA(route), RTM_PAYLOAD(message), attributes);
+
+        unsigned int table = attributes[RTA_TABLE] ? *(unsigned int*)RTA_DATA(attributes[RTA_TABLE]) : route->rtm_table;
+        if ((RT_TABLE_MAIN != table) || (nullptr == attributes[RTA_GATEWAY]) || (nullptr == attributes[RTA_OIF]) ||
+            (interfaceNames.end() == interfaceNames.find(*(int*)RTA_DATA(attributes[RTA_OIF]))) ||
+            (nullptr == inet_ntop(route->rtm_family, RTA_DATA(attributes[RTA_GATEWAY]), text, sizeof(text))))
+        {
+            return;
+        }
+
+        this->m_defaultGatewaysMap[interfaceNames[*(int*)RTA_DATA(attributes[RTA_OIF])]].push_back(text);
+    });
+
+    close(netlinkSocket);
+
+    if (!result)
+    {
+        if (IsFullLoggingEnabled())
+        {
+            OsConfigLogError(NetworkingLog::Get(), "Failed to read the network interfaces over rtnetlink, using commands");
+        }
+        return false;
+    }
+
+    for (std::map<int, std::string>::iterator interface = interfaceNames.begin(); interface != interfaceNames.end(); interface++)
+    {
+        this->m_interfaceTypesMap[interface->second] = GetInterfaceTypeFromSysfs(interface->second, linkTypes[interface->first]);
+    }
+
+    if (!this->m_interfaceNames.empty())
+    {
+        GenerateDnsServersMap();
+    }
+
+    return true;
+}
+
+// Drains the pending link, address and route notifications without blocking, returns true when there was any (or when not subscribed)
+bool NetworkingObjectBase::HasNetlinkChanges()
+{
+    struct sockaddr_nl groups;
+    std::vector<char> buffer(g_netlinkBufferSize);
+    bool changed = false;
+
+    if (0 > this->m_netlinkEventsSocket)
+    {
+        // Subscribed before the first dump, so no change made in between is missed
+        std::memset(&groups, 0, sizeof(groups));
+        groups.nl_family = AF_NETLINK;
+        groups.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR | RTMGRP_IPV4_ROUTE;
+
+        if (0 <= (this->m_netlinkEventsSocket = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_ROUTE)))
+        {
+            if (0 != bind(this->m_netlinkEventsSocket, (struct sockaddr*)&groups, sizeof(groups)))
+            {
+                close(this->m_netlinkEventsSocket);
+                this->m_netlinkEventsSocket = -1;
+            }
+        }
+
+        if ((0 > this->m_netlinkEventsSocket) && IsFullLoggingEnabled())
+        {
+            OsConfigLogError(NetworkingLog::Get(), "Cannot subscribe to rtnetlink notifications (%d), refreshing on every request", errno);
+        }
+
+        return true;
+    }
+
+    while (true)
+    {
+        ssize_t received = recv(this->m_netlinkEventsSocket, buffer.data(), buffer.size(), MSG_DONTWAIT);
+        if (0 < received)
+        {
+            changed = true;
+        }
+        else if ((0 > received) && (EINTR == errno))
+        {
+            continue;
+        }
+        else
+        {
+            // ENOBUFS means notifications were lost when the socket buffer overflowed
+            changed = changed || ((0 > received) && (EAGAIN != errno) && (EWOULDBLOCK != errno));
+            break;
+        }
+    }
+
+    return changed;
+}
+
+// DNS servers have no netlink notifications, systemd-resolved rewrites its resolv.conf when they change
+bool NetworkingObjectBase::HasDnsChanges()
+{
+    struct stat fileStatus;
+    std::string stamp;
+
+    for (size_t i = 0; i < ARRAY_SIZE(g_resolvConfFiles); i++)
+    {
+        if (0 == stat(g_resolvConfFiles[i], &fileStatus))
+        {
+            stamp += std::to_string(fileStatus.st_ino) + g_colon + std::to_string(fileStatus.st_mtim.tv_sec) + g_colon + std::to_string(fileStatus.st_mtim.tv_nsec);
+        }
+        stamp += g_semiColon;
+    }
+
+    if (stamp == this->m_dnsConfigurationStamp)
+    {
+        return false;
+    }
+
+    this->m_dnsConfigurationStamp = stamp;
+    return true;
+}
+
+static bool AreSettingsEqual(const NetworkingSettings& first, const NetworkingSettings& second)
+{
+    return (first.interfaceTypes == second.interfaceTypes) && (first.macAddresses == second.macAddresses) && (first.ipAddresses == second.ipAddresses) &&
+        (first.subnetMasks == second.subnetMasks) && (first.defaultGateways == second.defaultGateways) && (first.dnsServers == second.dnsServers) &&
+        (first.dhcpEnabled == second.dhcpEnabled) && (first.enabled == second.enabled) && (first.connected == second.connected);
+}
+
 void NetworkingObjectBase::RefreshSettingsStrings()
 {
-    RefreshInterfaceNames(this->m_interfaceNames);
+    NetworkingSettings previousSettings = this->m_settings;
+    bool refreshed = false;
+
+    if (this->m_useNetlink)
+    {
+        // Both checks run each time to consume the notifications and record the current resolv.conf
+        bool netlinkChanged = HasNetlinkChanges();
+        bool dnsChanged = HasDnsChanges();
+        if (this->m_netlinkSnapshotValid && !netlinkChanged && !dnsChanged)
+        {
+            return;
+        }
+
+        // Without the subscription every check reports a change, so the snapshot is refreshed on each request
+        refreshed = RefreshInterfaceDataFromNetlink();
+        this->m_netlinkSnapshotValid = refreshed;
+    }
+
+    if (!refreshed)
+    {
+        RefreshInterfaceNames(this->m_interfaceNames);
+        if (this->m_interfaceNames.size() > 0)
+        {
+            RefreshInterfaceData();
+        }
+    }
+
     if (this->m_interfaceNames.size() > 0)
     {
-        RefreshInterfaceData();
         UpdateSettingsString(NetworkingSettingType::InterfaceTypes, this->m_settings.interfaceTypes);
         UpdateSettingsString(NetworkingSettingType::MacAddresses, this->m_settings.macAddresses);
         UpdateSettingsString(NetworkingSettingType::IpAddresses, this->m_settings.ipAddresses);
@@ -780,6 +1227,11 @@ void NetworkingObjectBase::RefreshSettingsStrings()
         UpdateSettingsString(NetworkingSettingType::Enabled, this->m_settings.enabled);
         UpdateSettingsString(NetworkingSettingType::Connected, this->m_settings.connected);
     }
+
+    if ((0 == this->m_generation) || !AreSettingsEqual(previousSettings, this->m_settings))
+    {
+        this->m_generation++;
+    }
 }
 
 bool NetworkingObjectBase::IsKnownInterfaceName(std::string str)
@@ -933,30 +1385,39 @@ int NetworkingObjectBase::Get(
     {
         RefreshSettingsStrings();
 
-        std::vector<std::pair<std::string, std::string>> fieldValueVector;
-        fieldValueVector.push_back(make_pair(g_interfaceTypes, m_settings.interfaceTypes));
-        fieldValueVector.push_back(make_pair(g_macAddresses, m_settings.macAddresses));
-        fieldValueVector.push_back(make_pair(g_ipAddresses, m_settings.ipAddresses));
-        fieldValueVector.push_back(make_pair(g_subnetMasks, m_settings.subnetMasks));
-        fieldValueVector.push_back(make_pair(g_defaultGateways, m_settings.defaultGateways));
-        fieldValueVector.push_back(make_pair(g_dnsServers, m_settings.dnsServers));
-        fieldValueVector.push_back(make_pair(g_dhcpEnabled, m_settings.dhcpEnabled));
-        fieldValueVector.push_back(make_pair(g_enabled, m_settings.enabled));
-        fieldValueVector.push_back(make_pair(g_connected, m_settings.connected));
-
-        status = TruncateValueStrings(fieldValueVector);
-        rapidjson::StringBuffer sb;
-        rapidjson::Writer<rapidjson::StringBuffer> writer(sb);
-        writer.StartObject();
-        int writeResult = 0;
-        for (size_t i = 0; i < fieldValueVector.size(); i++)
+        // The same generation has the same settings, so the payload serialized for it is reported again
+        if (m_payloadGeneration != GetGeneration())
         {
-            writeResult += WriteJsonElement(&writer, fieldValueVector[i].first.c_str(), fieldValueVector[i].second.c_str());
+            std::vector<std::pair<std::string, std::string>> fieldValueVector;
+            fieldValueVector.push_back(make_pair(g_interfaceTypes, m_settings.interfaceTypes));
+            fieldValueVector.push_back(make_pair(g_macAddresses, m_settings.macAddresses));
+            fieldValueVector.push_back(make_pair(g_ipAddresses, m_settings.ipAddresses));
+            fieldValueVector.push_back(make_pair(g_subnetMasks, m_settings.subnetMasks));
+            fieldValueVector.push_back(make_pair(g_defaultGateways, m_settings.defaultGateways));
+            fieldValueVector.push_back(make_pair(g_dnsServers, m_settings.dnsServers));
+            fieldValueVector.push_back(make_pair(g_dhcpEnabled, m_settings.dhcpEnabled));
+            fieldValueVector.push_back(make_pair(g_enabled, m_settings.enabled));
+            fieldValueVector.push_back(make_pair(g_connected, m_settings.connected));
+
+            m_payloadStatus = TruncateValueStrings(fieldValueVector);
+            rapidjson::StringBuffer sb;
+            rapidjson::Writer<rapidjson::StringBuffer> writer(sb);
+            writer.StartObject();
+            m_payloadWriteResult = 0;
+            for (size_t i = 0; i < fieldValueVector.size(); i++)
+            {
+                m_payloadWriteResult += WriteJsonElement(&writer, fieldValueVector[i].first.c_str(), fieldValueVector[i].second.c_str());
+            }
+            writer.EndObject();
+
+            m_payloadJson = sb.GetString();
+            m_payloadJson.erase(std::find(m_payloadJson.begin(), m_payloadJson.end(), '\0'), m_payloadJson.end());
+            m_payloadGeneration = GetGeneration();
         }
-        writer.EndObject();
 
-        std::string networkingJsonString(sb.GetString());
-        networkingJsonString.erase(std::find(networkingJsonString.begin(), networkingJsonString.end(), '\0'), networkingJsonString.end());
+        status = m_payloadStatus;
+        int writeResult = m_payloadWriteResult;
+        const std::string& networkingJsonString = m_payloadJson;
 
         *payloadSizeBytes = networkingJsonString.length();
 
@@ -70,7 +70,7 @@ public:
         Connected
     };
 
-    virtual ~NetworkingObjectBase() {};
+    virtual ~NetworkingObjectBase();
     virtual std::string RunCommand(const char* command) = 0;
 
     int Get(
@@ -81,9 +81,20 @@ public:
 
     int TruncateValueStrings(std::vector<std::pair<std::string, std::string>>& fieldValueVector);
 
+    // Advances each time a Get finds the networking settings changed, callers can skip reporting the same generation again
+    unsigned long long GetGeneration();
+
     unsigned int m_maxPayloadSizeBytes;
     NetworkManagementService m_networkManagementService;
 
+    // When enabled interfaces, addresses, routes and types are read over rtnetlink and from /sys/class/net instead of running commands
+    bool m_useNetlink = false;
+
+protected:
+    // Returns true when the link, address and route notifications show a change (or when not subscribed to them)
+    virtual bool HasNetlinkChanges();
+    virtual bool RefreshInterfaceDataFromNetlink();
+
 private:
     void ParseInterfaceDataForSettings(bool labeled, const char* flag, std::stringstream& data, std::vector<std::string>& settings);
     void GetInterfaceTypes(const std::string& interfaceName, std::vector<std::string>& interfaceSettings);
@@ -106,6 +117,7 @@ private:
     void GetGlobalDnsServers(std::string dnsServersData, std::vector<std::string>& globalDnsServers);
     void RefreshInterfaceNames(std::vector<std::string>& interfaceNames);
     void RefreshInterfaceData();
+    bool HasDnsChanges();
     void RefreshSettingsStrings();
     bool IsKnownInterfaceName(std::string str);
     virtual int WriteJsonElement(rapidjson::Writer<rapidjson::StringBuffer>* writer, const char* key, const char* value) = 0;
@@ -117,6 +129,18 @@ private:
     std::map<std::string, std::string> m_ipSettingsMap;
     std::map<std::string, std::vector<std::string>> m_defaultGatewaysMap;
     std::map<std::string, std::vector<std::string>> m_dnsServersMap;
+
+    // Subscribed to link, address and route notifications, the netlink snapshot is only refreshed after a change
+    int m_netlinkEventsSocket = -1;
+    bool m_netlinkSnapshotValid = false;
+    std::string m_dnsConfigurationStamp;
+
+    // The payload serialized for the current generation, rebuilt only after the settings change
+    unsigned long long m_generation = 0;
+    unsigned long long m_payloadGeneration = 0;
+    std::string m_payloadJson;
+    int m_payloadStatus = MMI_OK;
+    int m_payloadWriteResult = 0;
 };
 
 class NetworkingObject : public NetworkingObjectBase
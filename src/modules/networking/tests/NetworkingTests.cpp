@@ -68,6 +68,32 @@ int NetworkingObjectTest::WriteJsonElement(rapidjson::Writer<rapidjson::StringBu
     return result;
 }
 
+// Reads over rtnetlink with simulated change notifications, the first check reports a change as the real one does before subscribing
+class NetlinkNetworkingObjectTest : public NetworkingObject
+{
+public:
+    NetlinkNetworkingObjectTest(unsigned int maxPayloadSizeBytes);
+    bool notified = true;
+    unsigned int refreshCount = 0;
+    bool HasNetlinkChanges() override;
+    bool RefreshInterfaceDataFromNetlink() override;
+};
+
+NetlinkNetworkingObjectTest::NetlinkNetworkingObjectTest(unsigned int maxPayloadSizeBytes) : NetworkingObject(maxPayloadSizeBytes) {}
+
+bool NetlinkNetworkingObjectTest::HasNetlinkChanges()
+{
+    bool changed = notified;
+    notified = false;
+    return changed;
+}
+
+bool NetlinkNetworkingObjectTest::RefreshInterfaceDataFromNetlink()
+{
+    refreshCount++;
+    return NetworkingObject::RefreshInterfaceDataFromNetlink();
+}
+
 namespace OSConfig::Platform::Tests
 {
     unsigned int g_maxPayloadSizeBytes = 4000;
@@ -928,4 +954,85 @@ namespace OSConfig::Platform::Tests
         EXPECT_NE(payload, nullptr);
         delete payload;
     }
+
+    TEST(NetworkingTests, GetFromNetlink)
+    {
+        MMI_JSON_STRING payload = nullptr;
+        int payloadSizeBytes = 0;
+        NetworkingObject networkingObject(g_maxPayloadSizeBytes);
+
+        EXPECT_TRUE(networkingObject.m_useNetlink);
+        EXPECT_EQ(MMI_OK, networkingObject.Get(NETWORKING, NETWORK_CONFIGURATION, &payload, &payloadSizeBytes));
+        EXPECT_NE(payload, nullptr);
+
+        // The loopback interface is always present
+        std::string resultString(payload, payloadSizeBytes);
+        EXPECT_NE(std::string::npos, resultString.find("lo=loopback"));
+        EXPECT_NE(std::string::npos, resultString.find("lo=127.0.0.1"));
+
+        delete[] payload;
+    }
+
+    TEST(NetworkingTests, GetAfterNetlinkChange)
+    {
+        MMI_JSON_STRING payload = nullptr;
+        int payloadSizeBytes = 0;
+        NetlinkNetworkingObjectTest testModule(g_maxPayloadSizeBytes);
+
+        EXPECT_EQ(MMI_OK, testModule.Get(NETWORKING, NETWORK_CONFIGURATION, &payload, &payloadSizeBytes));
+        EXPECT_EQ(1, testModule.refreshCount);
+        EXPECT_EQ(1, testModule.GetGeneration());
+        std::string firstResult(payload, payloadSizeBytes);
+        delete[] payload;
+
+        // Without a notification the snapshot is not read again
+        EXPECT_EQ(MMI_OK, testModule.Get(NETWORKING, NETWORK_CONFIGURATION, &payload, &payloadSizeBytes));
+        EXPECT_EQ(1, testModule.refreshCount);
+        EXPECT_EQ(1, testModule.GetGeneration());
+        EXPECT_EQ(firstResult, std::string(payload, payloadSizeBytes));
+        delete[] payload;
+
+        // A notification refreshes the snapshot, the generation only advances if the settings read differ
+        testModule.notified = true;
+        EXPECT_EQ(MMI_OK, testModule.Get(NETWORKING, NETWORK_CONFIGURATION, &payload, &payloadSizeBytes));
+        EXPECT_EQ(2, testModule.refreshCount);
+        EXPECT_EQ(1, testModule.GetGeneration());
+        EXPECT_EQ(firstResult, std::string(payload, payloadSizeBytes));
+        delete[] payload;
+    }
+
+    TEST(NetworkingTests, GetAfterChange)
+    {
+        std::string testIpDataEth0Down =
+            "1: docker0: <BROADCAST,UP,LOWER_UP> mtu 65536 qdisc noqueue state UP group default qlen 1000\n"
+            "link/bridge 0a:25:3g:6v:2f:89 brd 00:00:00:00:00:00\n"
+            "2: eth0: <BROADCAST> mtu 65536 qdisc noqueue state DOWN group default qlen 1000\n"
+            "link/ether 00:15:5d:26:cf:89 brd 00:00:00:00:00:00\n";
+
+        MMI_JSON_STRING payload = nullptr;
+        int payloadSizeBytes = 0;
+        NetworkingObjectTest testModule(g_maxPayloadSizeBytes);
+        EXPECT_EQ(0, testModule.GetGeneration());
+
+        testModule.returnValues = g_returnValues;
+        EXPECT_EQ(MMI_OK, testModule.Get(NETWORKING, NETWORK_CONFIGURATION, &payload, &payloadSizeBytes));
+        EXPECT_EQ(1, testModule.GetGeneration());
+        std::string firstResult(payload, payloadSizeBytes);
+        delete[] payload;
+
+        // The commands print the same again
+        testModule.runCommandCount = 0;
+        EXPECT_EQ(MMI_OK, testModule.Get(NETWORKING, NETWORK_CONFIGURATION, &payload, &payloadSizeBytes));
+        EXPECT_EQ(1, testModule.GetGeneration());
+        EXPECT_EQ(firstResult, std::string(payload, payloadSizeBytes));
+        delete[] payload;
+
+        // eth0 goes down
+        testModule.runCommandCount = 0;
+        std::replace(testModule.returnValues.begin(), testModule.returnValues.end(), g_testIpData, testIpDataEth0Down);
+        EXPECT_EQ(MMI_OK, testModule.Get(NETWORKING, NETWORK_CONFIGURATION, &payload, &payloadSizeBytes));
+        EXPECT_EQ(2, testModule.GetGeneration());
+        EXPECT_NE(firstResult, std::string(payload, payloadSizeBytes));
+        delete[] payload;
+    }
 } // namespace OSConfig::Platform::Tests
\ No newline at end of file
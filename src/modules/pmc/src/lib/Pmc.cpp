@@ -25,12 +25,10 @@ int Pmc::RunCommand(const char* command, std::string* textResult, bool isLongRun
     const bool forJson = false;
     int status = ExecuteCommand(nullptr, command, replaceEol, forJson, 0, isLongRunning ? TIMEOUT_LONG_RUNNING : 0, &buffer, nullptr, PmcLog::Get());
 
-    if (status == PMC_0K)
+    // The output is kept on failure too, it carries the reason (for example apt errors)
+    if (buffer && textResult)
     {
-        if (buffer && textResult)
-        {
-            *textResult = buffer;
-        }
+        *textResult = buffer;
     }
 
     FREE_MEMORY(buffer);
@@ -8,6 +8,7 @@
 #include <rapidjson/writer.h>
 #include <regex>
 #include <set>
+#include <sstream>
 
 #include <CommonUtils.h>
 #include <Mmi.h>
@@ -27,18 +28,32 @@ static const std::string g_sourcesFingerprint = "sourcesFingerprint";
 static const std::string g_sourcesFilenames = "sourcesFilenames";
 
 constexpr const char* g_commandAptUpdate = "apt-get update";
+constexpr const char* g_commandAptUpdateSource = "apt-get update -o Dir::Etc::sourcelist=$value -o Dir::Etc::sourceparts=- -o APT::Get::List-Cleanup=0";
 constexpr const char* g_commandExecuteUpdate = "apt-get install $value -y --allow-downgrades --auto-remove";
-constexpr const char* g_commandGetInstalledPackageVersion = "apt-cache policy $value | grep Installed";
+constexpr const char* g_commandSimulateUpdate = "apt-get install -s $value -y --allow-downgrades --auto-remove";
 constexpr const char* g_commandDownloadGpgKey = "curl -sSL $url | gpg --dearmor --yes -o $destination";
 
-constexpr const char* g_regexPackages = "(?:[a-zA-Z\\d\\-]+(?:=[a-zA-Z\\d\\.\\+\\-\\~\\:]+|\\-| )*)+";
+constexpr const char* g_regexPackages = "(?:[a-zA-Z\\d\\-]+(?:\\:[a-zA-Z\\d\\-]+)?(?:=[a-zA-Z\\d\\.\\+\\-\\~\\:]+|\\-| )*)+";
 constexpr const char* g_regexSources = "^(deb|deb-src)(?:\\s+\\[(.*)\\])?\\s+(https?:\\/\\/\\S+)\\s+(\\S+)\\s+(\\S+)\\s*$";
 constexpr const char* g_regexSignedByOption = "^.*signed-by=(\\S*).*$";
 
 constexpr const char* g_sourcesFolderPath = "/etc/apt/sources.list.d/";
 constexpr const char* g_keysFolderPath = "/usr/share/keyrings/";
+constexpr const char* g_packageStatusFilePath = "/var/lib/dpkg/status";
+constexpr const char* g_mainSourcesFilePath = "/etc/apt/sources.list";
+constexpr const char* g_sourcesFingerprintFilePath = "/etc/osconfig/osconfig_pmc_sources.cache";
 
 constexpr const char* g_listExtension = ".list";
+constexpr const char* g_deb822Extension = ".sources";
+constexpr const char* g_gpgExtension = ".gpg";
+constexpr const char* g_refreshedPrefix = "refreshed ";
+
+// Each apt transaction runs under one TIMEOUT_LONG_RUNNING, so it installs about this many packages,
+// more only when a single desired line lists more, as the packages of a line always go together
+constexpr const size_t g_maxPackagesPerTransaction = 5;
+
+// Package lists are refreshed at least this often even when sources and keys did not change
+constexpr const double g_packageListsMaxAgeSeconds = 24 * 60 * 60;
 constexpr const char g_moduleInfo[] = R""""({
     "Name": "PMC",
     "Description": "Module designed to install DEB-packages using APT",
@@ -55,12 +70,22 @@ using SubstateComponent = ExecutionState::SubstateComponent;
 
 OSCONFIG_LOG_HANDLE PmcLog::m_log = nullptr;
 
-PmcBase::PmcBase(unsigned int maxPayloadSizeBytes, const char* sourcesDirectory)
+PmcBase::PmcBase(unsigned int maxPayloadSizeBytes, const char* sourcesDirectory, const char* packageStatusFile, const char* sourcesFingerprintFile)
 {
     m_maxPayloadSizeBytes = maxPayloadSizeBytes;
     m_sourcesConfigurationDirectory = sourcesDirectory;
     m_executionState = ExecutionState();
     m_lastReachedStateHash = 0;
+    m_packageStatusFile = packageStatusFile;
+    m_packageStatusFileStat = {};
+    m_installedPackagesValid = false;
+    m_sourcesFingerprintFile = sourcesFingerprintFile;
+    m_packageListsRefreshSkipped = false;
+}
+
+PmcBase::PmcBase(unsigned int maxPayloadSizeBytes, const char* sourcesDirectory)
+    : PmcBase(maxPayloadSizeBytes, sourcesDirectory, g_packageStatusFilePath, g_sourcesFingerprintFilePath)
+{
 }
 
 PmcBase::PmcBase(unsigned int maxPayloadSizeBytes)
@@ -185,6 +210,16 @@ int PmcBase::Set(const char* componentName, const char* objectName, const MMI_JS
                                 if (m_executionState.IsSuccessful())
                                 {
                                     status = ExecuteUpdates(desiredState.Packages);
+                                    if (!m_executionState.IsSuccessful() && (status != ETIME) && m_packageListsRefreshSkipped)
+                                    {
+                                        // The skipped refresh may have missed a newly published version, refresh and retry once
+                                        OsConfigLogInfo(PmcLog::Get(), "Refreshing the package lists and retrying the update of package(s)");
+                                        status = UpdatePackageLists(true);
+                                        if (m_executionState.IsSuccessful())
+                                        {
+                                            status = ExecuteUpdates(desiredState.Packages);
+                                        }
+                                    }
                                 }
                             }
                         }
@@ -478,9 +513,94 @@ int PmcBase::ExecuteUpdate(const std::string &value)
     return status;
 }
 
+int PmcBase::SimulateUpdate(const std::string &value)
+{
+    std::string command = std::regex_replace(g_commandSimulateUpdate, std::regex("\\$value"), value);
+    std::string textResult;
+
+    int status = RunCommand(command.c_str(), &textResult);
+    if (status != PMC_0K)
+    {
+        OsConfigLogError(PmcLog::Get(), "Simulated update failed with status %d and arguments '%s': %s", status, value.c_str(), textResult.c_str());
+    }
+    return status;
+}
+
 int PmcBase::ExecuteUpdates(const std::vector<std::string>& packages)
 {
     int status = PMC_0K;
+    std::vector<std::string> batch;
+    size_t batchSize = 0;
+
+    for (auto it = packages.begin(); (it != packages.end()) && (PMC_0K == status); ++it)
+    {
+        size_t lineSize = Split(*it, " ").size();
+
+        if (!batch.empty() && ((batchSize + lineSize) > g_maxPackagesPerTransaction))
+        {
+            status = ExecuteUpdatesBatch(batch);
+            batch.clear();
+            batchSize = 0;
+        }
+
+        batch.push_back(*it);
+        batchSize += lineSize;
+    }
+
+    if ((PMC_0K == status) && !batch.empty())
+    {
+        status = ExecuteUpdatesBatch(batch);
+    }
+
+    if (PMC_0K == status)
+    {
+        m_executionState.SetExecutionState(StateComponent::Succeeded, SubstateComponent::None);
+    }
+
+    return status;
+}
+
+int PmcBase::ExecuteUpdatesBatch(const std::vector<std::string>& packages)
+{
+    int status = PMC_0K;
+
+    if (packages.size() > 1)
+    {
+        // Install everything in one apt transaction so dependencies are resolved and the dpkg lock is taken once
+        std::string allPackages;
+        for (auto& package : packages)
+        {
+            allPackages += (allPackages.empty() ? "" : " ") + package;
+        }
+
+        m_executionState.SetExecutionState(StateComponent::Running, SubstateComponent::InstallingPackages, allPackages);
+        status = ExecuteUpdate(allPackages);
+        if (status == PMC_0K)
+        {
+            return status;
+        }
+        else if (status == ETIME)
+        {
+            OsConfigLogError(PmcLog::Get(), "Failed to update package(s): %s", allPackages.c_str());
+            m_executionState.SetExecutionState(StateComponent::TimedOut, SubstateComponent::InstallingPackages, allPackages);
+            return status;
+        }
+
+        // Attribute the failure to the first package that cannot be installed on its own
+        for (auto& package : packages)
+        {
+            m_executionState.SetExecutionState(StateComponent::Running, SubstateComponent::InstallingPackages, package);
+            if (PMC_0K != SimulateUpdate(package))
+            {
+                OsConfigLogError(PmcLog::Get(), "Failed to update package(s): %s", package.c_str());
+                m_executionState.SetExecutionState(StateComponent::Failed, SubstateComponent::InstallingPackages, package);
+                return status;
+            }
+        }
+
+        // Every package installs on its own, so install them one at a time
+        OsConfigLogInfo(PmcLog::Get(), "Failed to update all packages at once with status %d, updating them one at a time", status);
+    }
 
     for (std::string package : packages)
     {
@@ -497,7 +617,6 @@ int PmcBase::ExecuteUpdates(const std::vector<std::string>& packages)
         }
     }
 
-    m_executionState.SetExecutionState(StateComponent::Succeeded, SubstateComponent::None);
     return status;
 }
 
@@ -592,44 +711,164 @@ int PmcBase::ValidateAndGetPackagesNames(const std::vector<std::string>& package
     return 0;
 }
 
+bool PmcBase::RefreshInstalledPackages()
+{
+    struct stat fileStat = {};
+
+    if (0 != stat(m_packageStatusFile, &fileStat))
+    {
+        if (IsFullLoggingEnabled())
+        {
+            OsConfigLogError(PmcLog::Get(), "Failed to read the package status file %s (%d)", m_packageStatusFile, errno);
+        }
+        m_installedPackages.clear();
+        m_installedPackagesValid = false;
+        return false;
+    }
+
+    // dpkg rewrites the status file on every change, so an unchanged file means unchanged package versions
+    if (m_installedPackagesValid &&
+        (fileStat.st_ino == m_packageStatusFileStat.st_ino) &&
+        (fileStat.st_size == m_packageStatusFileStat.st_size) &&
+        (fileStat.st_mtim.tv_sec == m_packageStatusFileStat.st_mtim.tv_sec) &&
+        (fileStat.st_mtim.tv_nsec == m_packageStatusFileStat.st_mtim.tv_nsec))
+    {
+        return true;
+    }
+
+    std::ifstream statusFile(m_packageStatusFile);
+    if (!statusFile.is_open())
+    {
+        OsConfigLogError(PmcLog::Get(), "Failed to open the package status file %s", m_packageStatusFile);
+        m_installedPackages.clear();
+        m_installedPackagesValid = false;
+        return false;
+    }
+
+    std::string line;
+    std::string packageName;
+    std::string architecture;
+    std::string version;
+    bool installed = false;
+
+    // A package has an installed version unless it is not installed or only
+    // its configuration files remain, same as apt-cache policy reports it
+    auto addPackage = [&]()
+    {
+        if (!packageName.empty() && installed && !version.empty())
+        {
+            m_installedPackages[architecture.empty() ? packageName : (packageName + ":" + architecture)] = version;
+
+            // dpkg itself is always installed for the native architecture
+            if (packageName == "dpkg")
+            {
+                m_nativeArchitecture = architecture;
+            }
+        }
+        packageName.clear();
+        architecture.clear();
+        version.clear();
+        installed = false;
+    };
+
+    m_installedPackages.clear();
+    m_nativeArchitecture.clear();
+
+    // Package stanzas are separated by blank lines
+    while (std::getline(statusFile, line))
+    {
+        if (line.empty())
+        {
+            addPackage();
+        }
+        else if (0 == line.compare(0, 9, "Package: "))
+        {
+            packageName = Trim(line.substr(9), " ");
+        }
+        else if (0 == line.compare(0, 8, "Status: "))
+        {
+            std::vector<std::string> status = Split(Trim(line.substr(8), " "), " ");
+            installed = (3 == status.size()) && (status[2] != "not-installed") && (status[2] != "config-files");
+        }
+        else if (0 == line.compare(0, 14, "Architecture: "))
+        {
+            architecture = Trim(line.substr(14), " ");
+        }
+        else if (0 == line.compare(0, 9, "Version: "))
+        {
+            version = Trim(line.substr(9), " ");
+        }
+    }
+
+    addPackage();
+
+    m_packageStatusFileStat = fileStat;
+    m_installedPackagesValid = true;
+
+    return true;
+}
+
 std::vector<std::string> PmcBase::GetReportedPackages(const std::vector<std::string>& packages)
 {
     std::vector<std::string> result;
     std::set<std::string> uniquePackages;
 
-    int status = PMC_0K;
+    bool available = RefreshInstalledPackages();
     for (auto& packageName : packages)
     {
         if (uniquePackages.insert(packageName).second)
         {
-            std::string command = std::regex_replace(g_commandGetInstalledPackageVersion, std::regex("\\$value"), packageName);
-
-            std::string rawVersion = "";
-            status = RunCommand(command.c_str(), &rawVersion);
-            if (status != PMC_0K && IsFullLoggingEnabled())
-            {
-                OsConfigLogError(PmcLog::Get(), "Get the installed version of package %s failed with status %d", packageName.c_str(), status);
-            }
-
             std::string version;
-            if (!rawVersion.empty())
+            if (available)
             {
-                size_t pos = rawVersion.find_first_of(':') + 1;
-                version = rawVersion.substr(pos);
+                version = GetInstalledVersion(packageName);
             }
             else
             {
                 version = "(failed)";
             }
 
-            std::string packageElement = packageName + "=" + Trim(version, " ");
-            result.push_back(packageElement);
+            result.push_back(packageName + "=" + version);
         }
     }
 
   return result;
 }
 
+std::string PmcBase::GetInstalledVersion(const std::string& packageName) const
+{
+    // A name qualified as name:architecture only matches that instance
+    if (std::string::npos != packageName.find(':'))
+    {
+        auto installedPackage = m_installedPackages.find(packageName);
+        return (installedPackage != m_installedPackages.end()) ? installedPackage->second : "(none)";
+    }
+
+    // Like apt, a bare name means the native instance, or the architecture independent one
+    for (const std::string& key : {packageName + ":" + m_nativeArchitecture, packageName + ":all", packageName})
+    {
+        auto installedPackage = m_installedPackages.find(key);
+        if (installedPackage != m_installedPackages.end())
+        {
+            return installedPackage->second;
+        }
+    }
+
+    // Otherwise the only installed instance, whatever its architecture
+    std::string prefix = packageName + ":";
+    auto first = m_installedPackages.lower_bound(prefix);
+    if ((first != m_installedPackages.end()) && (0 == first->first.compare(0, prefix.size(), prefix)))
+    {
+        auto next = std::next(first);
+        if ((next == m_installedPackages.end()) || (0 != next->first.compare(0, prefix.size(), prefix)))
+        {
+            return first->second;
+        }
+    }
+
+    return "(none)";
+}
+
 std::vector<std::string> PmcBase::Split(const std::string& str, const std::string& delimiter)
 {
     std::vector<std::string> result;
@@ -774,8 +1013,143 @@ int PmcBase::ConfigureSources(const std::map<std::string, std::string>& sources,
         }
     }
 
+    return UpdatePackageLists(false);
+}
+
+std::map<std::string, std::string> PmcBase::GetSourcesFingerprints() const
+{
+    std::map<std::string, std::string> fingerprints;
+    std::vector<std::string> files = { g_mainSourcesFilePath };
+
+    for (auto& fileName : ListFiles(m_sourcesConfigurationDirectory, g_listExtension))
+    {
+        files.push_back(m_sourcesConfigurationDirectory + fileName);
+    }
+
+    for (auto& fileName : ListFiles(m_sourcesConfigurationDirectory, g_deb822Extension))
+    {
+        files.push_back(m_sourcesConfigurationDirectory + fileName);
+    }
+
+    for (auto& fileName : ListFiles(g_keysFolderPath, g_gpgExtension))
+    {
+        files.push_back(g_keysFolderPath + fileName);
+    }
+
+    for (auto& file : files)
+    {
+        std::ifstream input(file, std::ios::binary);
+        if (input.is_open())
+        {
+            std::stringstream content;
+            content << input.rdbuf();
+            std::string data = content.str();
+
+            char* hash = Sha256Buffer(data.c_str(), data.size());
+            if (nullptr != hash)
+            {
+                fingerprints[file] = hash;
+                FREE_MEMORY(hash);
+            }
+        }
+    }
+
+    return fingerprints;
+}
+
+bool PmcBase::LoadSourcesFingerprints(std::map<std::string, std::string>& fingerprints, time_t& refreshed) const
+{
+    std::ifstream input(m_sourcesFingerprintFile);
+    std::string line;
+
+    fingerprints.clear();
+
+    // The first line holds the time of the last full refresh, followed by one "<hash>  <path>" line per file
+    if (!input.is_open() || !std::getline(input, line) || (0 != line.compare(0, strlen(g_refreshedPrefix), g_refreshedPrefix)))
+    {
+        return false;
+    }
+
+    refreshed = static_cast<time_t>(strtoll(line.c_str() + strlen(g_refreshedPrefix), nullptr, 10));
+
+    while (std::getline(input, line))
+    {
+        size_t separator = line.find("  ");
+        if (separator != std::string::npos)
+        {
+            fingerprints[line.substr(separator + 2)] = line.substr(0, separator);
+        }
+    }
+
+    return true;
+}
+
+void PmcBase::SaveSourcesFingerprints(const std::map<std::string, std::string>& fingerprints, time_t refreshed) const
+{
+    std::ofstream output(m_sourcesFingerprintFile);
+
+    if (output.fail())
+    {
+        OsConfigLogError(PmcLog::Get(), "Failed to save the sources fingerprint to %s", m_sourcesFingerprintFile);
+        return;
+    }
+
+    output << g_refreshedPrefix << static_cast<long long>(refreshed) << std::endl;
+    for (auto& fingerprint : fingerprints)
+    {
+        output << fingerprint.second << "  " << fingerprint.first << std::endl;
+    }
+}
+
+int PmcBase::UpdatePackageLists(bool force)
+{
+    int status = PMC_0K;
+    std::map<std::string, std::string> fingerprints = GetSourcesFingerprints();
+    std::map<std::string, std::string> lastFingerprints;
+    std::vector<std::string> changedFiles;
+    std::string command = g_commandAptUpdate;
+    time_t now = time(nullptr);
+    time_t lastRefreshed = 0;
+    bool removedFiles = false;
+
+    m_packageListsRefreshSkipped = false;
     m_executionState.SetExecutionState(StateComponent::Running, SubstateComponent::UpdatingPackageLists);
-    status = RunCommand(g_commandAptUpdate, nullptr, true);
+
+    if (!force && LoadSourcesFingerprints(lastFingerprints, lastRefreshed) && (lastRefreshed <= now) && (difftime(now, lastRefreshed) < g_packageListsMaxAgeSeconds))
+    {
+        for (auto& lastFingerprint : lastFingerprints)
+        {
+            removedFiles |= (fingerprints.find(lastFingerprint.first) == fingerprints.end());
+        }
+
+        for (auto& fingerprint : fingerprints)
+        {
+            auto lastFingerprint = lastFingerprints.find(fingerprint.first);
+            if ((lastFingerprint == lastFingerprints.end()) || (lastFingerprint->second != fingerprint.second))
+            {
+                changedFiles.push_back(fingerprint.first);
+            }
+        }
+
+        if (!removedFiles && changedFiles.empty())
+        {
+            OsConfigLogInfo(PmcLog::Get(), "Sources and keys did not change since the package lists were refreshed, skipping '%s'", g_commandAptUpdate);
+            m_packageListsRefreshSkipped = true;
+            m_executionState.SetExecutionState(StateComponent::Succeeded, SubstateComponent::None);
+            return status;
+        }
+
+        // A single added or modified one-line-style source is refreshed on its own, other lists keep their refresh time
+        std::string changedFile = (1 == changedFiles.size()) ? changedFiles[0] : "";
+        if (!removedFiles && (0 == changedFile.compare(0, strlen(m_sourcesConfigurationDirectory), m_sourcesConfigurationDirectory)) &&
+            (changedFile.size() > strlen(g_listExtension)) && (0 == changedFile.compare(changedFile.size() - strlen(g_listExtension), std::string::npos, g_listExtension)))
+        {
+            command = std::regex_replace(g_commandAptUpdateSource, std::regex("\\$value"), changedFile);
+            now = lastRefreshed;
+        }
+    }
+
+    status = RunCommand(command.c_str(), nullptr, true);
 
     if (status != PMC_0K)
     {
@@ -785,6 +1159,7 @@ int PmcBase::ConfigureSources(const std::map<std::string, std::string>& sources,
     }
     else
     {
+        SaveSourcesFingerprints(fingerprints, now);
         m_executionState.SetExecutionState(StateComponent::Succeeded, SubstateComponent::None);
     }
 
@@ -2,11 +2,13 @@
 // Licensed under the MIT License.
 
 #include <cstdio>
+#include <ctime>
 #include <map>
 #include <string>
 #include <rapidjson/document.h>
 #include <rapidjson/stringbuffer.h>
 #include <rapidjson/writer.h>
+#include <sys/stat.h>
 #include <vector>
 
 #include <CommonUtils.h>
@@ -60,6 +62,7 @@ public:
         std::vector<std::string> SourcesFilenames;
     };
 
+    PmcBase(unsigned int maxPayloadSizeBytes, const char* sourcesDirectory, const char* packageStatusFile, const char* sourcesFingerprintFile);
     PmcBase(unsigned int maxPayloadSizeBytes, const char* sourcesDirectory);
     PmcBase(unsigned int maxPayloadSizeBytes);
     virtual ~PmcBase() = default;
@@ -78,9 +81,17 @@ protected:
 private:
     virtual bool CanRunOnThisPlatform() = 0;
     int ExecuteUpdate(const std::string& value);
+    int SimulateUpdate(const std::string& value);
     int ExecuteUpdates(const std::vector<std::string>& packages);
+    int ExecuteUpdatesBatch(const std::vector<std::string>& packages);
     std::vector<std::string> GetReportedPackages(const std::vector<std::string>& packages);
+    bool RefreshInstalledPackages();
+    std::string GetInstalledVersion(const std::string& packageName) const;
     int ConfigureSources(const std::map<std::string, std::string>& sources, const std::map<std::string, std::string>& gpgKeys);
+    int UpdatePackageLists(bool force);
+    std::map<std::string, std::string> GetSourcesFingerprints() const;
+    bool LoadSourcesFingerprints(std::map<std::string, std::string>& fingerprints, time_t& refreshed) const;
+    void SaveSourcesFingerprints(const std::map<std::string, std::string>& fingerprints, time_t refreshed) const;
     int ValidateAndGetPackagesNames(const std::vector<std::string>& packagesLines);
     int ValidateDocument(const rapidjson::Document& document);
     int DownloadGpgKeys(const std::map<std::string, std::string>& gpgKeys);
@@ -102,4 +113,16 @@ private:
     unsigned int m_maxPayloadSizeBytes;
     size_t m_lastReachedStateHash;
     const char* m_sourcesConfigurationDirectory;
+
+    // Installed package versions parsed from the dpkg status file, reparsed only when the file changes,
+    // keyed by name:architecture so that the instances of a multi-arch package do not overwrite each other
+    const char* m_packageStatusFile;
+    std::map<std::string, std::string> m_installedPackages;
+    std::string m_nativeArchitecture;
+    struct stat m_packageStatusFileStat;
+    bool m_installedPackagesValid;
+
+    // Per file hashes of the sources and keys the package lists were last refreshed against
+    const char* m_sourcesFingerprintFile;
+    bool m_packageListsRefreshSkipped;
 };
\ No newline at end of file
@@ -16,7 +16,7 @@ namespace OSConfig::Platform::Tests
         FRIEND_TEST(PmcTests, InvalidPackageSourcesAreRejected);
 
     public:
-        PmcTestImpl(unsigned int maxPayloadSizeBytes, const char* sourcesDirectory);
+        PmcTestImpl(unsigned int maxPayloadSizeBytes, const char* sourcesDirectory, const char* packageStatusFile, const char* sourcesFingerprintFile);
         void SetTextResult(const std::map<std::string, std::tuple<int, std::string>> &textResults);
 
     private:
@@ -27,8 +27,8 @@ namespace OSConfig::Platform::Tests
         std::map<std::string, std::tuple<int, std::string>> m_textResults;
     };
 
-    PmcTestImpl::PmcTestImpl(unsigned int maxPayloadSizeBytes, const char* sourcesDirectory)
-    : PmcBase(maxPayloadSizeBytes, sourcesDirectory)
+    PmcTestImpl::PmcTestImpl(unsigned int maxPayloadSizeBytes, const char* sourcesDirectory, const char* packageStatusFile, const char* sourcesFingerprintFile)
+    : PmcBase(maxPayloadSizeBytes, sourcesDirectory, packageStatusFile, sourcesFingerprintFile)
     {
     }
 
@@ -75,7 +75,7 @@ namespace OSConfig::Platform::Tests
         void SetUp() override
         {
             mkdir(sourcesDirectory, 0775);
-            testModule = new PmcTestImpl(g_maxPayloadSizeBytes, sourcesDirectory);
+            testModule = new PmcTestImpl(g_maxPayloadSizeBytes, sourcesDirectory, packageStatusFile, sourcesFingerprintFile);
         }
 
         void TearDown() override
@@ -95,7 +95,16 @@ namespace OSConfig::Platform::Tests
         static constexpr const char* desiredObjectName = "desiredState";
         static constexpr const char* reportedObjectName = "state";
         static constexpr const char* sourcesDirectory = "sources/";
+        static constexpr const char* packageStatusFile = "sources/status";
+        static constexpr const char* sourcesFingerprintFile = "sources/fingerprint";
         static char validJsonPayload[];
+
+        static void WritePackageStatus(const std::string& content)
+        {
+            std::ofstream statusFile(packageStatusFile);
+            statusFile << content;
+            statusFile.close();
+        }
     };
 
     PmcTestImpl* PmcTests::testModule;
@@ -114,8 +123,7 @@ namespace OSConfig::Platform::Tests
         const std::map<std::string, std::tuple<int, std::string>> textResults =
         {
             {"apt-get update", std::tuple<int, std::string>(0, "")},
-            {"apt-get install cowsay=3.03+dfsg2-7:1 sl -y --allow-downgrades --auto-remove", std::tuple<int, std::string>(0, "")},
-            {"apt-get install bar- -y --allow-downgrades --auto-remove", std::tuple<int, std::string>(0, "")}
+            {"apt-get install cowsay=3.03+dfsg2-7:1 sl bar- -y --allow-downgrades --auto-remove", std::tuple<int, std::string>(0, "")}
         };
         const std::string testFileToDeletePath = sourcesDirectory + std::string("sourceToDelete.list");
         const std::string testData = "test data";
@@ -156,12 +164,12 @@ namespace OSConfig::Platform::Tests
         const std::map<std::string, std::tuple<int, std::string>> textResults =
         {
             {"apt-get update", std::tuple<int, std::string>(0, "")},
-            {"apt-get install cowsay=3.03+dfsg2-7:1 sl -y --allow-downgrades --auto-remove", std::tuple<int, std::string>(0, "")},
-            {"apt-get install bar- -y --allow-downgrades --auto-remove", std::tuple<int, std::string>(0, "")},
-            {"apt-cache policy cowsay | grep Installed", std::tuple<int, std::string>(0, "  Installed: 3.03+dfsg2-7:1 ")},
-            {"apt-cache policy sl | grep Installed", std::tuple<int, std::string>(0, "  Installed: 5.02-1 ")},
-            {"apt-cache policy bar | grep Installed", std::tuple<int, std::string>(0, "  Installed: (none) ")},
+            {"apt-get install cowsay=3.03+dfsg2-7:1 sl bar- -y --allow-downgrades --auto-remove", std::tuple<int, std::string>(0, "")},
         };
+        const std::string packageStatus =
+            "Package: cowsay\nStatus: install ok installed\nVersion: 3.03+dfsg2-7:1\n\n"
+            "Package: sl\nStatus: install ok installed\nArchitecture: amd64\nVersion: 5.02-1\n\n"
+            "Package: bar\nStatus: deinstall ok config-files\nVersion: 1.0\n";
         char reportedJsonPayload[] = "{\"packagesFingerprint\":\"25abefbfdb34fd48872dea4e2339f2a17e395196945c77a6c7098c203b87fca4\","
             "\"packages\":[\"cowsay=3.03+dfsg2-7:1\",\"sl=5.02-1\",\"bar=(none)\"],"
             "\"executionState\":2,\"executionSubstate\":0,\"executionSubstateDetails\":\"\","
@@ -171,6 +179,7 @@ namespace OSConfig::Platform::Tests
         MMI_JSON_STRING payload = nullptr;
         int status;
         testModule->SetTextResult(textResults);
+        WritePackageStatus(packageStatus);
 
         status = testModule->Set(componentName, desiredObjectName, validJsonPayload, strlen(validJsonPayload));
         EXPECT_EQ(status, MMI_OK);
@@ -182,15 +191,58 @@ namespace OSConfig::Platform::Tests
         ASSERT_STREQ(reportedJsonPayload, payloadString.c_str());
     }
 
+    TEST_F(PmcTests, MultiArchSetGet)
+    {
+        char multiArchJsonPayload[] = "{\"packages\":[\"libc6 libc6:i386 fonts-dejavu-core\"]}";
+        const std::map<std::string, std::tuple<int, std::string>> textResults =
+        {
+            {"apt-get update", std::tuple<int, std::string>(0, "")},
+            {"apt-get install libc6 libc6:i386 fonts-dejavu-core -y --allow-downgrades --auto-remove", std::tuple<int, std::string>(0, "")},
+        };
+        const std::string packageStatus =
+            "Package: dpkg\nStatus: install ok installed\nArchitecture: amd64\nVersion: 1.21.1\n\n"
+            "Package: libc6\nStatus: install ok installed\nArchitecture: amd64\nVersion: 2.35-0ubuntu3.1\n\n"
+            "Package: libc6\nStatus: install ok installed\nArchitecture: i386\nVersion: 2.35-0ubuntu3\n\n"
+            "Package: fonts-dejavu-core\nStatus: install ok installed\nArchitecture: all\nVersion: 2.37-2build1\n";
+        int payloadSizeBytes = 0;
+        MMI_JSON_STRING payload = nullptr;
+        int status;
+        testModule->SetTextResult(textResults);
+        WritePackageStatus(packageStatus);
+
+        status = testModule->Set(componentName, desiredObjectName, multiArchJsonPayload, strlen(multiArchJsonPayload));
+        EXPECT_EQ(status, MMI_OK);
+
+        status = testModule->Get(componentName, reportedObjectName, &payload, &payloadSizeBytes);
+        EXPECT_EQ(status, MMI_OK);
+
+        // Each instance of a multi-arch package keeps its own version
+        std::string payloadString(payload, payloadSizeBytes);
+        EXPECT_NE(std::string::npos, payloadString.find("\"packages\":[\"libc6=2.35-0ubuntu3.1\",\"libc6:i386=2.35-0ubuntu3\",\"fonts-dejavu-core=2.37-2build1\"]"));
+    }
+
+    TEST_F(PmcTests, ValidSetInBatches)
+    {
+        char batchesJsonPayload[] = "{\"packages\":[\"p1 p2\", \"p3 p4\", \"p5\", \"p6 p7-\"]}";
+        const std::map<std::string, std::tuple<int, std::string>> textResults =
+        {
+            {"apt-get update", std::tuple<int, std::string>(0, "")},
+            {"apt-get install p1 p2 p3 p4 p5 -y --allow-downgrades --auto-remove", std::tuple<int, std::string>(0, "")},
+            {"apt-get install p6 p7- -y --allow-downgrades --auto-remove", std::tuple<int, std::string>(0, "")},
+        };
+        testModule->SetTextResult(textResults);
+
+        // Each batch is one apt transaction with its own timeout
+        EXPECT_EQ(MMI_OK, testModule->Set(componentName, desiredObjectName, batchesJsonPayload, strlen(batchesJsonPayload)));
+    }
+
     TEST_F(PmcTests, SetGetUpdatingPackagesSourcesFailure)
     {
         const std::map<std::string, std::tuple<int, std::string>> textResults =
         {
             {"apt-get update", std::tuple<int, std::string>(EBUSY, "")},
-            {"apt-cache policy cowsay | grep Installed", std::tuple<int, std::string>(0, "  Installed: (none) ")},
-            {"apt-cache policy sl | grep Installed", std::tuple<int, std::string>(0, "  Installed: (none) ")},
-            {"apt-cache policy bar | grep Installed", std::tuple<int, std::string>(0, "  Installed: (none) ")},
         };
+        const std::string packageStatus = "Package: foo\nStatus: install ok installed\nVersion: 1.0\n";
         char reportedJsonPayload[] = "{\"packagesFingerprint\":\"25abefbfdb34fd48872dea4e2339f2a17e395196945c77a6c7098c203b87fca4\","
             "\"packages\":[\"cowsay=(none)\",\"sl=(none)\",\"bar=(none)\"],"
             "\"executionState\":3,\"executionSubstate\":8,\"executionSubstateDetails\":\"\","
@@ -200,6 +252,7 @@ namespace OSConfig::Platform::Tests
         MMI_JSON_STRING payload = nullptr;
         int status;
         testModule->SetTextResult(textResults);
+        WritePackageStatus(packageStatus);
 
         status = testModule->Set(componentName, desiredObjectName, validJsonPayload, strlen(validJsonPayload));
         EXPECT_EQ(status, EBUSY);
@@ -216,20 +269,19 @@ namespace OSConfig::Platform::Tests
         const std::map<std::string, std::tuple<int, std::string>> textResults =
         {
             {"apt-get update", std::tuple<int, std::string>(0, "")},
-            {"apt-get install cowsay=3.03+dfsg2-7:1 sl -y --allow-downgrades --auto-remove", std::tuple<int, std::string>(ETIME,"")},
-            {"apt-cache policy cowsay | grep Installed", std::tuple<int, std::string>(0, "  Installed: (none) ")},
-            {"apt-cache policy sl | grep Installed", std::tuple<int, std::string>(0, "  Installed: (none) ")},
-            {"apt-cache policy bar | grep Installed", std::tuple<int, std::string>(0, "  Installed: (none) ")},
+            {"apt-get install cowsay=3.03+dfsg2-7:1 sl bar- -y --allow-downgrades --auto-remove", std::tuple<int, std::string>(ETIME,"")},
         };
+        const std::string packageStatus = "Package: foo\nStatus: install ok installed\nVersion: 1.0\n";
         char reportedJsonPayload[] = "{\"packagesFingerprint\":\"25abefbfdb34fd48872dea4e2339f2a17e395196945c77a6c7098c203b87fca4\","
             "\"packages\":[\"cowsay=(none)\",\"sl=(none)\",\"bar=(none)\"],"
-            "\"executionState\":4,\"executionSubstate\":9,\"executionSubstateDetails\":\"cowsay=3.03+dfsg2-7:1 sl\","
+            "\"executionState\":4,\"executionSubstate\":9,\"executionSubstateDetails\":\"cowsay=3.03+dfsg2-7:1 sl bar-\","
             "\"sourcesFingerprint\":\"e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b877\","
             "\"sourcesFilenames\":[\"key.list\"]}";
         int payloadSizeBytes = 0;
         MMI_JSON_STRING payload = nullptr;
         int status;
         testModule->SetTextResult(textResults);
+        WritePackageStatus(packageStatus);
 
         status = testModule->Set(componentName, desiredObjectName, validJsonPayload, strlen(validJsonPayload));
         EXPECT_EQ(status, ETIME);
@@ -241,6 +293,145 @@ namespace OSConfig::Platform::Tests
         ASSERT_STREQ(reportedJsonPayload, payloadString.c_str());
     }
 
+    TEST_F(PmcTests, SetGetPackageInstallationFailureAttributedToPackage)
+    {
+        const std::map<std::string, std::tuple<int, std::string>> textResults =
+        {
+            {"apt-get update", std::tuple<int, std::string>(0, "")},
+            {"apt-get install cowsay=3.03+dfsg2-7:1 sl bar- -y --allow-downgrades --auto-remove", std::tuple<int, std::string>(100, "")},
+            {"apt-get install -s cowsay=3.03+dfsg2-7:1 sl -y --allow-downgrades --auto-remove", std::tuple<int, std::string>(0, "")},
+            {"apt-get install -s bar- -y --allow-downgrades --auto-remove", std::tuple<int, std::string>(100, "E: Unable to locate package bar")},
+        };
+        const std::string packageStatus = "Package: foo\nStatus: install ok installed\nVersion: 1.0\n";
+        char reportedJsonPayload[] = "{\"packagesFingerprint\":\"25abefbfdb34fd48872dea4e2339f2a17e395196945c77a6c7098c203b87fca4\","
+            "\"packages\":[\"cowsay=(none)\",\"sl=(none)\",\"bar=(none)\"],"
+            "\"executionState\":3,\"executionSubstate\":9,\"executionSubstateDetails\":\"bar-\","
+            "\"sourcesFingerprint\":\"e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b877\","
+            "\"sourcesFilenames\":[\"key.list\"]}";
+        int payloadSizeBytes = 0;
+        MMI_JSON_STRING payload = nullptr;
+        int status;
+        testModule->SetTextResult(textResults);
+        WritePackageStatus(packageStatus);
+
+        status = testModule->Set(componentName, desiredObjectName, validJsonPayload, strlen(validJsonPayload));
+        EXPECT_EQ(status, 100);
+
+        status = testModule->Get(componentName, reportedObjectName, &payload, &payloadSizeBytes);
+        EXPECT_EQ(status, MMI_OK);
+
+        std::string payloadString(payload, payloadSizeBytes);
+        ASSERT_STREQ(reportedJsonPayload, payloadString.c_str());
+        delete[] payload;
+    }
+
+    TEST_F(PmcTests, SetPackagesOneAtATimeAfterInstallationFailure)
+    {
+        const std::map<std::string, std::tuple<int, std::string>> textResults =
+        {
+            {"apt-get update", std::tuple<int, std::string>(0, "")},
+            {"apt-get install cowsay=3.03+dfsg2-7:1 sl bar- -y --allow-downgrades --auto-remove", std::tuple<int, std::string>(100, "")},
+            {"apt-get install -s cowsay=3.03+dfsg2-7:1 sl -y --allow-downgrades --auto-remove", std::tuple<int, std::string>(0, "")},
+            {"apt-get install -s bar- -y --allow-downgrades --auto-remove", std::tuple<int, std::string>(0, "")},
+            {"apt-get install cowsay=3.03+dfsg2-7:1 sl -y --allow-downgrades --auto-remove", std::tuple<int, std::string>(0, "")},
+            {"apt-get install bar- -y --allow-downgrades --auto-remove", std::tuple<int, std::string>(0, "")}
+        };
+        int status;
+        testModule->SetTextResult(textResults);
+
+        status = testModule->Set(componentName, desiredObjectName, validJsonPayload, strlen(validJsonPayload));
+        EXPECT_EQ(status, MMI_OK);
+    }
+
+    TEST_F(PmcTests, GetReportedPackagesAfterPackageStatusChanges)
+    {
+        const std::map<std::string, std::tuple<int, std::string>> textResults =
+        {
+            {"apt-get update", std::tuple<int, std::string>(0, "")},
+            {"apt-get install cowsay=3.03+dfsg2-7:1 sl bar- -y --allow-downgrades --auto-remove", std::tuple<int, std::string>(0, "")},
+        };
+        int payloadSizeBytes = 0;
+        MMI_JSON_STRING payload = nullptr;
+        int status;
+        testModule->SetTextResult(textResults);
+
+        status = testModule->Set(componentName, desiredObjectName, validJsonPayload, strlen(validJsonPayload));
+        EXPECT_EQ(status, MMI_OK);
+
+        status = testModule->Get(componentName, reportedObjectName, &payload, &payloadSizeBytes);
+        EXPECT_EQ(status, MMI_OK);
+        EXPECT_NE(std::string::npos, std::string(payload, payloadSizeBytes).find("\"packages\":[\"cowsay=(failed)\",\"sl=(failed)\",\"bar=(failed)\"]"));
+        delete[] payload;
+
+        WritePackageStatus("Package: cowsay\nStatus: install ok installed\nVersion: 3.03+dfsg2-7:1\n");
+        status = testModule->Get(componentName, reportedObjectName, &payload, &payloadSizeBytes);
+        EXPECT_EQ(status, MMI_OK);
+        EXPECT_NE(std::string::npos, std::string(payload, payloadSizeBytes).find("\"packages\":[\"cowsay=3.03+dfsg2-7:1\",\"sl=(none)\",\"bar=(none)\"]"));
+        delete[] payload;
+
+        WritePackageStatus("Package: cowsay\nStatus: install ok installed\nVersion: 3.04-1\n\nPackage: sl\nStatus: install ok unpacked\nVersion: 5.02-1\n");
+        status = testModule->Get(componentName, reportedObjectName, &payload, &payloadSizeBytes);
+        EXPECT_EQ(status, MMI_OK);
+        EXPECT_NE(std::string::npos, std::string(payload, payloadSizeBytes).find("\"packages\":[\"cowsay=3.04-1\",\"sl=5.02-1\",\"bar=(none)\"]"));
+        delete[] payload;
+    }
+
+    TEST_F(PmcTests, SetSkipsPackageListsRefreshWhenSourcesUnchanged)
+    {
+        const std::map<std::string, std::tuple<int, std::string>> textResults =
+        {
+            {"apt-get update", std::tuple<int, std::string>(0, "")},
+            {"apt-get install cowsay=3.03+dfsg2-7:1 sl bar- -y --allow-downgrades --auto-remove", std::tuple<int, std::string>(0, "")}
+        };
+        const std::map<std::string, std::tuple<int, std::string>> textResultsWithoutRefresh =
+        {
+            {"apt-get update", std::tuple<int, std::string>(EBUSY, "")},
+            {"apt-get install cowsay=3.03+dfsg2-7:1 sl bar- -y --allow-downgrades --auto-remove", std::tuple<int, std::string>(0, "")}
+        };
+        int status;
+
+        testModule->SetTextResult(textResults);
+        status = testModule->Set(componentName, desiredObjectName, validJsonPayload, strlen(validJsonPayload));
+        EXPECT_EQ(status, MMI_OK);
+        ASSERT_TRUE(FileExists(sourcesFingerprintFile));
+
+        testModule->SetTextResult(textResultsWithoutRefresh);
+        status = testModule->Set(componentName, desiredObjectName, validJsonPayload, strlen(validJsonPayload));
+        EXPECT_EQ(status, MMI_OK);
+    }
+
+    TEST_F(PmcTests, SetRefreshesOnlyChangedSource)
+    {
+        char changedSourceJsonPayload[] =
+        "{"
+            "\"packages\":[\"cowsay=3.03+dfsg2-7:1 sl\", \"bar-\"],"
+            "\"sources\":"
+            "{"
+                "\"key\":\"deb https://packages.microsoft.com/ubuntu/22.04/prod jammy main\""
+            "}"
+        "}";
+        const std::map<std::string, std::tuple<int, std::string>> textResults =
+        {
+            {"apt-get update", std::tuple<int, std::string>(0, "")},
+            {"apt-get install cowsay=3.03+dfsg2-7:1 sl bar- -y --allow-downgrades --auto-remove", std::tuple<int, std::string>(0, "")}
+        };
+        const std::map<std::string, std::tuple<int, std::string>> textResultsScopedRefresh =
+        {
+            {"apt-get update", std::tuple<int, std::string>(EBUSY, "")},
+            {"apt-get update -o Dir::Etc::sourcelist=sources/key.list -o Dir::Etc::sourceparts=- -o APT::Get::List-Cleanup=0", std::tuple<int, std::string>(0, "")},
+            {"apt-get install cowsay=3.03+dfsg2-7:1 sl bar- -y --allow-downgrades --auto-remove", std::tuple<int, std::string>(0, "")}
+        };
+        int status;
+
+        testModule->SetTextResult(textResults);
+        status = testModule->Set(componentName, desiredObjectName, validJsonPayload, strlen(validJsonPayload));
+        EXPECT_EQ(status, MMI_OK);
+
+        testModule->SetTextResult(textResultsScopedRefresh);
+        status = testModule->Set(componentName, desiredObjectName, changedSourceJsonPayload, strlen(changedSourceJsonPayload));
+        EXPECT_EQ(status, MMI_OK);
+    }
+
     TEST_F(PmcTests, InvalidPackageInputSet)
     {
         const std::map<std::string, std::tuple<int, std::string>> textResults;
@@ -17,14 +17,11 @@
 #define LOG_FILE "/var/log/osconfig_platform.log"
 #define ROLLED_LOG_FILE "/var/log/osconfig_platform.bak"
 
-#define COMMAND_LOGGING "CommandLogging"
-#define FULL_LOGGING "FullLogging"
-
 static unsigned int g_lastTime = 0;
 
 extern OSCONFIG_LOG_HANDLE g_platformLog;
 
-extern char g_mpiCall[MPI_CALL_MESSAGE_LENGTH];
+extern __thread char g_mpiCall[MPI_CALL_MESSAGE_LENGTH];
 
 // All signals on which we want the agent to cleanup before terminating process.
 // SIGKILL is omitted to allow a clean and immediate process kill if needed.
@@ -42,7 +39,8 @@ static int g_stopSignals[] = {
     SIGTSTP  //20
 };
 
-static int g_stopSignal = 0;
+// Only set by the signal handlers, the main loop logs the signal once it stops
+static volatile sig_atomic_t g_stopSignal = 0;
 static int g_refreshSignal = 0;
 
 #define EOL_TERMINATOR "\n"
@@ -84,12 +82,14 @@ static void SignalInterrupt(int signal)
     }
     else
     {
-        OsConfigLogInfo(g_platformLog, "Interrupt signal (%d)", signal);
         g_stopSignal = signal;
     }
 
     if (NULL != errorMessage)
     {
+        // Lines still queued for the log writer thread would be lost with the process
+        FlushLogOnCrash(g_platformLog);
+
         if (0 < (logDescriptor = open(LOG_FILE, O_APPEND | O_WRONLY | O_NONBLOCK)))
         {
             if (0 < (writeResult = write(logDescriptor, (const void*)errorMessage, strlen(errorMessage))))
@@ -160,37 +160,6 @@ static void PlatformDoWork(void)
     }
 }
 
-static bool IsLoggingEnabledInJsonConfig(const char* jsonString, const char* loggingSetting)
-{
-    bool result = false;
-    JSON_Value* rootValue = NULL;
-    JSON_Object* rootObject = NULL;
-
-    if (NULL != jsonString)
-    {
-        if (NULL != (rootValue = json_parse_string(jsonString)))
-        {
-            if (NULL != (rootObject = json_value_get_object(rootValue)))
-            {
-                result = (0 == (int)json_object_get_number(rootObject, loggingSetting)) ? false : true;
-            }
-            json_value_free(rootValue);
-        }
-    }
-
-    return result;
-}
-
-bool IsCommandLoggingEnabledInJsonConfig(const char* jsonString)
-{
-    return IsLoggingEnabledInJsonConfig(jsonString, COMMAND_LOGGING);
-}
-
-bool IsFullLoggingEnabledInJsonConfig(const char* jsonString)
-{
-    return IsLoggingEnabledInJsonConfig(jsonString, FULL_LOGGING);
-}
-
 int main(int argc, char *argv[])
 {
     UNUSED(argc);
@@ -204,6 +173,7 @@ int main(int argc, char *argv[])
     {
         SetCommandLogging(IsCommandLoggingEnabledInJsonConfig(jsonConfiguration));
         SetFullLogging(IsFullLoggingEnabledInJsonConfig(jsonConfiguration));
+        SetMillisecondLogging(IsMillisecondLoggingEnabledInJsonConfig(jsonConfiguration));
         FREE_MEMORY(jsonConfiguration);
     }
 
@@ -240,7 +210,8 @@ int main(int argc, char *argv[])
         }
     }
 
-    OsConfigLogInfo(GetPlatformLog(), "OSConfig Platform (PID: %d) exiting with %d", pid, g_stopSignal);
+    OsConfigLogInfo(GetPlatformLog(), "Interrupt signal (%d)", (int)g_stopSignal);
+    OsConfigLogInfo(GetPlatformLog(), "OSConfig Platform (PID: %d) exiting with %d", pid, (int)g_stopSignal);
 
     TerminatePlatform();
     CloseLog(&g_platformLog);
@@ -22,6 +22,7 @@ static const char g_mmiGetInfoVersionPatch[] = "VersionPatch";
 static const char g_mmiGetInfoVersionTweak[] = "VersionTweak";
 static const char g_mmiGetInfoVersionInfo[] = "VersionInfo";
 static const char g_mmiGetInfoComponents[] = "Components";
+static const char g_mmiGetInfoDependencies[] = "Dependencies";
 static const char g_mmiGetInfoLifetime[] = "Lifetime";
 static const char g_mmiGetInfoLicenseUri[] = "LicenseUri";
 static const char g_mmiGetInfoProjectUri[] = "ProjectUri";
@@ -33,7 +34,13 @@ ManagementModule::ManagementModule() : ManagementModule("") {}
 
 ManagementModule::ManagementModule(const std::string path) :
     m_modulePath(path),
-    m_handle(nullptr)
+    m_handle(nullptr),
+    m_mmiGetInfo(nullptr),
+    m_mmiOpen(nullptr),
+    m_mmiClose(nullptr),
+    m_mmiSet(nullptr),
+    m_mmiGet(nullptr),
+    m_mmiFree(nullptr)
 {
     m_info.lifetime = Lifetime::Undefined;
     m_info.userAccount= 0;
@@ -123,6 +130,8 @@ int ManagementModule::Load()
         OsConfigLogError(GetPlatformLog(), "Failed to load module '%s'", m_modulePath.c_str());
         if (nullptr != m_handle)
         {
+            std::lock_guard<std::mutex> lock(m_mmiMutex);
+            ClearMmiFunctions();
             dlclose(m_handle);
             m_handle = nullptr;
         }
@@ -133,18 +142,44 @@ int ManagementModule::Load()
 
 void ManagementModule::Unload()
 {
+    // Waits for any MMI call still in progress, for example from a GetReported that gave up on this module,
+    // and leaves nothing to call into the unloaded code for calls that arrive after it
+    std::lock_guard<std::mutex> lock(m_mmiMutex);
+
     if (nullptr != m_handle)
     {
+        ClearMmiFunctions();
         dlclose(m_handle);
         m_handle = nullptr;
     }
 }
 
+void ManagementModule::ClearMmiFunctions()
+{
+    m_mmiGetInfo = nullptr;
+    m_mmiOpen = nullptr;
+    m_mmiClose = nullptr;
+    m_mmiSet = nullptr;
+    m_mmiGet = nullptr;
+    m_mmiFree = nullptr;
+}
+
 ManagementModule::Info ManagementModule::GetInfo() const
 {
     return m_info;
 }
 
+bool ManagementModule::BeginReported()
+{
+    bool inFlight = false;
+    return m_reportedInFlight.compare_exchange_strong(inFlight, true);
+}
+
+void ManagementModule::EndReported()
+{
+    m_reportedInFlight = false;
+}
+
 int ManagementModule::CallMmiGetInfo(const char* clientName, MMI_JSON_STRING* payload, int* payloadSizeBytes)
 {
     return (nullptr != m_mmiGetInfo) ? m_mmiGetInfo(clientName, payload, payloadSizeBytes) : EINVAL;
@@ -192,6 +227,14 @@ int ManagementModule::CallMmiGet(MMI_HANDLE handle, const char* componentName, c
     return status;
 }
 
+void ManagementModule::CallMmiFree(MMI_JSON_STRING payload)
+{
+    if ((nullptr != m_mmiFree) && (nullptr != payload))
+    {
+        m_mmiFree(payload);
+    }
+}
+
 int ManagementModule::Info::Deserialize(const rapidjson::Value& object, ManagementModule::Info& info)
 {
     int status = 0;
@@ -375,6 +418,29 @@ int ManagementModule::Info::Deserialize(const rapidjson::Value& object, Manageme
 
     // Optional fields
 
+    // Dependencies
+    if (object.HasMember(g_mmiGetInfoDependencies))
+    {
+        if (object[g_mmiGetInfoDependencies].IsArray())
+        {
+            for (auto& dependency : object[g_mmiGetInfoDependencies].GetArray())
+            {
+                if (dependency.IsString())
+                {
+                    info.dependencies.push_back(dependency.GetString());
+                }
+                else
+                {
+                    OsConfigLogError(GetPlatformLog(), "Module info field '%s' is not a string", g_mmiGetInfoDependencies);
+                }
+            }
+        }
+        else
+        {
+            OsConfigLogError(GetPlatformLog(), "Module info field '%s' is not an array", g_mmiGetInfoDependencies);
+        }
+    }
+
     // Version Patch
     if (object.HasMember(g_mmiGetInfoVersionPatch))
     {
@@ -461,6 +527,8 @@ int MmiSession::Open()
 
     if (nullptr != m_module)
     {
+        std::lock_guard<std::mutex> lock(m_module->m_mmiMutex);
+
         if (nullptr == m_mmiHandle)
         {
             if (nullptr == (m_mmiHandle = m_module->CallMmiOpen(m_clientName.c_str(), m_maxPayloadSizeBytes)))
@@ -493,6 +561,8 @@ void MmiSession::Close()
 {
     if (nullptr != m_module)
     {
+        std::lock_guard<std::mutex> lock(m_module->m_mmiMutex);
+
         if (nullptr != m_mmiHandle)
         {
             m_module->CallMmiClose(m_mmiHandle);
@@ -503,12 +573,47 @@ void MmiSession::Close()
 
 int MmiSession::Set(const char* componentName, const char* objectName, const MMI_JSON_STRING payload, const int payloadSizeBytes)
 {
-    return (nullptr != m_module) ? m_module->CallMmiSet(m_mmiHandle, componentName, objectName, payload, payloadSizeBytes) : EINVAL;
+    if (nullptr == m_module)
+    {
+        return EINVAL;
+    }
+
+    std::lock_guard<std::mutex> lock(m_module->m_mmiMutex);
+    return m_module->CallMmiSet(m_mmiHandle, componentName, objectName, payload, payloadSizeBytes);
 }
 
 int MmiSession::Get(const char* componentName, const char* objectName, MMI_JSON_STRING *payload, int *payloadSizeBytes)
 {
-    return (nullptr != m_module) ? m_module->CallMmiGet(m_mmiHandle, componentName, objectName, payload, payloadSizeBytes) : EINVAL;
+    if (nullptr == m_module)
+    {
+        return EINVAL;
+    }
+
+    std::lock_guard<std::mutex> lock(m_module->m_mmiMutex);
+    return m_module->CallMmiGet(m_mmiHandle, componentName, objectName, payload, payloadSizeBytes);
+}
+
+// Payloads returned by Get are allocated by the module and must be released by it
+void MmiSession::Free(MMI_JSON_STRING payload)
+{
+    if (nullptr != m_module)
+    {
+        std::lock_guard<std::mutex> lock(m_module->m_mmiMutex);
+        m_module->CallMmiFree(payload);
+    }
+}
+
+bool MmiSession::BeginReported()
+{
+    return (nullptr != m_module) ? m_module->BeginReported() : false;
+}
+
+void MmiSession::EndReported()
+{
+    if (nullptr != m_module)
+    {
+        m_module->EndReported();
+    }
 }
 
 ManagementModule::Info MmiSession::GetInfo()
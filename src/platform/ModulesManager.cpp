@@ -8,16 +8,25 @@
 
 static const std::string g_moduleDir = "/usr/lib/osconfig";
 static const std::string g_moduleExtension = ".so";
+static const std::string g_mimExtension = ".json";
 
 static const std::string g_configJson = "/etc/osconfig/osconfig.json";
 static const char g_configReported[] = "Reported";
 static const char g_configComponentName[] = "ComponentName";
 static const char g_configObjectName[] = "ObjectName";
+static const char g_configCacheSeconds[] = "CacheSeconds";
+static const char g_configPrettyPrintReported[] = "PrettyPrintReported";
+static const char g_configMimDirectory[] = "MimDirectory";
+static const char g_mpiGetManyStatus[] = "Status";
+static const char g_mpiGetManyPayload[] = "Payload";
 
 #define UUID_LENGTH 36
+#define REPORTED_TIMEOUT_SECONDS 30
+#define DESIRED_WORKER_THREADS 4
 
 static ModulesManager modulesManager;
 static std::map<std::string, std::shared_ptr<MpiSession>> g_sessions;
+static std::mutex g_sessionsMutex;
 
 static bool g_modulesLoaded = false;
 
@@ -31,6 +40,8 @@ void AreModulesLoadedAndLoadIfNot()
 
 void UnloadModules()
 {
+    std::lock_guard<std::mutex> lock(g_sessionsMutex);
+
     for (auto& session : g_sessions)
     {
         session.second->Close();
@@ -40,6 +51,22 @@ void UnloadModules()
     modulesManager.UnloadModules();
 }
 
+// Sessions are looked up under the lock and used outside of it, so calls from different MPI server workers can run concurrently
+static std::shared_ptr<MpiSession> FindSession(MPI_HANDLE handle)
+{
+    std::shared_ptr<MpiSession> session;
+    std::string uuid = reinterpret_cast<const char*>(handle);
+    std::lock_guard<std::mutex> lock(g_sessionsMutex);
+
+    auto found = g_sessions.find(uuid);
+    if (found != g_sessions.end())
+    {
+        session = found->second;
+    }
+
+    return session;
+}
+
 void MpiInitialize(void)
 {
     MpiServerInitialize();
@@ -76,6 +103,7 @@ MPI_HANDLE MpiOpen(
         if ((nullptr != session) && (0 == session->Open()))
         {
             char* uuid = session->GetUuid();
+            std::lock_guard<std::mutex> lock(g_sessionsMutex);
             g_sessions[uuid] = session;
             handle = reinterpret_cast<MPI_HANDLE>(uuid);
         }
@@ -96,12 +124,22 @@ void MpiClose(MPI_HANDLE handle)
 {
     if (nullptr != handle)
     {
+        std::shared_ptr<MpiSession> session;
         std::string uuid = reinterpret_cast<const char*>(handle);
 
-        if (g_sessions.find(uuid) != g_sessions.end())
         {
-            g_sessions[uuid]->Close();
-            g_sessions.erase(uuid);
+            std::lock_guard<std::mutex> lock(g_sessionsMutex);
+            auto found = g_sessions.find(uuid);
+            if (found != g_sessions.end())
+            {
+                session = found->second;
+                g_sessions.erase(found);
+            }
+        }
+
+        if (nullptr != session)
+        {
+            session->Close();
         }
     }
     else
@@ -121,11 +159,11 @@ int MpiSet(
 
     if (nullptr != handle)
     {
-        std::string uuid = reinterpret_cast<const char*>(handle);
+        std::shared_ptr<MpiSession> session = FindSession(handle);
 
-        if (g_sessions.find(uuid) != g_sessions.end())
+        if (nullptr != session)
         {
-            status = g_sessions[uuid]->Set(componentName, objectName, payload, payloadSizeBytes);
+            status = session->Set(componentName, objectName, payload, payloadSizeBytes);
         }
         else
         {
@@ -153,11 +191,11 @@ int MpiGet(
 
     if (nullptr != handle)
     {
-        std::string uuid = reinterpret_cast<const char*>(handle);
+        std::shared_ptr<MpiSession> session = FindSession(handle);
 
-        if (g_sessions.find(uuid) != g_sessions.end())
+        if (nullptr != session)
         {
-            status = g_sessions[uuid]->Get(componentName, objectName, payload, payloadSizeBytes);
+            status = session->Get(componentName, objectName, payload, payloadSizeBytes);
         }
         else
         {
@@ -183,11 +221,11 @@ int MpiSetDesired(
 
     if (nullptr != handle)
     {
-        std::string uuid = reinterpret_cast<const char*>(handle);
+        std::shared_ptr<MpiSession> session = FindSession(handle);
 
-        if (g_sessions.find(uuid) != g_sessions.end())
+        if (nullptr != session)
         {
-            status = g_sessions[uuid]->SetDesired(payload, payloadSizeBytes);
+            status = session->SetDesired(payload, payloadSizeBytes);
         }
         else
         {
@@ -213,11 +251,11 @@ int MpiGetReported(
 
     if (nullptr != handle)
     {
-        std::string uuid = reinterpret_cast<const char*>(handle);
+        std::shared_ptr<MpiSession> session = FindSession(handle);
 
-        if (g_sessions.find(uuid) != g_sessions.end())
+        if (nullptr != session)
         {
-            status = g_sessions[uuid]->GetReported(payload, payloadSizeBytes);
+            status = session->GetReported(payload, payloadSizeBytes);
         }
         else
         {
@@ -234,12 +272,441 @@ int MpiGetReported(
     return status;
 }
 
+int MpiGetMany(
+    MPI_HANDLE handle,
+    const MPI_JSON_STRING objects,
+    const int objectsSizeBytes,
+    MPI_JSON_STRING* payload,
+    int* payloadSizeBytes)
+{
+    int status = MPI_OK;
+
+    if (nullptr != handle)
+    {
+        std::shared_ptr<MpiSession> session = FindSession(handle);
+
+        if (nullptr != session)
+        {
+            status = session->GetMany(objects, objectsSizeBytes, payload, payloadSizeBytes);
+        }
+        else
+        {
+            OsConfigLogError(GetPlatformLog(), "MpiGetMany called with an invalid handle: %p ('%s')", handle, reinterpret_cast<char*>(handle));
+            status = EINVAL;
+        }
+    }
+    else
+    {
+        OsConfigLogError(GetPlatformLog(), "MpiGetMany called with invalid null handle");
+        status = EINVAL;
+    }
+
+    return status;
+}
+
 void MpiFree(MPI_JSON_STRING payload)
 {
     delete[] payload;
 }
 
-ModulesManager::ModulesManager() {}
+ReportedCache::ReportedCache() :
+    m_hits(0),
+    m_misses(0) {}
+
+void ReportedCache::SetTimeToLive(const std::string& componentName, const std::string& objectName, std::chrono::milliseconds timeToLive)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_timeToLive[{componentName, objectName}] = timeToLive;
+}
+
+bool ReportedCache::Get(const std::string& componentName, const std::string& objectName, std::string& payload, unsigned long long& generation)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::pair<std::string, std::string> key(componentName, objectName);
+
+    generation = m_generations[componentName];
+
+    if (m_timeToLive.find(key) == m_timeToLive.end())
+    {
+        return false;
+    }
+
+    auto entry = m_entries.find(key);
+    if ((entry != m_entries.end()) && (std::chrono::steady_clock::now() < entry->second.expires))
+    {
+        payload = entry->second.payload;
+        m_hits++;
+        return true;
+    }
+
+    m_misses++;
+    return false;
+}
+
+void ReportedCache::Put(const std::string& componentName, const std::string& objectName, const std::string& payload, unsigned long long generation)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::pair<std::string, std::string> key(componentName, objectName);
+    auto timeToLive = m_timeToLive.find(key);
+
+    // Drop payloads read before the component was last invalidated
+    if ((timeToLive != m_timeToLive.end()) && (m_generations[componentName] == generation))
+    {
+        m_entries[key] = {payload, std::chrono::steady_clock::now() + timeToLive->second};
+    }
+}
+
+void ReportedCache::Invalidate(const std::string& componentName)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_generations[componentName]++;
+
+    for (auto entry = m_entries.begin(); entry != m_entries.end();)
+    {
+        entry = (entry->first.first == componentName) ? m_entries.erase(entry) : std::next(entry);
+    }
+}
+
+void ReportedCache::Clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (auto& entry : m_entries)
+    {
+        m_generations[entry.first.first]++;
+    }
+
+    m_entries.clear();
+}
+
+unsigned long long ReportedCache::GetHits()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_hits;
+}
+
+unsigned long long ReportedCache::GetMisses()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_misses;
+}
+
+// Translates the MIM schema of a setting into the equivalent JSON schema, returns false for MIM schemas not understood
+static bool MimToJsonSchema(const rapidjson::Value& mimSchema, rapidjson::Value& jsonSchema, rapidjson::Document::AllocatorType& allocator)
+{
+    bool result = true;
+    std::string type;
+
+    jsonSchema.SetObject();
+
+    if (mimSchema.IsString())
+    {
+        type = mimSchema.GetString();
+        if (("string" == type) || ("integer" == type) || ("boolean" == type))
+        {
+            rapidjson::Value typeValue(type.c_str(), allocator);
+            jsonSchema.AddMember("type", typeValue, allocator);
+        }
+        else
+        {
+            result = false;
+        }
+    }
+    else if (mimSchema.IsObject())
+    {
+        // Objects are described by their fields alone, without a type
+        type = (mimSchema.HasMember("type") && mimSchema["type"].IsString()) ? mimSchema["type"].GetString() : "object";
+
+        if (("enum" == type) && mimSchema.HasMember("valueSchema") && mimSchema.HasMember("enumValues") && mimSchema["enumValues"].IsArray())
+        {
+            // Only the listed values are accepted, not any value of the value schema
+            rapidjson::Value values(rapidjson::kArrayType);
+            result = MimToJsonSchema(mimSchema["valueSchema"], jsonSchema, allocator);
+
+            for (auto& enumValue : mimSchema["enumValues"].GetArray())
+            {
+                if (enumValue.IsObject() && enumValue.HasMember("enumValue"))
+                {
+                    rapidjson::Value value;
+                    value.CopyFrom(enumValue["enumValue"], allocator);
+                    values.PushBack(value, allocator);
+                }
+                else
+                {
+                    result = false;
+                }
+            }
+
+            jsonSchema.AddMember("enum", values, allocator);
+        }
+        else if (("array" == type) && mimSchema.HasMember("elementSchema"))
+        {
+            rapidjson::Value items;
+            result = MimToJsonSchema(mimSchema["elementSchema"], items, allocator);
+
+            jsonSchema.AddMember("type", "array", allocator);
+            jsonSchema.AddMember("items", items, allocator);
+        }
+        else if (("map" == type) && mimSchema.HasMember("mapValue") && mimSchema["mapValue"].IsObject() && mimSchema["mapValue"].HasMember("schema"))
+        {
+            // A null value removes its key from the map
+            rapidjson::Value value;
+            rapidjson::Value nullValue(rapidjson::kObjectType);
+            rapidjson::Value anyOf(rapidjson::kArrayType);
+            rapidjson::Value additionalProperties(rapidjson::kObjectType);
+            result = MimToJsonSchema(mimSchema["mapValue"]["schema"], value, allocator);
+
+            nullValue.AddMember("type", "null", allocator);
+            anyOf.PushBack(value, allocator);
+            anyOf.PushBack(nullValue, allocator);
+            additionalProperties.AddMember("anyOf", anyOf, allocator);
+
+            jsonSchema.AddMember("type", "object", allocator);
+            jsonSchema.AddMember("additionalProperties", additionalProperties, allocator);
+        }
+        else if (("object" == type) && mimSchema.HasMember("fields") && mimSchema["fields"].IsArray())
+        {
+            // Fields are all optional, as a payload may set only some of them
+            rapidjson::Value properties(rapidjson::kObjectType);
+
+            for (auto& field : mimSchema["fields"].GetArray())
+            {
+                rapidjson::Value property;
+
+                if (field.IsObject() && field.HasMember("name") && field["name"].IsString() && field.HasMember("schema") && MimToJsonSchema(field["schema"], property, allocator))
+                {
+                    rapidjson::Value name(field["name"].GetString(), allocator);
+                    properties.AddMember(name, property, allocator);
+                }
+                else
+                {
+                    result = false;
+                }
+            }
+
+            jsonSchema.AddMember("type", "object", allocator);
+            jsonSchema.AddMember("properties", properties, allocator);
+        }
+        else
+        {
+            result = false;
+        }
+    }
+    else
+    {
+        result = false;
+    }
+
+    return result;
+}
+
+int MimSchemas::Add(const std::string& mimJson)
+{
+    int status = MPI_OK;
+    rapidjson::Document document;
+
+    if (document.Parse(mimJson.c_str()).HasParseError() || !document.IsObject() || !document.HasMember("contents") || !document["contents"].IsArray())
+    {
+        OsConfigLogError(GetPlatformLog(), "Unable to parse MIM model");
+        return EINVAL;
+    }
+
+    for (auto& component : document["contents"].GetArray())
+    {
+        if (!component.IsObject() || !component.HasMember("name") || !component["name"].IsString() || !component.HasMember("contents") || !component["contents"].IsArray())
+        {
+            continue;
+        }
+
+        std::string componentName = component["name"].GetString();
+
+        for (auto& object : component["contents"].GetArray())
+        {
+            // Only desired objects are ever passed to MpiSet
+            if (!object.IsObject() || !object.HasMember("name") || !object["name"].IsString() || !object.HasMember("desired") || !object["desired"].IsBool() || !object["desired"].GetBool() || !object.HasMember("schema"))
+            {
+                continue;
+            }
+
+            std::string objectName = object["name"].GetString();
+            rapidjson::Document jsonSchema;
+
+            if (MimToJsonSchema(object["schema"], jsonSchema, jsonSchema.GetAllocator()))
+            {
+                // The JSON schema is no longer needed once compiled
+                std::shared_ptr<rapidjson::SchemaDocument> schema = std::make_shared<rapidjson::SchemaDocument>(jsonSchema);
+
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_schemas[{componentName, objectName}] = schema;
+            }
+            else
+            {
+                OsConfigLogError(GetPlatformLog(), "Unsupported MIM schema for %s.%s, its payloads are not checked", componentName.c_str(), objectName.c_str());
+                status = EINVAL;
+            }
+        }
+    }
+
+    return status;
+}
+
+int MimSchemas::Load(const std::string& mimDirectory)
+{
+    int status = MPI_OK;
+    DIR* dir = nullptr;
+    struct dirent* ent = nullptr;
+
+    if (nullptr == (dir = opendir(mimDirectory.c_str())))
+    {
+        OsConfigLogError(GetPlatformLog(), "Unable to open MIM directory: %s", mimDirectory.c_str());
+        return ENOENT;
+    }
+
+    while (nullptr != (ent = readdir(dir)))
+    {
+        std::string fileName = mimDirectory + "/" + ent->d_name;
+
+        if ((fileName.length() > g_mimExtension.length()) && (0 == fileName.compare(fileName.length() - g_mimExtension.length(), g_mimExtension.length(), g_mimExtension)))
+        {
+            std::ifstream ifs(fileName);
+            std::stringstream mimJson;
+            mimJson << ifs.rdbuf();
+
+            if (MPI_OK != Add(mimJson.str()))
+            {
+                OsConfigLogError(GetPlatformLog(), "Unable to load all of MIM: %s", fileName.c_str());
+                status = EINVAL;
+            }
+        }
+    }
+
+    closedir(dir);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    OsConfigLogInfo(GetPlatformLog(), "Loaded MIM validators for %u desired objects from: %s", (unsigned int)m_schemas.size(), mimDirectory.c_str());
+
+    return status;
+}
+
+void MimSchemas::Clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_schemas.clear();
+}
+
+bool MimSchemas::IsValid(const std::string& componentName, const std::string& objectName, const char* payload, const int payloadSizeBytes)
+{
+    bool isValid = true;
+    std::shared_ptr<rapidjson::SchemaDocument> schema;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto entry = m_schemas.find({componentName, objectName});
+        if (entry != m_schemas.end())
+        {
+            schema = entry->second;
+        }
+    }
+
+    // A compiled schema is immutable, each call validates with its own validator outside of the lock
+    if (nullptr != schema)
+    {
+        rapidjson::Document document;
+
+        if (document.Parse(payload, payloadSizeBytes).HasParseError())
+        {
+            isValid = false;
+        }
+        else
+        {
+            rapidjson::SchemaValidator validator(*schema);
+            isValid = document.Accept(validator);
+        }
+    }
+
+    return isValid;
+}
+
+TaskPool::TaskPool(unsigned int maxWorkerThreads) :
+    m_maxWorkerThreads(maxWorkerThreads),
+    m_idleWorkerThreads(0),
+    m_stopping(false) {}
+
+TaskPool::~TaskPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+
+    m_condition.notify_all();
+
+    for (auto& workerThread : m_workerThreads)
+    {
+        workerThread.join();
+    }
+}
+
+bool TaskPool::Push(std::function<void()> task)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    // Another thread is only started when all running ones are busy
+    if ((m_idleWorkerThreads <= m_tasks.size()) && (m_workerThreads.size() < m_maxWorkerThreads))
+    {
+        try
+        {
+            m_workerThreads.emplace_back(&TaskPool::WorkerThread, this);
+        }
+        catch (const std::system_error& e)
+        {
+            OsConfigLogError(GetPlatformLog(), "Unable to start a worker thread (%s)", e.what());
+        }
+    }
+
+    if (m_workerThreads.empty())
+    {
+        return false;
+    }
+
+    m_tasks.push(std::move(task));
+    lock.unlock();
+    m_condition.notify_one();
+
+    return true;
+}
+
+void TaskPool::WorkerThread()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true)
+    {
+        m_idleWorkerThreads++;
+        m_condition.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+        m_idleWorkerThreads--;
+
+        if (m_tasks.empty())
+        {
+            break;
+        }
+
+        std::function<void()> task = std::move(m_tasks.front());
+        m_tasks.pop();
+
+        lock.unlock();
+        task();
+        lock.lock();
+    }
+}
+
+ModulesManager::ModulesManager() :
+    m_reportedTimeout(std::chrono::seconds(REPORTED_TIMEOUT_SECONDS)),
+    m_reportedCache(std::make_shared<ReportedCache>()),
+    m_prettyPrintReported(false),
+    m_mimSchemas(std::make_shared<MimSchemas>()),
+    m_desiredPool(DESIRED_WORKER_THREADS) {}
 
 ModulesManager::~ModulesManager()
 {
@@ -352,6 +819,18 @@ int ModulesManager::SetReportedObjects(const std::string& configJson)
     {
         int index = 0;
         std::set<std::pair<std::string, std::string>> objects;
+
+        if (document.HasMember(g_configPrettyPrintReported) && document[g_configPrettyPrintReported].IsBool())
+        {
+            m_prettyPrintReported = document[g_configPrettyPrintReported].GetBool();
+        }
+
+        // Failing to load the MIM only turns the validation off for the objects affected
+        if (document.HasMember(g_configMimDirectory) && document[g_configMimDirectory].IsString())
+        {
+            m_mimSchemas->Load(document[g_configMimDirectory].GetString());
+        }
+
         for (auto& reported : document[g_configReported].GetArray())
         {
             if (reported.IsObject())
@@ -371,6 +850,18 @@ int ModulesManager::SetReportedObjects(const std::string& configJson)
                         objects.insert({componentName, objectName});
                         m_reportedComponents[componentName].push_back(objectName);
                     }
+
+                    if (reported.HasMember(g_configCacheSeconds))
+                    {
+                        if (reported[g_configCacheSeconds].IsUint())
+                        {
+                            m_reportedCache->SetTimeToLive(componentName, objectName, std::chrono::seconds(reported[g_configCacheSeconds].GetUint()));
+                        }
+                        else
+                        {
+                            OsConfigLogError(GetPlatformLog(), "'%s' at index %d is not a non-negative integer, not caching %s.%s", g_configCacheSeconds, index, componentName.c_str(), objectName.c_str());
+                        }
+                    }
                 }
                 else
                 {
@@ -413,12 +904,36 @@ void ModulesManager::UnloadModules()
     }
 
     m_modules.clear();
+    m_reportedCache->Clear();
+    m_mimSchemas->Clear();
+
+    std::lock_guard<std::mutex> lock(m_desiredHashesMutex);
+    m_desiredHashes.clear();
 }
 
-static char* GenerateUuid()
+bool ModulesManager::IsDesiredApplied(const std::string& componentName, const std::string& objectName, size_t payloadHash)
 {
-    char* uuid = NULL;
-    static const char uuidTemplate[] = "xxxxxxxx-xxxx-Mxxx-Nxxx-xxxxxxxxxxxx";
+    std::lock_guard<std::mutex> lock(m_desiredHashesMutex);
+    auto applied = m_desiredHashes.find({componentName, objectName});
+    return (applied != m_desiredHashes.end()) && (applied->second == payloadHash);
+}
+
+void ModulesManager::SetDesiredApplied(const std::string& componentName, const std::string& objectName, size_t payloadHash)
+{
+    std::lock_guard<std::mutex> lock(m_desiredHashesMutex);
+    m_desiredHashes[{componentName, objectName}] = payloadHash;
+}
+
+void ModulesManager::ForgetDesiredApplied(const std::string& componentName, const std::string& objectName)
+{
+    std::lock_guard<std::mutex> lock(m_desiredHashesMutex);
+    m_desiredHashes.erase({componentName, objectName});
+}
+
+static char* GenerateUuid()
+{
+    char* uuid = NULL;
+    static const char uuidTemplate[] = "xxxxxxxx-xxxx-Mxxx-Nxxx-xxxxxxxxxxxx";
     const char* hex = "0123456789ABCDEF-";
 
     uuid = (char*)malloc(UUID_LENGTH + 1);
@@ -587,12 +1102,21 @@ int MpiSession::Set(const char* componentName, const char* objectName, const MPI
         OsConfigLogError(GetPlatformLog(), "MpiSet invalid payloadSizeBytes: %d", payloadSizeBytes);
         status = EINVAL;
     }
+    else if (!m_modulesManager.m_mimSchemas->IsValid(componentName, objectName, payload, payloadSizeBytes))
+    {
+        OsConfigLogError(GetPlatformLog(), "MpiSet payload does not match the MIM of %s.%s", componentName, objectName);
+        status = EINVAL;
+    }
     else
     {
         std::shared_ptr<MmiSession> moduleSession;
         if (nullptr != (moduleSession = GetSession(componentName)))
         {
             status = moduleSession->Set(componentName, objectName, (MMI_JSON_STRING)payload, payloadSizeBytes);
+            m_modulesManager.m_reportedCache->Invalidate(componentName);
+
+            // The object no longer necessarily holds the last desired payload, so the next desired configuration applies it again
+            m_modulesManager.ForgetDesiredApplied(componentName, objectName);
         }
         else
         {
@@ -663,9 +1187,10 @@ int MpiSession::Get(const char* componentName, const char* objectName, MPI_JSON_
     return status;
 }
 
-int MpiSession::SetDesired(const MPI_JSON_STRING payload, int payloadSizeBytes)
+int MpiSession::SetDesired(const MPI_JSON_STRING payload, int payloadSizeBytes, ComponentResults* componentResults)
 {
     int status = MPI_OK;
+    ComponentResults results;
 
     ScopeGuard sg{[&]()
     {
@@ -717,63 +1242,224 @@ int MpiSession::SetDesired(const MPI_JSON_STRING payload, int payloadSizeBytes)
         }
         else
         {
-            status = SetDesiredPayload(document);
+            status = SetDesiredPayload(document, results);
+
+            for (auto& result : results)
+            {
+                if (MPI_OK != result.second)
+                {
+                    OsConfigLogError(GetPlatformLog(), "MpiSetDesired component %s returned %d", result.first.c_str(), result.second);
+                }
+                else if (IsFullLoggingEnabled())
+                {
+                    OsConfigLogInfo(GetPlatformLog(), "MpiSetDesired component %s returned %d", result.first.c_str(), result.second);
+                }
+            }
         }
     }
 
+    if (nullptr != componentResults)
+    {
+        *componentResults = results;
+    }
+
     return status;
 }
 
-int MpiSession::SetDesiredPayload(rapidjson::Document& document)
+int MpiSession::SetDesiredPayload(rapidjson::Document& document, ComponentResults& componentResults)
 {
     int status = MPI_OK;
 
+    // Components are grouped per module, in document order, as calls into a module are serialized anyway
+    std::vector<std::shared_ptr<MmiSession>> modules;
+    std::map<std::shared_ptr<MmiSession>, std::vector<const rapidjson::Value::Member*>> moduleComponents;
+    std::map<std::string, std::shared_ptr<MmiSession>> componentModules;
+
     for (auto& component : document.GetObject())
     {
-        if (component.value.IsObject())
+        std::string componentName = component.name.GetString();
+        std::shared_ptr<MmiSession> module;
+
+        if (!component.value.IsObject())
         {
-            std::string componentName = component.name.GetString();
-            std::shared_ptr<MmiSession> module;
+            status = EINVAL;
+            componentResults[componentName] = EINVAL;
+            if (IsFullLoggingEnabled())
+            {
+                OsConfigLogError(GetPlatformLog(), "Component value is not an object");
+            }
+        }
+        else if (nullptr == (module = GetSession(componentName)))
+        {
+            status = EINVAL;
+            componentResults[componentName] = EINVAL;
+            if (IsFullLoggingEnabled())
+            {
+                OsConfigLogError(GetPlatformLog(), "Unable to find module for component %s", componentName.c_str());
+            }
+        }
+        else
+        {
+            if (moduleComponents.find(module) == moduleComponents.end())
+            {
+                modules.push_back(module);
+            }
+
+            moduleComponents[module].push_back(&component);
+            componentModules[componentName] = module;
+        }
+    }
+
+    // A module waits for the modules owning the components it depends on, when those are part of this desired configuration
+    std::map<std::shared_ptr<MmiSession>, std::set<std::shared_ptr<MmiSession>>> moduleDependencies;
+
+    for (auto& module : modules)
+    {
+        for (auto& dependency : module->GetInfo().dependencies)
+        {
+            auto dependencyModule = componentModules.find(dependency);
+            if ((dependencyModule != componentModules.end()) && (dependencyModule->second != module))
+            {
+                moduleDependencies[module].insert(dependencyModule->second);
+            }
+        }
+    }
+
+    // Modules are started in dependency order, so that the futures a module waits for already exist
+    std::vector<std::shared_ptr<MmiSession>> order;
+    std::set<std::shared_ptr<MmiSession>> ordered;
+
+    while (order.size() < modules.size())
+    {
+        bool progress = false;
+
+        for (auto& module : modules)
+        {
+            std::set<std::shared_ptr<MmiSession>>& dependencies = moduleDependencies[module];
 
-            if (nullptr != (module = GetSession(componentName)))
+            if ((ordered.find(module) == ordered.end()) && std::all_of(dependencies.begin(), dependencies.end(), [&ordered](const std::shared_ptr<MmiSession>& dependency) { return ordered.find(dependency) != ordered.end(); }))
             {
-                for (auto& object : component.value.GetObject())
+                order.push_back(module);
+                ordered.insert(module);
+                progress = true;
+            }
+        }
+
+        if (!progress)
+        {
+            // Break a dependency cycle at the first module left, in document order
+            for (auto& module : modules)
+            {
+                if (ordered.find(module) == ordered.end())
                 {
-                    int moduleStatus = MMI_OK;
-                    std::string objectName = object.name.GetString();
+                    OsConfigLogError(GetPlatformLog(), "Module '%s' waits on a dependency cycle, applying it without waiting for its dependencies", module->GetInfo().name.c_str());
+                    moduleDependencies[module].clear();
+                    break;
+                }
+            }
+        }
+    }
 
-                    rapidjson::StringBuffer buffer;
-                    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-                    object.value.Accept(writer);
+    // Tasks are pushed in dependency order and the pool starts them in that order, so a task only ever waits on tasks already running
+    std::map<std::shared_ptr<MmiSession>, std::shared_future<ComponentResults>> pending;
 
-                    moduleStatus = module->Set(componentName.c_str(), objectName.c_str(), (MMI_JSON_STRING)buffer.GetString(), buffer.GetSize());
+    for (auto& module : order)
+    {
+        std::vector<std::shared_future<ComponentResults>> dependencies;
+        for (auto& dependency : moduleDependencies[module])
+        {
+            dependencies.push_back(pending[dependency]);
+        }
 
-                    if ((moduleStatus != MMI_OK) && IsFullLoggingEnabled())
-                    {
-                        OsConfigLogError(GetPlatformLog(), "MmiSet(%s, %s, %s, %d) to %s returned %d", componentName.c_str(), objectName.c_str(), buffer.GetString(), static_cast<int>(buffer.GetSize()), module->GetInfo().name.c_str(), moduleStatus);
-                    }
+        std::shared_ptr<std::promise<ComponentResults>> promise = std::make_shared<std::promise<ComponentResults>>();
+        pending[module] = promise->get_future().share();
+
+        std::vector<const rapidjson::Value::Member*> components = moduleComponents[module];
+        std::function<void()> task = [this, promise, module, components, dependencies]()
+        {
+            for (auto& dependency : dependencies)
+            {
+                dependency.wait();
+            }
+
+            promise->set_value(SetDesiredComponents(module, components));
+        };
+
+        if (!m_modulesManager.m_desiredPool.Push(task))
+        {
+            OsConfigLogError(GetPlatformLog(), "No worker thread for module '%s', applying it inline", module->GetInfo().name.c_str());
+            task();
+        }
+    }
+
+    for (auto& module : pending)
+    {
+        ComponentResults moduleResults = module.second.get();
+        componentResults.insert(moduleResults.begin(), moduleResults.end());
+    }
+
+    return status;
+}
+
+MpiSession::ComponentResults MpiSession::SetDesiredComponents(std::shared_ptr<MmiSession> module, const std::vector<const rapidjson::Value::Member*>& components)
+{
+    ComponentResults componentResults;
+
+    for (auto& component : components)
+    {
+        std::string componentName = component->name.GetString();
+        int componentStatus = MMI_OK;
+        bool componentChanged = false;
+
+        for (auto& object : component->value.GetObject())
+        {
+            int moduleStatus = MMI_OK;
+            std::string objectName = object.name.GetString();
+
+            rapidjson::StringBuffer buffer;
+            rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+            object.value.Accept(writer);
+
+            // Only objects that changed since they were last applied are sent to the module
+            size_t payloadHash = HashString(buffer.GetString());
+            if (m_modulesManager.IsDesiredApplied(componentName, objectName, payloadHash))
+            {
+                if (IsFullLoggingEnabled())
+                {
+                    OsConfigLogInfo(GetPlatformLog(), "MmiSet(%s, %s) skipped, desired payload unchanged", componentName.c_str(), objectName.c_str());
                 }
+                continue;
+            }
+
+            moduleStatus = module->Set(componentName.c_str(), objectName.c_str(), (MMI_JSON_STRING)buffer.GetString(), buffer.GetSize());
+            componentChanged = true;
+
+            if (MMI_OK == moduleStatus)
+            {
+                m_modulesManager.SetDesiredApplied(componentName, objectName, payloadHash);
             }
             else
             {
-                status = EINVAL;
+                componentStatus = (MMI_OK == componentStatus) ? moduleStatus : componentStatus;
+                m_modulesManager.ForgetDesiredApplied(componentName, objectName);
+
                 if (IsFullLoggingEnabled())
                 {
-                    OsConfigLogError(GetPlatformLog(), "Unable to find module for component %s", componentName.c_str());
+                    OsConfigLogError(GetPlatformLog(), "MmiSet(%s, %s, %s, %d) to %s returned %d", componentName.c_str(), objectName.c_str(), buffer.GetString(), static_cast<int>(buffer.GetSize()), module->GetInfo().name.c_str(), moduleStatus);
                 }
             }
         }
-        else
+
+        // Reported objects of a component may change with any of its desired objects
+        if (componentChanged)
         {
-            status = EINVAL;
-            if (IsFullLoggingEnabled())
-            {
-                OsConfigLogError(GetPlatformLog(), "Component value is not an object");
-            }
+            m_modulesManager.m_reportedCache->Invalidate(componentName);
         }
+
+        componentResults[componentName] = componentStatus;
     }
 
-    return status;
+    return componentResults;
 }
 
 int MpiSession::GetReported(MPI_JSON_STRING* payload, int* payloadSizeBytes)
@@ -815,41 +1501,119 @@ int MpiSession::GetReported(MPI_JSON_STRING* payload, int* payloadSizeBytes)
     return status;
 }
 
-int MpiSession::GetReportedPayload(MPI_JSON_STRING* payload, int* payloadSizeBytes)
+// Reads one reported object from the cache when it holds a fresh copy, otherwise from the module
+static int GetReportedObject(ReportedCache& cache, std::shared_ptr<MmiSession> module, const std::string& componentName, const std::string& objectName, std::string& payload)
 {
-    int status = MPI_OK;
-    rapidjson::Document document;
-    rapidjson::Document::AllocatorType& allocator = document.GetAllocator();
-    document.SetObject();
+    char* objectPayload = nullptr;
+    int objectPayloadSizeBytes = 0;
+    int moduleStatus = MMI_OK;
+    unsigned long long generation = 0;
 
-    for (auto reported : m_modulesManager.m_reportedComponents)
+    if (cache.Get(componentName, objectName, payload, generation))
     {
-        std::string componentName = reported.first;
-        std::vector<std::string> objectNames = reported.second;
-        std::shared_ptr<MmiSession> module = GetSession(componentName);
+        return MMI_OK;
+    }
+
+    moduleStatus = module->Get(componentName.c_str(), objectName.c_str(), &objectPayload, &objectPayloadSizeBytes);
+
+    if ((MMI_OK == moduleStatus) && (nullptr != objectPayload) && (0 < objectPayloadSizeBytes))
+    {
+        payload.assign(objectPayload, objectPayloadSizeBytes);
+        cache.Put(componentName, objectName, payload, generation);
+    }
+    else
+    {
+        payload.clear();
+        moduleStatus = (MMI_OK == moduleStatus) ? EINVAL : moduleStatus;
+    }
+
+    module->Free(objectPayload);
+
+    return moduleStatus;
+}
+
+// Validates a module payload with a SAX pass, without building a document, and returns the type of its root value
+static bool IsValidJsonPayload(const std::string& payload, rapidjson::Type& type)
+{
+    rapidjson::Reader reader;
+    rapidjson::StringStream stream(payload.c_str());
+    rapidjson::BaseReaderHandler<> handler;
+
+    if ((nullptr != std::memchr(payload.data(), 0, payload.size())) || reader.Parse(stream, handler).IsError())
+    {
+        return false;
+    }
 
-        if ((nullptr != module) && !objectNames.empty())
+    switch (payload[payload.find_first_not_of(" \t\r\n")])
+    {
+        case '{':
+            type = rapidjson::kObjectType;
+            break;
+        case '[':
+            type = rapidjson::kArrayType;
+            break;
+        case '"':
+            type = rapidjson::kStringType;
+            break;
+        case 't':
+            type = rapidjson::kTrueType;
+            break;
+        case 'f':
+            type = rapidjson::kFalseType;
+            break;
+        case 'n':
+            type = rapidjson::kNullType;
+            break;
+        default:
+            type = rapidjson::kNumberType;
+    }
+
+    return true;
+}
+
+// Splices an already validated payload into the output as is
+static void WriteJsonPayload(rapidjson::Writer<rapidjson::StringBuffer>& writer, const std::string& payload, rapidjson::Type type)
+{
+    writer.RawValue(payload.c_str(), payload.size(), type);
+}
+
+// Streams an already validated payload through the writer, so that it is indented along with the rest
+static void WriteJsonPayload(rapidjson::PrettyWriter<rapidjson::StringBuffer>& writer, const std::string& payload, rapidjson::Type)
+{
+    rapidjson::Reader reader;
+    rapidjson::StringStream stream(payload.c_str());
+    reader.Parse(stream, writer);
+}
+
+// Writes the reported results in configuration order, independent of which module finished first
+template <typename Writer>
+static void WriteReportedResults(Writer& writer, const std::map<std::string, std::vector<std::string>>& reportedComponents, const MpiSession::ReportedResults& results)
+{
+    writer.StartObject();
+
+    for (auto& reported : reportedComponents)
+    {
+        const std::string& componentName = reported.first;
+        auto componentResults = results.find(componentName);
+
+        if (componentResults != results.end())
         {
-            rapidjson::Value component(rapidjson::kObjectType);
-            for (auto& objectName : objectNames)
-            {
-                char* objectPayload = nullptr;
-                int objectPayloadSizeBytes = 0;
-                int moduleStatus = MMI_OK;
+            writer.Key(componentName.c_str(), static_cast<rapidjson::SizeType>(componentName.size()));
+            writer.StartObject();
 
-                moduleStatus = module->Get(componentName.c_str(), objectName.c_str(), &objectPayload, &objectPayloadSizeBytes);
+            for (size_t i = 0; (i < reported.second.size()) && (i < componentResults->second.size()); i++)
+            {
+                const std::string& objectName = reported.second[i];
+                int moduleStatus = componentResults->second[i].first;
+                const std::string& objectPayloadString = componentResults->second[i].second;
+                rapidjson::Type type = rapidjson::kNullType;
 
-                if ((MMI_OK == moduleStatus) && (nullptr != objectPayload) && (0 < objectPayloadSizeBytes))
+                if (MMI_OK == moduleStatus)
                 {
-                    std::string objectPayloadString(objectPayload, objectPayloadSizeBytes);
-                    rapidjson::Document objectDocument;
-                    objectDocument.Parse(objectPayloadString.c_str());
-
-                    if (!objectDocument.HasParseError())
+                    if (IsValidJsonPayload(objectPayloadString, type))
                     {
-                        rapidjson::Value object(rapidjson::kObjectType);
-                        object.CopyFrom(objectDocument, allocator);
-                        component.AddMember(rapidjson::Value(objectName.c_str(), allocator), object, allocator);
+                        writer.Key(objectName.c_str(), static_cast<rapidjson::SizeType>(objectName.size()));
+                        WriteJsonPayload(writer, objectPayloadString, type);
                     }
                     else if (IsFullLoggingEnabled())
                     {
@@ -861,16 +1625,124 @@ int MpiSession::GetReportedPayload(MPI_JSON_STRING* payload, int* payloadSizeByt
                     OsConfigLogError(GetPlatformLog(), "MmiGet(%s, %s) returned %d", componentName.c_str(), objectName.c_str(), moduleStatus);
                 }
             }
-            document.AddMember(rapidjson::Value(componentName.c_str(), allocator), component, allocator);
+
+            writer.EndObject();
+        }
+    }
+
+    writer.EndObject();
+}
+
+// Reads the reported objects of the given components, in order, from one module
+static MpiSession::ReportedResults GetReportedFromModule(std::shared_ptr<ReportedCache> cache, std::shared_ptr<MmiSession> module, const std::map<std::string, std::vector<std::string>>& components)
+{
+    MpiSession::ReportedResults results;
+
+    for (auto& component : components)
+    {
+        std::vector<std::pair<int, std::string>>& objects = results[component.first];
+
+        for (auto& objectName : component.second)
+        {
+            std::string objectPayload;
+            int moduleStatus = GetReportedObject(*cache, module, component.first, objectName, objectPayload);
+            objects.emplace_back(moduleStatus, std::move(objectPayload));
+        }
+    }
+
+    return results;
+}
+
+int MpiSession::GetReportedPayload(MPI_JSON_STRING* payload, int* payloadSizeBytes)
+{
+    int status = MPI_OK;
+
+    // Fan out one task per module, as calls into a module are serialized anyway, so that the total time tracks the slowest module
+    std::map<std::shared_ptr<MmiSession>, std::map<std::string, std::vector<std::string>>> moduleComponents;
+    std::map<std::shared_ptr<MmiSession>, std::future<ReportedResults>> pending;
+    std::shared_ptr<ReportedCache> cache = m_modulesManager.m_reportedCache;
+    ReportedResults results;
+
+    for (auto& reported : m_modulesManager.m_reportedComponents)
+    {
+        std::shared_ptr<MmiSession> module = GetSession(reported.first);
+
+        if ((nullptr != module) && !reported.second.empty())
+        {
+            moduleComponents[module][reported.first] = reported.second;
+        }
+    }
+
+    for (auto& module : moduleComponents)
+    {
+        // A module still busy with the read of an earlier request is likely hung, it is skipped as if it timed out rather than given another thread
+        if (!module.first->BeginReported())
+        {
+            OsConfigLogError(GetPlatformLog(), "Module '%s' is still reporting for an earlier request, its objects are skipped", module.first->GetInfo().name.c_str());
+            continue;
+        }
+
+        // The task owns everything it touches, a module that misses the deadline finishes on its own and its results are dropped
+        std::shared_ptr<std::promise<ReportedResults>> promise = std::make_shared<std::promise<ReportedResults>>();
+        pending[module.first] = promise->get_future();
+
+        // The module is released before the results are handed over, so that the next request does not find it still busy
+        auto task = [promise, module, cache]()
+        {
+            ReportedResults moduleResults;
+            {
+                ScopeGuard sg{[&]() { module.first->EndReported(); }};
+                moduleResults = GetReportedFromModule(cache, module.first, module.second);
+            }
+            promise->set_value(std::move(moduleResults));
+        };
+
+        try
+        {
+            std::thread(task).detach();
         }
+        catch (const std::system_error& e)
+        {
+            OsConfigLogError(GetPlatformLog(), "Unable to start a thread for module '%s' (%s), reading it inline", module.first->GetInfo().name.c_str(), e.what());
+            task();
+        }
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + m_modulesManager.m_reportedTimeout;
+
+    for (auto& module : pending)
+    {
+        if (std::future_status::ready == module.second.wait_until(deadline))
+        {
+            ReportedResults moduleResults = module.second.get();
+            results.insert(moduleResults.begin(), moduleResults.end());
+        }
+        else
+        {
+            OsConfigLogError(GetPlatformLog(), "Module '%s' did not report within %d ms, its objects are skipped", module.first->GetInfo().name.c_str(), static_cast<int>(m_modulesManager.m_reportedTimeout.count()));
+        }
+    }
+
+    if (IsFullLoggingEnabled())
+    {
+        OsConfigLogInfo(GetPlatformLog(), "Reported object cache: %llu hits, %llu misses", cache->GetHits(), cache->GetMisses());
     }
 
     try
     {
         rapidjson::StringBuffer buffer;
-        rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
-        writer.SetIndent(' ', 2);
-        document.Accept(writer);
+
+        if (m_modulesManager.m_prettyPrintReported)
+        {
+            rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+            writer.SetIndent(' ', 2);
+            WriteReportedResults(writer, m_modulesManager.m_reportedComponents, results);
+        }
+        else
+        {
+            rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+            WriteReportedResults(writer, m_modulesManager.m_reportedComponents, results);
+        }
 
         *payloadSizeBytes = buffer.GetSize();
         *payload = new (std::nothrow) char[*payloadSizeBytes];
@@ -904,4 +1776,114 @@ int MpiSession::GetReportedPayload(MPI_JSON_STRING* payload, int* payloadSizeByt
     }
 
     return status;
-}
\ No newline at end of file
+}
+
+int MpiSession::GetMany(const MPI_JSON_STRING objects, const int objectsSizeBytes, MPI_JSON_STRING* payload, int* payloadSizeBytes)
+{
+    int status = MPI_OK;
+    rapidjson::Document document;
+
+    ScopeGuard sg{[&]()
+    {
+        if (IsFullLoggingEnabled())
+        {
+            if (MPI_OK == status)
+            {
+                OsConfigLogInfo(GetPlatformLog(), "MpiGetMany(%.*s, %d) returned %d", objectsSizeBytes, objects, objectsSizeBytes, status);
+            }
+            else
+            {
+                OsConfigLogError(GetPlatformLog(), "MpiGetMany(%.*s, %d) returned %d", objectsSizeBytes, objects, objectsSizeBytes, status);
+            }
+        }
+    }};
+
+    if ((nullptr == objects) || (0 >= objectsSizeBytes))
+    {
+        OsConfigLogError(GetPlatformLog(), "MpiGetMany invalid objects");
+        return (status = EINVAL);
+    }
+    else if ((nullptr == payload) || (nullptr == payloadSizeBytes))
+    {
+        OsConfigLogError(GetPlatformLog(), "MpiGetMany invalid payload or payloadSizeBytes");
+        return (status = EINVAL);
+    }
+
+    *payload = nullptr;
+    *payloadSizeBytes = 0;
+
+    if (document.Parse(objects, objectsSizeBytes).HasParseError() || !document.IsArray())
+    {
+        OsConfigLogError(GetPlatformLog(), "MpiGetMany objects is not a JSON array");
+        return (status = EINVAL);
+    }
+
+    for (auto& object : document.GetArray())
+    {
+        if (!object.IsObject() || !object.HasMember(g_configComponentName) || !object[g_configComponentName].IsString() ||
+            !object.HasMember(g_configObjectName) || !object[g_configObjectName].IsString())
+        {
+            OsConfigLogError(GetPlatformLog(), "MpiGetMany objects must all have string '%s' and '%s'", g_configComponentName, g_configObjectName);
+            return (status = EINVAL);
+        }
+    }
+
+    // Results are written in request order, so that the client can match them by index
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    writer.StartArray();
+
+    for (auto& object : document.GetArray())
+    {
+        const char* componentName = object[g_configComponentName].GetString();
+        const char* objectName = object[g_configObjectName].GetString();
+        std::shared_ptr<MmiSession> module = GetSession(componentName);
+        std::string objectPayload;
+        int moduleStatus = EINVAL;
+        rapidjson::Type objectType = rapidjson::kNullType;
+
+        if (nullptr != module)
+        {
+            moduleStatus = GetReportedObject(*m_modulesManager.m_reportedCache, module, componentName, objectName, objectPayload);
+
+            if ((MMI_OK == moduleStatus) && !IsValidJsonPayload(objectPayload, objectType))
+            {
+                if (IsFullLoggingEnabled())
+                {
+                    OsConfigLogError(GetPlatformLog(), "MmiGet(%s, %s) returned invalid payload", componentName, objectName);
+                }
+                moduleStatus = EINVAL;
+            }
+        }
+
+        writer.StartObject();
+        writer.Key(g_configComponentName);
+        writer.String(componentName);
+        writer.Key(g_configObjectName);
+        writer.String(objectName);
+        writer.Key(g_mpiGetManyStatus);
+        writer.Int(moduleStatus);
+        if (MMI_OK == moduleStatus)
+        {
+            writer.Key(g_mpiGetManyPayload);
+            WriteJsonPayload(writer, objectPayload, objectType);
+        }
+        writer.EndObject();
+    }
+
+    writer.EndArray();
+
+    *payloadSizeBytes = buffer.GetSize();
+    if (nullptr != (*payload = new (std::nothrow) char[*payloadSizeBytes]))
+    {
+        std::memcpy(*payload, buffer.GetString(), *payloadSizeBytes);
+    }
+    else
+    {
+        OsConfigLogError(GetPlatformLog(), "MpiGetMany unable to allocate %d bytes", *payloadSizeBytes);
+        *payloadSizeBytes = 0;
+        status = ENOMEM;
+    }
+
+    return status;
+}
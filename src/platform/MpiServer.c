@@ -4,17 +4,18 @@
 #include <PlatformCommon.h>
 #include <MpiServer.h>
 
-// 500 milliseconds
-#define MPI_WORKER_SLEEP 500
-
 #define MAX_CONTENTLENGTH_LENGTH 16
 #define MAX_ERROR_LENGTH 16
-#define MAX_QUEUED_CONNECTIONS 5
 #define MAX_REASONSTRING_LENGTH 32
 #define MAX_STATUS_CODE_LENGTH 3
+#define MAX_EPOLL_EVENTS 16
+
+// Keep-alive connections idle for longer are closed, the client reconnects on its next request
+#define IDLE_CONNECTION_TIMEOUT_SECONDS 60
 
 static const char* g_socketPrefix = "/run/osconfig";
 static const char* g_mpiSocket = "/run/osconfig/mpid.sock";
+static const char* g_configJson = "/etc/osconfig/osconfig.json";
 
 static const char* g_clientName = "ClientName";
 static const char* g_maxPayloadSizeBytes = "MaxPayloadSizeBytes";
@@ -22,15 +23,56 @@ static const char* g_clientSession = "ClientSession";
 static const char* g_componentName = "ComponentName";
 static const char* g_objectName = "ObjectName";
 static const char* g_payload = "Payload";
+static const char* g_objects = "Objects";
 
 static int g_socketfd = -1;
 static struct sockaddr_un g_socketaddr = {0};
 static socklen_t g_socketlen = 0;
 
-static pthread_t g_mpiServerWorker = 0;
-static bool g_serverActive = false;
+// Accepted connections waiting for a worker, bounded by the configured maximum number of queued connections
+typedef struct CONNECTION_QUEUE
+{
+    int* connections;
+    int capacity;
+    int count;
+    int head;
+    pthread_mutex_t mutex;
+    pthread_cond_t notEmpty;
+    pthread_cond_t notFull;
+} CONNECTION_QUEUE;
+
+static CONNECTION_QUEUE g_connectionQueue = {NULL, 0, 0, 0, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER};
+
+typedef struct OPEN_CONNECTION
+{
+    int socketHandle;
+
+    // Waiting in the epoll set for the next request, as opposed to queued or being served by a worker
+    bool idle;
+    time_t idleSince;
+} OPEN_CONNECTION;
+
+// All open client connections, including idle keep-alive ones, so that they can be dropped when idle for too long and on shutdown
+typedef struct CONNECTION_LIST
+{
+    OPEN_CONNECTION* connections;
+    int capacity;
+    int count;
+    pthread_mutex_t mutex;
+} CONNECTION_LIST;
+
+static CONNECTION_LIST g_openConnections = {NULL, 0, 0, PTHREAD_MUTEX_INITIALIZER};
+
+static int g_epollfd = -1;
+static int g_eventfd = -1;
+
+static pthread_t g_mpiServerAcceptor = 0;
+static pthread_t* g_mpiServerWorkers = NULL;
+static int g_numMpiServerWorkers = 0;
+static volatile bool g_serverActive = false;
 
-char g_mpiCall[MPI_CALL_MESSAGE_LENGTH] = {0};
+// Per worker thread so that the crash handler reports the call that was in progress on the faulting thread
+__thread char g_mpiCall[MPI_CALL_MESSAGE_LENGTH] = {0};
 static const char g_mpiCallObjectTemplate[] = " during %s to %s.%s\n";
 static const char g_mpiCallModelTemplate[] = " during %s\n";
 
@@ -156,6 +198,31 @@ static int CallMpiGetReported(MPI_HANDLE handle, MPI_JSON_STRING* payload, int*
     return status;
 }
 
+static int CallMpiGetMany(MPI_HANDLE handle, const MPI_JSON_STRING objects, const int objectsSize, MPI_JSON_STRING* payload, int* payloadSize)
+{
+    int status = MPI_OK;
+
+    snprintf(g_mpiCall, sizeof(g_mpiCall), g_mpiCallModelTemplate, MPI_GET_MANY_URI);
+
+    status = MpiGetMany((MPI_HANDLE)handle, objects, objectsSize, payload, payloadSize);
+
+    if (IsFullLoggingEnabled())
+    {
+        if (MPI_OK == status)
+        {
+            OsConfigLogInfo(GetPlatformLog(), "MpiGetMany request, session %p ('%s')", handle, (char*)handle);
+        }
+        else
+        {
+            OsConfigLogError(GetPlatformLog(), "MpiGetMany request, session %p ('%s'), failed: %d", handle, (char*)handle, status);
+        }
+    }
+
+    memset(g_mpiCall, 0, sizeof(g_mpiCall));
+
+    return status;
+}
+
 HTTP_STATUS SetErrorResponse(const char* uri, int mpiStatus, char** response, int* responseSize)
 {
     int size = 0;
@@ -296,7 +363,8 @@ HTTP_STATUS HandleMpiCall(const char* uri, const char* requestBody, char** respo
             (0 == strcmp(uri, MPI_SET_URI)) ||
             (0 == strcmp(uri, MPI_GET_URI)) ||
             (0 == strcmp(uri, MPI_SET_DESIRED_URI)) ||
-            (0 == strcmp(uri, MPI_GET_REPORTED_URI)))
+            (0 == strcmp(uri, MPI_GET_REPORTED_URI)) ||
+            (0 == strcmp(uri, MPI_GET_MANY_URI)))
         {
             if (NULL == (clientValue = json_object_get_value(rootObject, g_clientSession)))
             {
@@ -412,6 +480,29 @@ HTTP_STATUS HandleMpiCall(const char* uri, const char* requestBody, char** respo
                     status = SetErrorResponse(uri, mpiStatus, response, responseSize);
                 }
             }
+            else if (0 == strcmp(uri, MPI_GET_MANY_URI))
+            {
+                if (NULL == (payloadValue = json_object_get_value(rootObject, g_objects)))
+                {
+                    OsConfigLogError(GetPlatformLog(), "%s: failed to parse '%s' from request body", uri, g_objects);
+                    status = HTTP_BAD_REQUEST;
+                }
+                else if (JSONArray != json_value_get_type(payloadValue))
+                {
+                    OsConfigLogError(GetPlatformLog(), "%s: '%s' is not an array", uri, g_objects);
+                    status = HTTP_BAD_REQUEST;
+                }
+                else if (NULL == (payload = json_serialize_to_string(payloadValue)))
+                {
+                    OsConfigLogError(GetPlatformLog(), "%s: failed to get '%s' string", uri, g_objects);
+                    status = HTTP_BAD_REQUEST;
+                }
+                else if (MPI_OK != (mpiStatus = handlers.mpiGetMany((MPI_HANDLE)client, (MPI_JSON_STRING)payload, strlen(payload), response, responseSize)))
+                {
+                    OsConfigLogError(GetPlatformLog(), "%s: failed for client '%s' with %d (returning %d)", uri, client, mpiStatus, status);
+                    status = SetErrorResponse(uri, mpiStatus, response, responseSize);
+                }
+            }
         }
         else
         {
@@ -420,6 +511,11 @@ HTTP_STATUS HandleMpiCall(const char* uri, const char* requestBody, char** respo
         }
     }
 
+    if (NULL != payload)
+    {
+        json_free_serialized_string((char*)payload);
+    }
+
     json_value_free(rootValue);
 
     return status;
@@ -453,11 +549,14 @@ static char* HttpReasonAsString(HTTP_STATUS statusCode)
     return reason;
 }
 
-static void* MpiServerWorker(void* arguments)
+// Returns true when the client asked to keep the connection open and the request was served in full
+static bool HandleConnection(int socketHandle)
 {
-    const char* responseFormat = "HTTP/1.1 %d %s\r\nServer: OSConfig\r\nContent-Type: application/json\r\nContent-Length: %d\r\n\r\n%.*s";
+    const char* responseFormat = "HTTP/1.1 %d %s\r\nServer: OSConfig\r\nContent-Type: application/json\r\nConnection: %s\r\nContent-Length: %d\r\n\r\n%.*s";
+    const char* keepAliveValue = "keep-alive";
+    const char* closeValue = "close";
 
-    int socketHandle = -1;
+    HTTP_MESSAGE request = {0};
     char* uri = NULL;
     int contentLength = 0;
     char* requestBody = NULL;
@@ -469,6 +568,7 @@ static void* MpiServerWorker(void* arguments)
     int estimatedSize = 0;
     int actualSize = 0;
     ssize_t bytes = 0;
+    bool keepAlive = false;
 
     MPI_CALLS mpiCalls = {
         CallMpiOpen,
@@ -476,110 +576,553 @@ static void* MpiServerWorker(void* arguments)
         CallMpiSet,
         CallMpiGet,
         CallMpiSetDesired,
-        CallMpiGetReported
+        CallMpiGetReported,
+        CallMpiGetMany
     };
 
-    UNUSED(arguments);
+    if (0 != ReadHttpMessageFromSocket(socketHandle, &request, GetPlatformLog()))
+    {
+        OsConfigLogError(GetPlatformLog(), "Failed to read request %d", socketHandle);
+        status = HTTP_BAD_REQUEST;
+    }
+    else if (NULL == (uri = request.uri))
+    {
+        OsConfigLogError(GetPlatformLog(), "Failed to read request URI %d", socketHandle);
+        status = HTTP_BAD_REQUEST;
+    }
+    else
+    {
+        // The request stream cannot be trusted past a malformed request, so only a well formed one can keep the connection
+        keepAlive = request.keepAlive;
+        contentLength = request.contentLength;
+        requestBody = (contentLength > 0) ? request.body : NULL;
+    }
 
-    while (g_serverActive)
+    if (status == HTTP_OK)
+    {
+        if (IsFullLoggingEnabled())
+        {
+            OsConfigLogInfo(GetPlatformLog(), "%s: content-length %d, body, '%s'", uri, contentLength, requestBody);
+        }
+
+        status = HandleMpiCall(uri, requestBody, &responseBody, &responseSize, mpiCalls);
+    }
+
+    httpReason = HttpReasonAsString(status);
+    estimatedSize = strlen(responseFormat) + MAX_STATUS_CODE_LENGTH + strlen(httpReason) + strlen(keepAliveValue) + MAX_CONTENTLENGTH_LENGTH + responseSize + 1;
+
+    if (NULL != (buffer = (char*)malloc(estimatedSize)))
+    {
+        memset(buffer, 0, estimatedSize);
+
+        snprintf(buffer, estimatedSize, responseFormat, (int)status, httpReason, keepAlive ? keepAliveValue : closeValue, responseSize, responseSize, (responseBody ? responseBody : ""));
+        actualSize = (int)strlen(buffer);
+
+        // MSG_NOSIGNAL: a client that went away must not take the platform down with SIGPIPE
+        bytes = send(socketHandle, buffer, actualSize, MSG_NOSIGNAL);
+
+        if (bytes != actualSize)
+        {
+            OsConfigLogError(GetPlatformLog(), "%s: failed to write complete HTTP response, %d bytes of %d", uri, (int)bytes, actualSize);
+            keepAlive = false;
+        }
+    }
+    else
+    {
+        OsConfigLogError(GetPlatformLog(), "%s: failed to allocate memory for HTTP response, %d bytes of %d", uri, 0, estimatedSize);
+        keepAlive = false;
+    }
+
+    FreeHttpMessage(&request);
+    FREE_MEMORY(responseBody);
+    FREE_MEMORY(httpReason);
+    FREE_MEMORY(buffer);
+
+    return keepAlive;
+}
+
+static time_t GetMonotonicSeconds(void)
+{
+    struct timespec now = {0};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec;
+}
+
+// Called with the connection list locked
+static OPEN_CONNECTION* FindConnection(int socketHandle)
+{
+    int i = 0;
+
+    for (i = 0; i < g_openConnections.count; i++)
+    {
+        if (socketHandle == g_openConnections.connections[i].socketHandle)
+        {
+            return &g_openConnections.connections[i];
+        }
+    }
+
+    return NULL;
+}
+
+static bool TrackConnection(int socketHandle)
+{
+    OPEN_CONNECTION* connections = NULL;
+    bool result = true;
+
+    pthread_mutex_lock(&g_openConnections.mutex);
+
+    if (g_openConnections.count >= g_openConnections.capacity)
+    {
+        if (NULL != (connections = (OPEN_CONNECTION*)realloc(g_openConnections.connections, (g_openConnections.capacity + MAX_EPOLL_EVENTS) * sizeof(OPEN_CONNECTION))))
+        {
+            g_openConnections.connections = connections;
+            g_openConnections.capacity += MAX_EPOLL_EVENTS;
+        }
+        else
+        {
+            OsConfigLogError(GetPlatformLog(), "Failed to allocate memory to track connection '%d'", socketHandle);
+            result = false;
+        }
+    }
+
+    if (result)
+    {
+        g_openConnections.connections[g_openConnections.count].socketHandle = socketHandle;
+        g_openConnections.connections[g_openConnections.count].idle = true;
+        g_openConnections.connections[g_openConnections.count].idleSince = GetMonotonicSeconds();
+        g_openConnections.count += 1;
+    }
+
+    pthread_mutex_unlock(&g_openConnections.mutex);
+
+    return result;
+}
+
+static void UntrackConnection(int socketHandle)
+{
+    int i = 0;
+
+    pthread_mutex_lock(&g_openConnections.mutex);
+
+    for (i = 0; i < g_openConnections.count; i++)
+    {
+        if (socketHandle == g_openConnections.connections[i].socketHandle)
+        {
+            g_openConnections.count -= 1;
+            g_openConnections.connections[i] = g_openConnections.connections[g_openConnections.count];
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&g_openConnections.mutex);
+}
+
+// Waits (once) for the next request on the connection
+static bool WatchConnection(int socketHandle, int operation)
+{
+    struct epoll_event event = {0};
+
+    event.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+    event.data.fd = socketHandle;
+
+    if (0 != epoll_ctl(g_epollfd, operation, socketHandle, &event))
+    {
+        OsConfigLogError(GetPlatformLog(), "Failed to watch connection '%d' on socket '%s' (%d)", socketHandle, g_mpiSocket, errno);
+        return false;
+    }
+
+    return true;
+}
+
+// True when the client closed its end, or the connection failed, instead of sending a new request
+static bool IsConnectionClosedByPeer(int socketHandle)
+{
+    char peek = 0;
+    ssize_t bytes = recv(socketHandle, &peek, sizeof(peek), MSG_PEEK | MSG_DONTWAIT);
+
+    return ((0 == bytes) || ((0 > bytes) && (EAGAIN != errno) && (EWOULDBLOCK != errno) && (EINTR != errno))) ? true : false;
+}
+
+static bool HasPendingRequest(int socketHandle)
+{
+    char peek = 0;
+    return (0 < recv(socketHandle, &peek, sizeof(peek), MSG_PEEK | MSG_DONTWAIT)) ? true : false;
+}
+
+// Marks the connection idle and waits for its next request, under the list lock so that it is not closed as idle before it is watched
+static bool IdleConnection(int socketHandle)
+{
+    OPEN_CONNECTION* connection = NULL;
+    bool result = false;
+
+    pthread_mutex_lock(&g_openConnections.mutex);
+
+    if (NULL != (connection = FindConnection(socketHandle)))
+    {
+        connection->idle = true;
+        connection->idleSince = GetMonotonicSeconds();
+
+        if (false == (result = WatchConnection(socketHandle, EPOLL_CTL_MOD)))
+        {
+            connection->idle = false;
+        }
+    }
+
+    pthread_mutex_unlock(&g_openConnections.mutex);
+
+    return result;
+}
+
+// Called when a request (or hang up) arrives, the connection is no longer idle until a worker is done with it
+static void BusyConnection(int socketHandle)
+{
+    OPEN_CONNECTION* connection = NULL;
+
+    pthread_mutex_lock(&g_openConnections.mutex);
+
+    if (NULL != (connection = FindConnection(socketHandle)))
+    {
+        connection->idle = false;
+    }
+
+    pthread_mutex_unlock(&g_openConnections.mutex);
+}
+
+// Closes keep-alive connections that had no request for longer than the idle timeout, so that idle clients do not hold on to connections
+static void CloseIdleConnections(void)
+{
+    OPEN_CONNECTION* connection = NULL;
+    time_t now = GetMonotonicSeconds();
+    int i = 0;
+
+    pthread_mutex_lock(&g_openConnections.mutex);
+
+    while (i < g_openConnections.count)
     {
-        status = HTTP_OK;
+        connection = &g_openConnections.connections[i];
 
-        if (0 <= (socketHandle = accept(g_socketfd, (struct sockaddr*)&g_socketaddr, &g_socketlen)))
+        // A request that arrived meanwhile is served rather than dropped
+        if (connection->idle && ((now - connection->idleSince) >= IDLE_CONNECTION_TIMEOUT_SECONDS) && (!HasPendingRequest(connection->socketHandle)))
         {
-            AreModulesLoadedAndLoadIfNot();
+            // Removing it from the epoll set also discards an event that is ready and not yet returned by epoll_wait
+            epoll_ctl(g_epollfd, EPOLL_CTL_DEL, connection->socketHandle, NULL);
 
             if (IsFullLoggingEnabled())
             {
-                OsConfigLogInfo(GetPlatformLog(), "Accepted connection: path %s, handle '%d'", g_socketaddr.sun_path, socketHandle);
+                OsConfigLogInfo(GetPlatformLog(), "Closing idle connection: path %s, handle '%d'", g_mpiSocket, connection->socketHandle);
             }
 
-            if (NULL == (uri = ReadUriFromSocket(socketHandle, GetPlatformLog())))
+            close(connection->socketHandle);
+
+            g_openConnections.count -= 1;
+            g_openConnections.connections[i] = g_openConnections.connections[g_openConnections.count];
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    pthread_mutex_unlock(&g_openConnections.mutex);
+}
+
+static void CloseConnection(int socketHandle)
+{
+    UntrackConnection(socketHandle);
+
+    if (0 != close(socketHandle))
+    {
+        OsConfigLogError(GetPlatformLog(), "Failed to close socket: path %s, handle '%d'", g_mpiSocket, socketHandle);
+    }
+
+    if (IsFullLoggingEnabled())
+    {
+        OsConfigLogInfo(GetPlatformLog(), "Closed connection: path %s, handle '%d'", g_mpiSocket, socketHandle);
+    }
+}
+
+// Blocks while the queue is full, leaving further connections in the listen backlog
+static bool EnqueueConnection(int socketHandle)
+{
+    bool queued = false;
+
+    pthread_mutex_lock(&g_connectionQueue.mutex);
+
+    while (g_serverActive && (g_connectionQueue.count >= g_connectionQueue.capacity))
+    {
+        pthread_cond_wait(&g_connectionQueue.notFull, &g_connectionQueue.mutex);
+    }
+
+    if (g_serverActive)
+    {
+        g_connectionQueue.connections[(g_connectionQueue.head + g_connectionQueue.count) % g_connectionQueue.capacity] = socketHandle;
+        g_connectionQueue.count += 1;
+        queued = true;
+
+        pthread_cond_signal(&g_connectionQueue.notEmpty);
+    }
+
+    pthread_mutex_unlock(&g_connectionQueue.mutex);
+
+    return queued;
+}
+
+// Returns -1 when the server is shutting down
+static int DequeueConnection(void)
+{
+    int socketHandle = -1;
+
+    pthread_mutex_lock(&g_connectionQueue.mutex);
+
+    while (g_serverActive && (0 == g_connectionQueue.count))
+    {
+        pthread_cond_wait(&g_connectionQueue.notEmpty, &g_connectionQueue.mutex);
+    }
+
+    if (g_serverActive)
+    {
+        socketHandle = g_connectionQueue.connections[g_connectionQueue.head];
+        g_connectionQueue.head = (g_connectionQueue.head + 1) % g_connectionQueue.capacity;
+        g_connectionQueue.count -= 1;
+
+        pthread_cond_signal(&g_connectionQueue.notFull);
+    }
+
+    pthread_mutex_unlock(&g_connectionQueue.mutex);
+
+    return socketHandle;
+}
+
+static void* MpiServerWorker(void* arguments)
+{
+    int socketHandle = -1;
+
+    UNUSED(arguments);
+
+    while (0 <= (socketHandle = DequeueConnection()))
+    {
+        if (IsConnectionClosedByPeer(socketHandle) || (!HandleConnection(socketHandle)) || (!g_serverActive) || (!IdleConnection(socketHandle)))
+        {
+            CloseConnection(socketHandle);
+        }
+    }
+
+    return NULL;
+}
+
+static void* MpiServerAcceptor(void* arguments)
+{
+    struct epoll_event events[MAX_EPOLL_EVENTS];
+    struct sockaddr_un socketAddress = {0};
+    socklen_t socketLength = 0;
+    int socketHandle = -1;
+    int numEvents = 0;
+    int i = 0;
+    time_t lastIdleCheck = GetMonotonicSeconds();
+
+    UNUSED(arguments);
+
+    while (g_serverActive)
+    {
+        // The wait wakes up at least once per idle timeout to close connections that stayed idle
+        if (0 > (numEvents = epoll_wait(g_epollfd, events, MAX_EPOLL_EVENTS, IDLE_CONNECTION_TIMEOUT_SECONDS * 1000)))
+        {
+            if (EINTR != errno)
             {
-                OsConfigLogError(GetPlatformLog(), "Failed to read request URI %d", socketHandle);
-                status = HTTP_BAD_REQUEST;
+                OsConfigLogError(GetPlatformLog(), "epoll_wait failed on socket '%s' (%d)", g_mpiSocket, errno);
+                break;
             }
+            continue;
+        }
 
-            if ((contentLength = ReadHttpContentLengthFromSocket(socketHandle, GetPlatformLog())))
+        for (i = 0; (i < numEvents) && g_serverActive; i++)
+        {
+            if (events[i].data.fd == g_eventfd)
+            {
+                // Shutdown notification
+                continue;
+            }
+            else if (events[i].data.fd != g_socketfd)
             {
-                if (NULL == (requestBody = (char*)malloc(contentLength + 1)))
+                // New request (or hang up) on an open connection, which stays disarmed until the worker is done with it
+                BusyConnection(events[i].data.fd);
+                if (!EnqueueConnection(events[i].data.fd))
                 {
-                    OsConfigLogError(GetPlatformLog(), "%s: failed to allocate memory for HTTP body, Content-Length %d", uri, contentLength);
-                    status = HTTP_BAD_REQUEST;
+                    CloseConnection(events[i].data.fd);
                 }
+                continue;
+            }
 
-                memset(requestBody, 0, contentLength + 1);
+            socketLength = sizeof(socketAddress);
+            while (g_serverActive && (0 <= (socketHandle = accept4(g_socketfd, (struct sockaddr*)&socketAddress, &socketLength, SOCK_CLOEXEC))))
+            {
+                AreModulesLoadedAndLoadIfNot();
 
-                if (contentLength != (int)(bytes = read(socketHandle, requestBody, contentLength)))
+                if (IsFullLoggingEnabled())
                 {
-                    OsConfigLogError(GetPlatformLog(), "%s: failed to read complete HTTP body, Content-Length %d, bytes read %d", uri, contentLength, (int)bytes);
-                    status = HTTP_BAD_REQUEST;
+                    OsConfigLogInfo(GetPlatformLog(), "Accepted connection: path %s, handle '%d'", g_mpiSocket, socketHandle);
                 }
-            }
 
-            if (status == HTTP_OK)
-            {
-                if (IsFullLoggingEnabled())
+                if (!TrackConnection(socketHandle))
+                {
+                    close(socketHandle);
+                }
+                else if (!WatchConnection(socketHandle, EPOLL_CTL_ADD))
                 {
-                    OsConfigLogInfo(GetPlatformLog(), "%s: content-length %d, body, '%s'", uri, contentLength, requestBody);
+                    CloseConnection(socketHandle);
                 }
 
-                status = HandleMpiCall(uri, requestBody, &responseBody, &responseSize, mpiCalls);
+                socketLength = sizeof(socketAddress);
             }
 
-            httpReason = HttpReasonAsString(status);
-            estimatedSize = strlen(responseFormat) + MAX_STATUS_CODE_LENGTH + strlen(httpReason) + MAX_CONTENTLENGTH_LENGTH + responseSize + 1;
-
-            if (NULL != (buffer = (char*)malloc(estimatedSize)))
+            if ((0 > socketHandle) && (EAGAIN != errno) && (EWOULDBLOCK != errno) && (EINTR != errno))
             {
-                memset(buffer, 0, estimatedSize);
+                OsConfigLogError(GetPlatformLog(), "Failed to accept connection on socket '%s' (%d)", g_mpiSocket, errno);
+            }
+        }
 
-                snprintf(buffer, estimatedSize, responseFormat, (int)status, httpReason, responseSize, responseSize, (responseBody ? responseBody : ""));
-                actualSize = (int)strlen(buffer);
+        if (g_serverActive && ((GetMonotonicSeconds() - lastIdleCheck) >= IDLE_CONNECTION_TIMEOUT_SECONDS))
+        {
+            CloseIdleConnections();
+            lastIdleCheck = GetMonotonicSeconds();
+        }
+    }
 
-                bytes = write(socketHandle, buffer, actualSize);
+    return NULL;
+}
 
-                if (bytes != actualSize)
-                {
-                    OsConfigLogError(GetPlatformLog(), "%s: failed to write complete HTTP response, %d bytes of %d", uri, (int)bytes, actualSize);
-                }
-            }
-            else
-            {
-                OsConfigLogError(GetPlatformLog(), "%s: failed to allocate memory for HTTP response, %d bytes of %d", uri, 0, estimatedSize);
-            }
+static bool StartMpiServerThreads(int numWorkers, int maxQueuedConnections)
+{
+    struct epoll_event event = {0};
+    bool result = true;
+    int i = 0;
 
-            if (0 != close(socketHandle))
-            {
-                OsConfigLogError(GetPlatformLog(), "Failed to close socket: path %s, handle '%d'", g_socketaddr.sun_path, socketHandle);
-            }
+    if (NULL == (g_connectionQueue.connections = (int*)malloc(maxQueuedConnections * sizeof(int))))
+    {
+        OsConfigLogError(GetPlatformLog(), "Failed to allocate connection queue of %d entries", maxQueuedConnections);
+        return false;
+    }
 
-            if (IsFullLoggingEnabled())
-            {
-                OsConfigLogInfo(GetPlatformLog(), "Closed connection: path %s, handle '%d'", g_socketaddr.sun_path, socketHandle);
-            }
+    g_connectionQueue.capacity = maxQueuedConnections;
+    g_connectionQueue.count = 0;
+    g_connectionQueue.head = 0;
+
+    if (NULL == (g_mpiServerWorkers = (pthread_t*)malloc(numWorkers * sizeof(pthread_t))))
+    {
+        OsConfigLogError(GetPlatformLog(), "Failed to allocate %d MPI server workers", numWorkers);
+        return false;
+    }
 
-            contentLength = 0;
-            responseSize = 0;
-            actualSize = 0;
-            estimatedSize = 0;
+    if ((0 > (g_epollfd = epoll_create1(EPOLL_CLOEXEC))) || (0 > (g_eventfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))))
+    {
+        OsConfigLogError(GetPlatformLog(), "Failed to create epoll instance for socket '%s' (%d)", g_mpiSocket, errno);
+        return false;
+    }
+
+    event.events = EPOLLIN;
+    event.data.fd = g_socketfd;
+    if (0 != epoll_ctl(g_epollfd, EPOLL_CTL_ADD, g_socketfd, &event))
+    {
+        OsConfigLogError(GetPlatformLog(), "Failed to add socket '%s' to epoll instance (%d)", g_mpiSocket, errno);
+        return false;
+    }
 
-            FREE_MEMORY(requestBody);
-            FREE_MEMORY(responseBody);
-            FREE_MEMORY(httpReason);
-            FREE_MEMORY(buffer);
-            FREE_MEMORY(uri);
+    event.events = EPOLLIN;
+    event.data.fd = g_eventfd;
+    if (0 != epoll_ctl(g_epollfd, EPOLL_CTL_ADD, g_eventfd, &event))
+    {
+        OsConfigLogError(GetPlatformLog(), "Failed to add shutdown event to epoll instance (%d)", errno);
+        return false;
+    }
+
+    g_serverActive = true;
 
-            SleepMilliseconds(MPI_WORKER_SLEEP);
+    for (i = 0; i < numWorkers; i++)
+    {
+        if (0 != pthread_create(&g_mpiServerWorkers[g_numMpiServerWorkers], NULL, MpiServerWorker, NULL))
+        {
+            OsConfigLogError(GetPlatformLog(), "Failed to create MPI server worker %d of %d", i + 1, numWorkers);
+            break;
         }
+        g_numMpiServerWorkers += 1;
     }
 
-    return NULL;
+    if ((0 == g_numMpiServerWorkers) || (0 != pthread_create(&g_mpiServerAcceptor, NULL, MpiServerAcceptor, NULL)))
+    {
+        OsConfigLogError(GetPlatformLog(), "Failed to start MPI server on socket '%s'", g_mpiSocket);
+        g_mpiServerAcceptor = 0;
+        result = false;
+    }
+
+    return result;
+}
+
+static void StopMpiServerThreads(void)
+{
+    uint64_t wakeup = 1;
+    ssize_t writeResult = -1;
+    int i = 0;
+
+    pthread_mutex_lock(&g_connectionQueue.mutex);
+    g_serverActive = false;
+    pthread_cond_broadcast(&g_connectionQueue.notEmpty);
+    pthread_cond_broadcast(&g_connectionQueue.notFull);
+    pthread_mutex_unlock(&g_connectionQueue.mutex);
+
+    if (0 <= g_eventfd)
+    {
+        writeResult = write(g_eventfd, &wakeup, sizeof(wakeup));
+        UNUSED(writeResult);
+    }
+
+    if (0 != g_mpiServerAcceptor)
+    {
+        pthread_join(g_mpiServerAcceptor, NULL);
+        g_mpiServerAcceptor = 0;
+    }
+
+    for (i = 0; i < g_numMpiServerWorkers; i++)
+    {
+        pthread_join(g_mpiServerWorkers[i], NULL);
+    }
+
+    // Drop idle keep-alive connections and connections that were accepted but not yet served
+    while (g_openConnections.count > 0)
+    {
+        CloseConnection(g_openConnections.connections[g_openConnections.count - 1].socketHandle);
+    }
+
+    FREE_MEMORY(g_openConnections.connections);
+    g_openConnections.capacity = 0;
+
+    g_connectionQueue.count = 0;
+    g_connectionQueue.head = 0;
+    g_connectionQueue.capacity = 0;
+    g_numMpiServerWorkers = 0;
+
+    FREE_MEMORY(g_connectionQueue.connections);
+    FREE_MEMORY(g_mpiServerWorkers);
+
+    if (0 <= g_epollfd)
+    {
+        close(g_epollfd);
+        g_epollfd = -1;
+    }
+
+    if (0 <= g_eventfd)
+    {
+        close(g_eventfd);
+        g_eventfd = -1;
+    }
 }
 
 void MpiServerInitialize(void)
 {
     struct stat st;
+    char* jsonConfiguration = NULL;
+    int numWorkers = 0;
+    int maxQueuedConnections = 0;
+
     if (-1 == stat(g_socketPrefix, &st))
     {
         // S_IRUSR (0x00400): Read permission, owner
@@ -591,7 +1134,12 @@ void MpiServerInitialize(void)
         }
     }
 
-    if (0 <= (g_socketfd = socket(AF_UNIX, SOCK_STREAM, 0)))
+    jsonConfiguration = LoadStringFromFile(g_configJson, false, GetPlatformLog());
+    numWorkers = GetMpiServerWorkersFromJsonConfig(jsonConfiguration, GetPlatformLog());
+    maxQueuedConnections = GetMaxQueuedConnectionsFromJsonConfig(jsonConfiguration, GetPlatformLog());
+    FREE_MEMORY(jsonConfiguration);
+
+    if (0 <= (g_socketfd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)))
     {
         memset(&g_socketaddr, 0, sizeof(g_socketaddr));
         g_socketaddr.sun_family = AF_UNIX;
@@ -605,12 +1153,16 @@ void MpiServerInitialize(void)
         {
             RestrictFileAccessToCurrentAccountOnly(g_mpiSocket);
 
-            if (0 == listen(g_socketfd, MAX_QUEUED_CONNECTIONS))
+            if (0 == listen(g_socketfd, maxQueuedConnections))
             {
-                OsConfigLogInfo(GetPlatformLog(), "Listening on socket '%s'", g_mpiSocket);
-
-                g_serverActive = true;
-                g_mpiServerWorker = pthread_create(&g_mpiServerWorker, NULL, MpiServerWorker, NULL);
+                if (StartMpiServerThreads(numWorkers, maxQueuedConnections))
+                {
+                    OsConfigLogInfo(GetPlatformLog(), "Listening on socket '%s' with %d workers and up to %d queued connections", g_mpiSocket, g_numMpiServerWorkers, maxQueuedConnections);
+                }
+                else
+                {
+                    StopMpiServerThreads();
+                }
             }
             else
             {
@@ -630,11 +1182,11 @@ void MpiServerInitialize(void)
 
 void MpiServerShutdown(void)
 {
-    g_serverActive = false;
-    pthread_join(g_mpiServerWorker, NULL);
+    StopMpiServerThreads();
 
     UnloadModules();
 
     close(g_socketfd);
+    g_socketfd = -1;
     unlink(g_mpiSocket);
-}
\ No newline at end of file
+}
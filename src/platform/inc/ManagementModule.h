@@ -57,6 +57,7 @@ public:
         Version version;
         std::string versionInfo;
         std::vector<std::string> components;
+        std::vector<std::string> dependencies;
         Lifetime lifetime;
         std::string licenseUri;
         std::string projectUri;
@@ -74,6 +75,10 @@ public:
 
     Info GetInfo() const;
 
+    // Claims the module for a reported read, false while the previous one is still running in it
+    bool BeginReported();
+    void EndReported();
+
 protected:
     const std::string m_modulePath;
 
@@ -90,11 +95,21 @@ protected:
 
     Info m_info;
 
+    // Serializes MMI calls into the module, modules are not required to be thread safe
+    std::mutex m_mmiMutex;
+
+    // Set while a reported read is running in the module, so that a hung module does not collect a thread per request
+    std::atomic<bool> m_reportedInFlight{false};
+
     virtual int CallMmiGetInfo(const char* clientName, MMI_JSON_STRING* payload, int* payloadSizeBytes);
     virtual MMI_HANDLE CallMmiOpen(const char* componentName, unsigned int maxPayloadSizeBytes);
     virtual void CallMmiClose(MMI_HANDLE handle);
     virtual int CallMmiSet(MMI_HANDLE handle, const char* componentName, const char* objectName, const MMI_JSON_STRING payload, const int payloadSizeBytes);
     virtual int CallMmiGet(MMI_HANDLE handle, const char* componentName, const char* objectName, MMI_JSON_STRING *payload, int *payloadSizeBytes);
+    virtual void CallMmiFree(MMI_JSON_STRING payload);
+
+    // Called with m_mmiMutex held, before the module is closed
+    void ClearMmiFunctions();
 
     friend class MmiSession;
 };
@@ -110,6 +125,10 @@ public:
 
     int Set(const char* componentName, const char* objectName, const MMI_JSON_STRING payload, const int payloadSizeBytes);
     int Get(const char* componentName, const char* objectName, MMI_JSON_STRING *payload, int *payloadSizeBytes);
+    void Free(MMI_JSON_STRING payload);
+
+    bool BeginReported();
+    void EndReported();
 
     ManagementModule::Info GetInfo();
 private:
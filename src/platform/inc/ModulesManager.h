@@ -4,6 +4,78 @@
 #ifndef MODULESMANAGER_H
 #define MODULESMANAGER_H
 
+// Short lived copies of reported objects, for objects configured with a time to live
+class ReportedCache
+{
+public:
+    ReportedCache();
+
+    void SetTimeToLive(const std::string& componentName, const std::string& objectName, std::chrono::milliseconds timeToLive);
+
+    // Returns true with the payload on a fresh hit, otherwise the generation to pass back to Put
+    bool Get(const std::string& componentName, const std::string& objectName, std::string& payload, unsigned long long& generation);
+    void Put(const std::string& componentName, const std::string& objectName, const std::string& payload, unsigned long long generation);
+
+    void Invalidate(const std::string& componentName);
+    void Clear();
+
+    unsigned long long GetHits();
+    unsigned long long GetMisses();
+
+private:
+    struct Entry
+    {
+        std::string payload;
+        std::chrono::steady_clock::time_point expires;
+    };
+
+    std::map<std::pair<std::string, std::string>, std::chrono::milliseconds> m_timeToLive;
+    std::map<std::pair<std::string, std::string>, Entry> m_entries;
+    std::map<std::string, unsigned long long> m_generations;
+    unsigned long long m_hits;
+    unsigned long long m_misses;
+    std::mutex m_mutex;
+};
+
+// Validators compiled from the MIM of each desired object, checking payloads against the real field types
+class MimSchemas
+{
+public:
+    // Adds a validator for each desired object of a MIM model, replacing any previous one for the same object
+    int Add(const std::string& mimJson);
+    int Load(const std::string& mimDirectory);
+    void Clear();
+
+    // True when the payload matches the MIM of the object, or when there is no MIM for the object
+    bool IsValid(const std::string& componentName, const std::string& objectName, const char* payload, const int payloadSizeBytes);
+
+private:
+    std::map<std::pair<std::string, std::string>, std::shared_ptr<rapidjson::SchemaDocument>> m_schemas;
+    std::mutex m_mutex;
+};
+
+// Bounded set of worker threads, started on demand and reused across calls, tasks start in the order they are pushed
+class TaskPool
+{
+public:
+    TaskPool(unsigned int maxWorkerThreads);
+    ~TaskPool();
+
+    // Returns false when no worker thread can take the task, the caller then runs it itself
+    bool Push(std::function<void()> task);
+
+private:
+    void WorkerThread();
+
+    unsigned int m_maxWorkerThreads;
+    unsigned int m_idleWorkerThreads;
+    bool m_stopping;
+    std::vector<std::thread> m_workerThreads;
+    std::queue<std::function<void()>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+};
+
 class ModulesManager
 {
 public:
@@ -18,6 +90,29 @@ protected:
     std::map<std::string, std::string> m_moduleComponentName;
     std::map<std::string, std::shared_ptr<ManagementModule>> m_modules;
 
+    // How long GetReported waits for each module before reporting without it
+    std::chrono::milliseconds m_reportedTimeout;
+
+    // Shared with reader threads that may outlive a GetReported call
+    std::shared_ptr<ReportedCache> m_reportedCache;
+
+    // GetReported returns compact JSON unless pretty printing is requested in the configuration
+    bool m_prettyPrintReported;
+
+    // Desired payloads passed to MpiSet are checked against the MIM when a MIM directory is configured
+    std::shared_ptr<MimSchemas> m_mimSchemas;
+
+    // Hash of the last desired payload successfully applied to each (component, object), cleared on unload to force a full reapply
+    std::map<std::pair<std::string, std::string>, size_t> m_desiredHashes;
+    std::mutex m_desiredHashesMutex;
+
+    // Applies the modules of a desired payload in parallel, shared by all sessions
+    TaskPool m_desiredPool;
+
+    bool IsDesiredApplied(const std::string& componentName, const std::string& objectName, size_t payloadHash);
+    void SetDesiredApplied(const std::string& componentName, const std::string& objectName, size_t payloadHash);
+    void ForgetDesiredApplied(const std::string& componentName, const std::string& objectName);
+
     int SetReportedObjects(const std::string& configJson);
     void RegisterModuleComponents(const std::string& moduleName, const std::vector<std::string>& components, bool replace = false);
 
@@ -37,8 +132,15 @@ public:
 
     int Set(const char* componentName, const char* objectName, const MPI_JSON_STRING payload, const int payloadSizeBytes);
     int Get(const char* componentName, const char* objectName, MPI_JSON_STRING* payload, int* payloadSizeBytes);
-    int SetDesired(const MPI_JSON_STRING payload, const int payloadSizeBytes);
+    // Component name to the MMI status of applying its desired objects, the first failure if any
+    typedef std::map<std::string, int> ComponentResults;
+
+    int SetDesired(const MPI_JSON_STRING payload, const int payloadSizeBytes, ComponentResults* componentResults = nullptr);
     int GetReported(MPI_JSON_STRING* payload, int* payloadSizeBytes);
+    int GetMany(const MPI_JSON_STRING objects, const int objectsSizeBytes, MPI_JSON_STRING* payload, int* payloadSizeBytes);
+
+    // Component name to (MMI status, payload) of each reported object, in configuration order
+    typedef std::map<std::string, std::vector<std::pair<int, std::string>>> ReportedResults;
 
 private:
     ModulesManager& m_modulesManager;
@@ -49,7 +151,8 @@ private:
     std::map<std::string, std::shared_ptr<MmiSession>> m_mmiSessions;
     std::shared_ptr<MmiSession> GetSession(const std::string& componentName);
 
-    int SetDesiredPayload(rapidjson::Document& document);
+    int SetDesiredPayload(rapidjson::Document& document, ComponentResults& componentResults);
+    ComponentResults SetDesiredComponents(std::shared_ptr<MmiSession> module, const std::vector<const rapidjson::Value::Member*>& components);
     int GetReportedPayload(MPI_JSON_STRING* payload, int* payloadSizeBytes);
 };
 
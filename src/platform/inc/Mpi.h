@@ -40,6 +40,14 @@ int MpiGetReported(
     MPI_HANDLE clientSession,
     MPI_JSON_STRING* payload,
     int* payloadSizeBytes);
+// Objects is a JSON array of {"ComponentName", "ObjectName"} pairs, the payload a JSON array
+// of {"ComponentName", "ObjectName", "Status", "Payload"} results in the same order
+int MpiGetMany(
+    MPI_HANDLE clientSession,
+    const MPI_JSON_STRING objects,
+    const int objectsSizeBytes,
+    MPI_JSON_STRING* payload,
+    int* payloadSizeBytes);
 void MpiClose(MPI_HANDLE clientSession);
 
 void MpiFree(MPI_JSON_STRING payload);
@@ -14,6 +14,7 @@
 #define MPI_GET_URI "MpiGet"
 #define MPI_SET_DESIRED_URI "MpiSetDesired"
 #define MPI_GET_REPORTED_URI "MpiGetReported"
+#define MPI_GET_MANY_URI "MpiGetMany"
 
 #ifdef __cplusplus
 extern "C"
@@ -34,6 +35,7 @@ typedef int(*MpiSetCall)(MPI_HANDLE, const char*, const char*, MPI_JSON_STRING,
 typedef int(*MpiGetCall)(MPI_HANDLE, const char*, const char*, MPI_JSON_STRING*, int*);
 typedef int(*MpiSetDesiredCall)(MPI_HANDLE, const MPI_JSON_STRING, const int);
 typedef int(*MpiGetReportedCall)(MPI_HANDLE, MPI_JSON_STRING*, int*);
+typedef int(*MpiGetManyCall)(MPI_HANDLE, const MPI_JSON_STRING, const int, MPI_JSON_STRING*, int*);
 
 typedef struct MPI_CALLS
 {
@@ -43,6 +45,7 @@ typedef struct MPI_CALLS
     MpiGetCall mpiGet;
     MpiSetDesiredCall mpiSetDesired;
     MpiGetReportedCall mpiGetReported;
+    MpiGetManyCall mpiGetMany;
 } MPI_CALLS;
 
 void MpiServerInitialize(void);
@@ -97,11 +97,12 @@ namespace Tests
         Info::Deserialize(document, m_info);
     }
 
-    MockManagementModule::MockManagementModule(std::string name, std::vector<std::string> components) :
+    MockManagementModule::MockManagementModule(std::string name, std::vector<std::string> components, std::vector<std::string> dependencies) :
         MockManagementModule()
     {
         m_info.name = name;
         m_info.components = components;
+        m_info.dependencies = dependencies;
     }
 
     void MockManagementModule::MmiGetInfo(Mmi_GetInfo mmiGetInfo)
@@ -133,4 +134,9 @@ namespace Tests
     {
         this->m_mmiFree = mmiFree;
     }
+
+    void MockManagementModule::CallMmiFree(MMI_JSON_STRING payload)
+    {
+        (void)payload;
+    }
 } // namespace Tests
\ No newline at end of file
@@ -12,11 +12,14 @@ namespace Tests
         MMI_HANDLE mmiHandle;
 
         MockManagementModule();
-        MockManagementModule(std::string name, std::vector<std::string> components);
+        MockManagementModule(std::string name, std::vector<std::string> components, std::vector<std::string> dependencies = {});
 
         MOCK_METHOD(int, CallMmiSet, (MMI_HANDLE handle, const char* componentName, const char* objectName, const MMI_JSON_STRING payload, const int payloadSizeBytes), (override));
         MOCK_METHOD(int, CallMmiGet, (MMI_HANDLE handle, const char* componentName, const char* objectName, MMI_JSON_STRING* payload, int* payloadSizeBytes), (override));
 
+        // Payloads handed out by the mocked CallMmiGet are owned by the tests
+        void CallMmiFree(MMI_JSON_STRING payload) override;
+
         void MmiGetInfo(Mmi_GetInfo mmiGetInfo);
         void MmiOpen(Mmi_Open mmiOpen);
         void MmiClose(Mmi_Close mmiClose);
@@ -33,4 +33,29 @@ namespace Tests
 
         m_reportedComponents[componentName].push_back(objectName);
     }
+
+    void MockModulesManager::SetReportedTimeout(std::chrono::milliseconds timeout)
+    {
+        m_reportedTimeout = timeout;
+    }
+
+    void MockModulesManager::SetReportedCacheTime(std::string componentName, std::string objectName, std::chrono::milliseconds timeToLive)
+    {
+        m_reportedCache->SetTimeToLive(componentName, objectName, timeToLive);
+    }
+
+    void MockModulesManager::SetPrettyPrintReported(bool prettyPrint)
+    {
+        m_prettyPrintReported = prettyPrint;
+    }
+
+    std::shared_ptr<ReportedCache> MockModulesManager::GetReportedCache()
+    {
+        return m_reportedCache;
+    }
+
+    int MockModulesManager::AddMim(std::string mimJson)
+    {
+        return m_mimSchemas->Add(mimJson);
+    }
 } // namespace Tests
\ No newline at end of file
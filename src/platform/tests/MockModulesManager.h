@@ -19,6 +19,21 @@ namespace Tests
 
         // Helper method to add reported objects to the ModulesManager
         void AddReportedObject(std::string componentName, std::string objectName);
+
+        // Helper method to shorten how long GetReported waits for each module
+        void SetReportedTimeout(std::chrono::milliseconds timeout);
+
+        // Helper method to cache a reported object as if configured with CacheSeconds
+        void SetReportedCacheTime(std::string componentName, std::string objectName, std::chrono::milliseconds timeToLive);
+
+        // Helper method to switch GetReported between compact and pretty printed output
+        void SetPrettyPrintReported(bool prettyPrint);
+
+        // Helper method to inspect the reported object cache
+        std::shared_ptr<ReportedCache> GetReportedCache();
+
+        // Helper method to check MpiSet payloads against a MIM model as if configured with MimDirectory
+        int AddMim(std::string mimJson);
     };
 } // namespace Tests
 
@@ -1,6 +1,7 @@
 // Copyright (c) Microsoft Corporation. All rights reserved.
 // Licensed under the MIT License.
 
+#include <condition_variable>
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 #include <rapidjson/document.h>
@@ -16,6 +17,7 @@
 
 using ::testing::_;
 using ::testing::DoAll;
+using ::testing::InvokeWithoutArgs;
 using ::testing::Return;
 using ::testing::SetArgPointee;
 using ::testing::StrEq;
@@ -88,6 +90,35 @@ namespace Tests
         ASSERT_EQ(EINVAL, m_mpiSession->Set(m_defaultComponent, m_defaultObject, nullptr, 0));
     }
 
+    TEST_F(ModuleManagerTests, MpiSetMimValidation)
+    {
+        std::string mim = std::string("{\"name\": \"TestModel\", \"type\": \"mimModel\", \"contents\": [{") +
+            "\"name\": \"" + m_defaultComponent + "\", \"type\": \"mimComponent\", \"contents\": [{" +
+            "\"name\": \"" + m_defaultObject + "\", \"type\": \"mimObject\", \"desired\": true, \"schema\": {\"fields\": [" +
+            "{\"name\": \"count\", \"schema\": \"integer\"}," +
+            "{\"name\": \"names\", \"schema\": {\"type\": \"array\", \"elementSchema\": \"string\"}}," +
+            "{\"name\": \"options\", \"schema\": {\"type\": \"map\", \"mapKey\": {\"schema\": \"string\"}, \"mapValue\": {\"schema\": \"integer\"}}}," +
+            "{\"name\": \"mode\", \"schema\": {\"type\": \"enum\", \"valueSchema\": \"integer\", \"enumValues\": [{\"name\": \"off\", \"enumValue\": 0}, {\"name\": \"on\", \"enumValue\": 1}]}}]}}]}]}";
+        char validPayload[] = "{\"count\": 1, \"names\": [\"a\"], \"options\": {\"key\": 2, \"removed\": null}, \"mode\": 1}";
+        char invalidPayload[] = "{\"count\": \"1\"}";
+        char invalidEnumPayload[] = "{\"mode\": 2}";
+        char otherObjectPayload[] = "\"any\"";
+        const char otherObject[] = "Other_ModuleManagerTest_Object";
+
+        ASSERT_EQ(MPI_OK, m_mockModuleManager->AddMim(mim));
+
+        EXPECT_CALL(*m_mockModule, CallMmiSet(_, m_defaultComponent, m_defaultObject, validPayload, strlen(validPayload))).Times(1).WillOnce(Return(MMI_OK));
+        EXPECT_EQ(MPI_OK, m_mpiSession->Set(m_defaultComponent, m_defaultObject, validPayload, strlen(validPayload)));
+
+        // Rejected before reaching the module
+        EXPECT_EQ(EINVAL, m_mpiSession->Set(m_defaultComponent, m_defaultObject, invalidPayload, strlen(invalidPayload)));
+        EXPECT_EQ(EINVAL, m_mpiSession->Set(m_defaultComponent, m_defaultObject, invalidEnumPayload, strlen(invalidEnumPayload)));
+
+        // Objects without a MIM are passed through
+        EXPECT_CALL(*m_mockModule, CallMmiSet(_, m_defaultComponent, otherObject, otherObjectPayload, strlen(otherObjectPayload))).Times(1).WillOnce(Return(MMI_OK));
+        EXPECT_EQ(MPI_OK, m_mpiSession->Set(m_defaultComponent, otherObject, otherObjectPayload, strlen(otherObjectPayload)));
+    }
+
     TEST_F(ModuleManagerTests, MpiGet)
     {
         int payloadSizeBytes = 0;
@@ -219,6 +250,107 @@ namespace Tests
         EXPECT_EQ(MPI_OK, mpiSession->SetDesired(payload, strlen(payload)));
     }
 
+    TEST_F(ModuleManagerTests, MpiSetDesiredUnchangedObjects)
+    {
+        const char componentName[] = "component";
+        const char objectName_1[] = "object_1";
+        const char objectName_2[] = "object_2";
+        char value_1[] = "\"value_1\"";
+        char value_2[] = "\"value_2\"";
+        char value_3[] = "\"value_3\"";
+        char payload_1[] = R""""({"component": {"object_1": "value_1", "object_2": "value_2"}})"""";
+        char payload_2[] = R""""({"component": {"object_1": "value_1", "object_2": "value_3"}})"""";
+
+        std::shared_ptr<MockManagementModule> mockModule = std::make_shared<MockManagementModule>("mockModule", std::vector<std::string>({componentName}));
+        m_mockModuleManager->Load(mockModule);
+
+        std::shared_ptr<MpiSession> mpiSession = std::make_shared<MpiSession>(*m_mockModuleManager, m_defaultClient);
+        EXPECT_EQ(0, mpiSession->Open());
+
+        EXPECT_CALL(*mockModule, CallMmiSet(_, StrEq(componentName), StrEq(objectName_1), StrEq(value_1), strlen(value_1))).Times(2).WillRepeatedly(Return(MMI_OK));
+        EXPECT_CALL(*mockModule, CallMmiSet(_, StrEq(componentName), StrEq(objectName_1), StrEq(value_3), strlen(value_3))).Times(1).WillOnce(Return(MMI_OK));
+        EXPECT_CALL(*mockModule, CallMmiSet(_, StrEq(componentName), StrEq(objectName_2), StrEq(value_2), strlen(value_2))).Times(1).WillOnce(Return(MMI_OK));
+        EXPECT_CALL(*mockModule, CallMmiSet(_, StrEq(componentName), StrEq(objectName_2), StrEq(value_3), strlen(value_3))).Times(1).WillOnce(Return(MMI_OK));
+
+        EXPECT_EQ(MPI_OK, mpiSession->SetDesired(payload_1, strlen(payload_1)));
+
+        // Only the changed object is applied again
+        EXPECT_EQ(MPI_OK, mpiSession->SetDesired(payload_2, strlen(payload_2)));
+        EXPECT_EQ(MPI_OK, mpiSession->SetDesired(payload_2, strlen(payload_2)));
+
+        // An object set directly is applied again with the next desired configuration
+        EXPECT_EQ(MPI_OK, mpiSession->Set(componentName, objectName_1, value_3, strlen(value_3)));
+        EXPECT_EQ(MPI_OK, mpiSession->SetDesired(payload_2, strlen(payload_2)));
+    }
+
+    TEST_F(ModuleManagerTests, MpiSetDesiredParallelComponents)
+    {
+        const char componentName_1[] = "component_1";
+        const char componentName_2[] = "component_2";
+        const char objectName_1[] = "object_1";
+        const char objectName_2[] = "object_2";
+        char payload[] = R""""({"component_1": {"object_1": "value_1"}, "component_2": {"object_2": "value_2"}, "component_3": {"object_3": "value_3"}})"""";
+        std::mutex startedMutex;
+        std::condition_variable startedCondition;
+        int started = 0;
+
+        // Each module waits until the other one has started, which only happens when they are applied at the same time
+        auto applyTogether = [&](int result)
+        {
+            std::unique_lock<std::mutex> lock(startedMutex);
+            started++;
+            startedCondition.notify_all();
+            return startedCondition.wait_for(lock, std::chrono::seconds(30), [&]() { return 2 == started; }) ? result : ETIMEDOUT;
+        };
+
+        std::shared_ptr<MockManagementModule> mockModule_1 = std::make_shared<MockManagementModule>("mockModule_1", std::vector<std::string>({componentName_1}));
+        std::shared_ptr<MockManagementModule> mockModule_2 = std::make_shared<MockManagementModule>("mockModule_2", std::vector<std::string>({componentName_2}));
+        MpiSession::ComponentResults results;
+
+        m_mockModuleManager->Load(mockModule_1);
+        m_mockModuleManager->Load(mockModule_2);
+
+        std::shared_ptr<MpiSession> mpiSession = std::make_shared<MpiSession>(*m_mockModuleManager, m_defaultClient);
+        EXPECT_EQ(0, mpiSession->Open());
+
+        EXPECT_CALL(*mockModule_1, CallMmiSet(_, StrEq(componentName_1), StrEq(objectName_1), _, _)).Times(1).WillOnce(InvokeWithoutArgs([&]() { return applyTogether(MMI_OK); }));
+        EXPECT_CALL(*mockModule_2, CallMmiSet(_, StrEq(componentName_2), StrEq(objectName_2), _, _)).Times(1).WillOnce(InvokeWithoutArgs([&]() { return applyTogether(EIO); }));
+
+        EXPECT_EQ(EINVAL, mpiSession->SetDesired(payload, strlen(payload), &results));
+
+        EXPECT_EQ(3u, results.size());
+        EXPECT_EQ(MMI_OK, results[componentName_1]);
+        EXPECT_EQ(EIO, results[componentName_2]);
+        EXPECT_EQ(EINVAL, results["component_3"]);
+    }
+
+    TEST_F(ModuleManagerTests, MpiSetDesiredDependencies)
+    {
+        const char componentName_1[] = "component_1";
+        const char componentName_2[] = "component_2";
+        const char objectName_1[] = "object_1";
+        const char objectName_2[] = "object_2";
+        char payload[] = R""""({"component_2": {"object_2": "value_2"}, "component_1": {"object_1": "value_1"}})"""";
+        std::vector<std::string> applied;
+        std::mutex appliedMutex;
+
+        std::shared_ptr<MockManagementModule> mockModule_1 = std::make_shared<MockManagementModule>("mockModule_1", std::vector<std::string>({componentName_1}));
+        std::shared_ptr<MockManagementModule> mockModule_2 = std::make_shared<MockManagementModule>("mockModule_2", std::vector<std::string>({componentName_2}), std::vector<std::string>({componentName_1}));
+
+        m_mockModuleManager->Load(mockModule_1);
+        m_mockModuleManager->Load(mockModule_2);
+
+        std::shared_ptr<MpiSession> mpiSession = std::make_shared<MpiSession>(*m_mockModuleManager, m_defaultClient);
+        EXPECT_EQ(0, mpiSession->Open());
+
+        EXPECT_CALL(*mockModule_1, CallMmiSet(_, StrEq(componentName_1), StrEq(objectName_1), _, _)).Times(1).WillOnce(InvokeWithoutArgs([&]() { std::lock_guard<std::mutex> lock(appliedMutex); applied.push_back(componentName_1); return MMI_OK; }));
+        EXPECT_CALL(*mockModule_2, CallMmiSet(_, StrEq(componentName_2), StrEq(objectName_2), _, _)).Times(1).WillOnce(InvokeWithoutArgs([&]() { std::lock_guard<std::mutex> lock(appliedMutex); applied.push_back(componentName_2); return MMI_OK; }));
+
+        // component_2 is first in the payload but waits for component_1, which it depends on
+        EXPECT_EQ(MPI_OK, mpiSession->SetDesired(payload, strlen(payload)));
+        EXPECT_EQ(std::vector<std::string>({componentName_1, componentName_2}), applied);
+    }
+
     TEST_F(ModuleManagerTests, MpiSetDesiredInvalidJsonPayload)
     {
         char invalid[] = "invalid";
@@ -342,6 +474,249 @@ namespace Tests
         EXPECT_TRUE(JSON_EQ(expected, actual));
     }
 
+    TEST_F(ModuleManagerTests, MpiGetReportedSlowModule)
+    {
+        const char componentName_1[] = "component_1";
+        const char componentName_2[] = "component_2";
+        const char objectName_1[] = "object_1";
+        const char objectName_2[] = "object_2";
+        char value_1[] = "\"value_1\"";
+        char expected[] = R""""(
+            {
+                "component_1": {
+                    "object_1": "value_1"
+                }
+            })"""";
+        const std::chrono::milliseconds timeout(100);
+        const std::chrono::milliseconds delay(500);
+
+        MPI_JSON_STRING payload = nullptr;
+        int payloadSizeBytes = 0;
+
+        std::shared_ptr<MockManagementModule> mockModule_1 = std::make_shared<MockManagementModule>("mockModule_1", std::vector<std::string>({componentName_1}));
+        std::shared_ptr<MockManagementModule> mockModule_2 = std::make_shared<MockManagementModule>("mockModule_2", std::vector<std::string>({componentName_2}));
+
+        m_mockModuleManager->Load(mockModule_1);
+        m_mockModuleManager->Load(mockModule_2);
+        m_mockModuleManager->AddReportedObject(componentName_1, objectName_1);
+        m_mockModuleManager->AddReportedObject(componentName_2, objectName_2);
+        m_mockModuleManager->SetReportedTimeout(timeout);
+
+        EXPECT_CALL(*mockModule_1, CallMmiGet(_, StrEq(componentName_1), StrEq(objectName_1), _, _)).Times(1).WillOnce(DoAll(SetArgPointee<3>(value_1), SetArgPointee<4>(strlen(value_1)), Return(MMI_OK)));
+        EXPECT_CALL(*mockModule_2, CallMmiGet(_, StrEq(componentName_2), StrEq(objectName_2), _, _)).Times(1).WillOnce(InvokeWithoutArgs([delay]() { std::this_thread::sleep_for(delay); return EIO; }));
+
+        std::shared_ptr<MpiSession> mpiSession = std::make_shared<MpiSession>(*m_mockModuleManager, m_defaultClient);
+        EXPECT_EQ(0, mpiSession->Open());
+
+        auto start = std::chrono::steady_clock::now();
+        EXPECT_EQ(MPI_OK, mpiSession->GetReported(&payload, &payloadSizeBytes));
+        EXPECT_LT(std::chrono::steady_clock::now() - start, delay);
+
+        std::string actual(payload, payloadSizeBytes);
+        EXPECT_TRUE(JSON_EQ(expected, actual));
+
+        // Let the slow module finish before its mock goes away
+        std::this_thread::sleep_for(delay);
+    }
+
+    TEST_F(ModuleManagerTests, MpiGetReportedHungModule)
+    {
+        const char componentName_1[] = "component_1";
+        const char componentName_2[] = "component_2";
+        const char objectName_1[] = "object_1";
+        const char objectName_2[] = "object_2";
+        char value_1[] = "\"value_1\"";
+        char expected[] = R""""(
+            {
+                "component_1": {
+                    "object_1": "value_1"
+                }
+            })"""";
+        std::mutex hungMutex;
+        std::condition_variable hungCondition;
+        bool released = false;
+
+        MPI_JSON_STRING payload = nullptr;
+        int payloadSizeBytes = 0;
+
+        std::shared_ptr<MockManagementModule> mockModule_1 = std::make_shared<MockManagementModule>("mockModule_1", std::vector<std::string>({componentName_1}));
+        std::shared_ptr<MockManagementModule> mockModule_2 = std::make_shared<MockManagementModule>("mockModule_2", std::vector<std::string>({componentName_2}));
+
+        m_mockModuleManager->Load(mockModule_1);
+        m_mockModuleManager->Load(mockModule_2);
+        m_mockModuleManager->AddReportedObject(componentName_1, objectName_1);
+        m_mockModuleManager->AddReportedObject(componentName_2, objectName_2);
+        m_mockModuleManager->SetReportedTimeout(std::chrono::milliseconds(100));
+
+        EXPECT_CALL(*mockModule_1, CallMmiGet(_, StrEq(componentName_1), StrEq(objectName_1), _, _)).Times(2).WillRepeatedly(DoAll(SetArgPointee<3>(value_1), SetArgPointee<4>(strlen(value_1)), Return(MMI_OK)));
+
+        // Hangs until released, a second request must not start another read in it
+        EXPECT_CALL(*mockModule_2, CallMmiGet(_, StrEq(componentName_2), StrEq(objectName_2), _, _)).Times(1).WillOnce(InvokeWithoutArgs([&]()
+        {
+            std::unique_lock<std::mutex> lock(hungMutex);
+            hungCondition.wait(lock, [&]() { return released; });
+            return EIO;
+        }));
+
+        std::shared_ptr<MpiSession> mpiSession = std::make_shared<MpiSession>(*m_mockModuleManager, m_defaultClient);
+        EXPECT_EQ(0, mpiSession->Open());
+
+        for (int i = 0; i < 2; i++)
+        {
+            EXPECT_EQ(MPI_OK, mpiSession->GetReported(&payload, &payloadSizeBytes));
+            EXPECT_TRUE(JSON_EQ(expected, std::string(payload, payloadSizeBytes)));
+            delete[] payload;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(hungMutex);
+            released = true;
+        }
+        hungCondition.notify_all();
+
+        // The module is free again once the hung read returns, which must happen before its mock goes away
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+        while (!mockModule_2->BeginReported() && (std::chrono::steady_clock::now() < deadline))
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        mockModule_2->EndReported();
+    }
+
+    TEST_F(ModuleManagerTests, MpiGetReportedPrettyPrint)
+    {
+        const char componentName[] = "component";
+        const char objectName[] = "object";
+        char value[] = "{ \"a\" : [1, true] }";
+        const char compact[] = "{\"component\":{\"object\":{ \"a\" : [1, true] }}}";
+        const char pretty[] = "{\n  \"component\": {\n    \"object\": {\n      \"a\": [\n        1,\n        true\n      ]\n    }\n  }\n}";
+
+        MPI_JSON_STRING payload = nullptr;
+        int payloadSizeBytes = 0;
+
+        std::shared_ptr<MockManagementModule> mockModule = std::make_shared<MockManagementModule>("mockModule", std::vector<std::string>({componentName}));
+
+        m_mockModuleManager->Load(mockModule);
+        m_mockModuleManager->AddReportedObject(componentName, objectName);
+
+        std::shared_ptr<MpiSession> mpiSession = std::make_shared<MpiSession>(*m_mockModuleManager, m_defaultClient);
+        EXPECT_EQ(0, mpiSession->Open());
+
+        EXPECT_CALL(*mockModule, CallMmiGet(_, StrEq(componentName), StrEq(objectName), _, _)).Times(2).WillRepeatedly(DoAll(SetArgPointee<3>(value), SetArgPointee<4>(strlen(value)), Return(MMI_OK)));
+
+        // Module payloads are spliced in as is by default
+        EXPECT_EQ(MPI_OK, mpiSession->GetReported(&payload, &payloadSizeBytes));
+        EXPECT_STREQ(compact, std::string(payload, payloadSizeBytes).c_str());
+        MpiFree(payload);
+
+        m_mockModuleManager->SetPrettyPrintReported(true);
+        EXPECT_EQ(MPI_OK, mpiSession->GetReported(&payload, &payloadSizeBytes));
+        EXPECT_STREQ(pretty, std::string(payload, payloadSizeBytes).c_str());
+        MpiFree(payload);
+    }
+
+    TEST_F(ModuleManagerTests, MpiGetReportedCached)
+    {
+        const char componentName[] = "component";
+        const char objectName[] = "object";
+        char value_1[] = "\"value_1\"";
+        char value_2[] = "\"value_2\"";
+        char desired[] = "\"desired\"";
+        char expected_1[] = R""""({"component": {"object": "value_1"}})"""";
+        char expected_2[] = R""""({"component": {"object": "value_2"}})"""";
+
+        MPI_JSON_STRING payload = nullptr;
+        int payloadSizeBytes = 0;
+
+        std::shared_ptr<MockManagementModule> mockModule = std::make_shared<MockManagementModule>("mockModule", std::vector<std::string>({componentName}));
+
+        m_mockModuleManager->Load(mockModule);
+        m_mockModuleManager->AddReportedObject(componentName, objectName);
+        m_mockModuleManager->SetReportedCacheTime(componentName, objectName, std::chrono::seconds(60));
+
+        std::shared_ptr<MpiSession> mpiSession = std::make_shared<MpiSession>(*m_mockModuleManager, m_defaultClient);
+        EXPECT_EQ(0, mpiSession->Open());
+
+        // The second read is served from the cache
+        EXPECT_CALL(*mockModule, CallMmiGet(_, StrEq(componentName), StrEq(objectName), _, _)).Times(2)
+            .WillOnce(DoAll(SetArgPointee<3>(value_1), SetArgPointee<4>(strlen(value_1)), Return(MMI_OK)))
+            .WillOnce(DoAll(SetArgPointee<3>(value_2), SetArgPointee<4>(strlen(value_2)), Return(MMI_OK)));
+
+        EXPECT_EQ(MPI_OK, mpiSession->GetReported(&payload, &payloadSizeBytes));
+        EXPECT_TRUE(JSON_EQ(expected_1, std::string(payload, payloadSizeBytes)));
+        MpiFree(payload);
+
+        EXPECT_EQ(MPI_OK, mpiSession->GetReported(&payload, &payloadSizeBytes));
+        EXPECT_TRUE(JSON_EQ(expected_1, std::string(payload, payloadSizeBytes)));
+        MpiFree(payload);
+
+        EXPECT_EQ(1u, m_mockModuleManager->GetReportedCache()->GetHits());
+        EXPECT_EQ(1u, m_mockModuleManager->GetReportedCache()->GetMisses());
+
+        // A set on the component invalidates its cached objects
+        EXPECT_CALL(*mockModule, CallMmiSet(_, StrEq(componentName), StrEq(objectName), StrEq(desired), strlen(desired))).Times(1).WillOnce(Return(MMI_OK));
+        EXPECT_EQ(MPI_OK, mpiSession->Set(componentName, objectName, desired, strlen(desired)));
+
+        EXPECT_EQ(MPI_OK, mpiSession->GetReported(&payload, &payloadSizeBytes));
+        EXPECT_TRUE(JSON_EQ(expected_2, std::string(payload, payloadSizeBytes)));
+        MpiFree(payload);
+
+        EXPECT_EQ(1u, m_mockModuleManager->GetReportedCache()->GetHits());
+        EXPECT_EQ(2u, m_mockModuleManager->GetReportedCache()->GetMisses());
+    }
+
+    TEST_F(ModuleManagerTests, MpiGetMany)
+    {
+        const char componentName_1[] = "component_1";
+        const char componentName_2[] = "component_2";
+        const char objectName_1[] = "object_1";
+        const char objectName_2[] = "object_2";
+        char value_1[] = "\"value_1\"";
+        char objects[] = R""""([
+            {"ComponentName": "component_1", "ObjectName": "object_1"},
+            {"ComponentName": "component_2", "ObjectName": "object_2"},
+            {"ComponentName": "component_3", "ObjectName": "object_3"}])"""";
+        char expected[] = R""""([
+            {"ComponentName": "component_1", "ObjectName": "object_1", "Status": 0, "Payload": "value_1"},
+            {"ComponentName": "component_2", "ObjectName": "object_2", "Status": 5},
+            {"ComponentName": "component_3", "ObjectName": "object_3", "Status": 22}])"""";
+
+        MPI_JSON_STRING payload = nullptr;
+        int payloadSizeBytes = 0;
+
+        std::shared_ptr<MockManagementModule> mockModule_1 = std::make_shared<MockManagementModule>("mockModule_1", std::vector<std::string>({componentName_1}));
+        std::shared_ptr<MockManagementModule> mockModule_2 = std::make_shared<MockManagementModule>("mockModule_2", std::vector<std::string>({componentName_2}));
+
+        m_mockModuleManager->Load(mockModule_1);
+        m_mockModuleManager->Load(mockModule_2);
+
+        EXPECT_CALL(*mockModule_1, CallMmiGet(_, StrEq(componentName_1), StrEq(objectName_1), _, _)).Times(1).WillOnce(DoAll(SetArgPointee<3>(value_1), SetArgPointee<4>(strlen(value_1)), Return(MMI_OK)));
+        EXPECT_CALL(*mockModule_2, CallMmiGet(_, StrEq(componentName_2), StrEq(objectName_2), _, _)).Times(1).WillOnce(Return(EIO));
+
+        std::shared_ptr<MpiSession> mpiSession = std::make_shared<MpiSession>(*m_mockModuleManager, m_defaultClient);
+        EXPECT_EQ(0, mpiSession->Open());
+        EXPECT_EQ(MPI_OK, mpiSession->GetMany(objects, strlen(objects), &payload, &payloadSizeBytes));
+
+        std::string actual(payload, payloadSizeBytes);
+        EXPECT_TRUE(JSON_EQ(expected, actual));
+
+        delete[] payload;
+    }
+
+    TEST_F(ModuleManagerTests, MpiGetManyInvalidObjects)
+    {
+        char notAnArray[] = R""""({"ComponentName": "component", "ObjectName": "object"})"""";
+        char missingObjectName[] = R""""([{"ComponentName": "component"}])"""";
+        MPI_JSON_STRING payload = nullptr;
+        int payloadSizeBytes = 0;
+
+        EXPECT_EQ(EINVAL, m_mpiSession->GetMany(nullptr, 0, &payload, &payloadSizeBytes));
+        EXPECT_EQ(EINVAL, m_mpiSession->GetMany(notAnArray, strlen(notAnArray), &payload, &payloadSizeBytes));
+        EXPECT_EQ(EINVAL, m_mpiSession->GetMany(missingObjectName, strlen(missingObjectName), &payload, &payloadSizeBytes));
+        EXPECT_EQ(nullptr, payload);
+        EXPECT_EQ(0, payloadSizeBytes);
+    }
+
     TEST_F(ModuleManagerTests, MpiGetReportedInvalidPayload)
     {
         int payloadSizeBytes = 0;
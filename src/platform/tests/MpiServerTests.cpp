@@ -93,6 +93,24 @@ namespace Tests
         return MPI_OK;
     }
 
+    static int MockCallMpiGetMany(MPI_HANDLE handle, const MPI_JSON_STRING objects, const int objectsSize, MPI_JSON_STRING* payload, int* payloadSize)
+    {
+        UNUSED(handle);
+
+        if (nullptr != strstr(std::string(objects, objectsSize).c_str(), g_errorComponent))
+        {
+            return -1;
+        }
+
+        *payload = new (std::nothrow) char[strlen(g_mockPayload) + 1];
+        if (*payload != nullptr)
+        {
+            strcpy(*payload, g_mockPayload);
+            *payloadSize = strlen(g_mockPayload);
+        }
+        return MPI_OK;
+    }
+
     static const MPI_CALLS g_mpiCalls =
     {
         MockCallMpiOpen,
@@ -100,7 +118,8 @@ namespace Tests
         MockCallMpiSet,
         MockCallMpiGet,
         MockCallMpiSetDesired,
-        MockCallMpiGetReported
+        MockCallMpiGetReported,
+        MockCallMpiGetMany
     };
 
     TEST_F(MpiServerTests, HandleMpiRequestInvalidRequest)
@@ -346,4 +365,36 @@ namespace Tests
         EXPECT_EQ(strlen(g_mockPayload), responseSize);
         FREE_MEMORY(response);
     }
+
+    TEST_F(MpiServerTests, MpiGetManyRequestInvalidRequestBody)
+    {
+        char* response = nullptr;
+        int responseSize = 0;
+
+        EXPECT_EQ(HTTP_BAD_REQUEST, HandleMpiCall(MPI_GET_MANY_URI, "{\"ClientSession\": \"Valid_Client\"}", &response, &responseSize, g_mpiCalls));
+        EXPECT_EQ(nullptr, response);
+        EXPECT_EQ(0, responseSize);
+
+        EXPECT_EQ(HTTP_BAD_REQUEST, HandleMpiCall(MPI_GET_MANY_URI, "{\"ClientSession\": \"Valid_Client\", \"Objects\": {}}", &response, &responseSize, g_mpiCalls));
+        EXPECT_EQ(nullptr, response);
+        EXPECT_EQ(0, responseSize);
+    }
+
+    TEST_F(MpiServerTests, MpiGetManyRequest)
+    {
+        char* response = nullptr;
+        int responseSize = 0;
+
+        EXPECT_EQ(HTTP_OK, HandleMpiCall(MPI_GET_MANY_URI, "{\"ClientSession\": \"Valid_Client\", \"Objects\": [{\"ComponentName\": \"Component\", \"ObjectName\": \"Object\"}]}", &response, &responseSize, g_mpiCalls));
+        EXPECT_STREQ(g_mockPayload, response);
+        EXPECT_EQ(strlen(g_mockPayload), responseSize);
+        FREE_MEMORY(response);
+
+        responseSize = 0;
+
+        EXPECT_EQ(HTTP_INTERNAL_SERVER_ERROR, HandleMpiCall(MPI_GET_MANY_URI, "{\"ClientSession\": \"Valid_Client\", \"Objects\": [{\"ComponentName\": \"Error_Component\", \"ObjectName\": \"Error_Object\"}]}", &response, &responseSize, g_mpiCalls));
+        EXPECT_NE(nullptr, response);
+        EXPECT_GT(responseSize, strlen("\"\""));
+        FREE_MEMORY(response);
+    }
 }
\ No newline at end of file